@@ -0,0 +1,62 @@
+#!/bin/bash
+# Times the compiler on generated programs whose grammar lists
+# (declarations, parameters, arguments, local declarations and
+# statements) hold n elements, for growing n.  Parsing is linear
+# when the time per element stays flat as n doubles.
+#
+# usage: [FLAGS=...] bench/lists.sh [compiler] [sizes...]
+# FLAGS are passed to the compiler, -O0 by default so the
+# optimizer's work on the long lists does not hide the parser's.
+
+flags=${FLAGS--O0}
+compiler=${1:-./run.out}
+shift
+sizes=${@:-10000 20000 40000 80000}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# gen kind n writes a program with a list of n elements
+gen() {
+  awk -v kind=$1 -v n=$2 '
+  # identifiers are letters only: i spelled in base 26
+  function id(i,   s) {
+    s = ""
+    do { s = substr("abcdefghijklmnopqrstuvwxyz", i % 26 + 1, 1) s; i = int(i / 26) } while (i > 0)
+    return s
+  }
+  BEGIN {
+    if (kind == "declarations") {
+      for (i = 0; i < n; i++) printf "int g%s;\n", id(i)
+      print "void main(void) { }"
+    }
+    else if (kind == "params-args") {
+      printf "int f(int pa"
+      for (i = 1; i < n; i++) printf ", int p%s", id(i)
+      print ") { return pa; }"
+      printf "void main(void) { output(f(0"
+      for (i = 1; i < n; i++) printf ", %d", i
+      print ")); }"
+    }
+    else {
+      print "void main(void) {"
+      for (i = 0; i < n; i++) printf "int x%s;\n", id(i)
+      for (i = 0; i < n; i++) printf "x%s = %d;\n", id(i), i
+      print "}"
+    }
+  }'
+}
+
+printf "%-14s %8s %10s %14s\n" list n seconds "us/element"
+for kind in declarations params-args locals-stmts; do
+  for n in $sizes; do
+    gen $kind $n > "$work/$kind.cm"
+    start=$(date +%s.%N)
+    "$compiler" $flags "$work/$kind.cm" > "$work/out" 2>&1
+    if [ $? -ne 0 ] || grep -qE "rror at line|^ERROR in line" "$work/out"; then
+      echo "$kind $n: compile failed" >&2; cat "$work/out" >&2; exit 1
+    fi
+    end=$(date +%s.%N)
+    awk -v k=$kind -v n=$n -v s=$start -v e=$end \
+      'BEGIN { printf "%-14s %8d %10.3f %14.2f\n", k, n, e - s, (e - s) * 1e6 / n }'
+  done
+done
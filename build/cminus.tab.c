@@ -0,0 +1,1932 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison implementation for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* C LALR(1) parser skeleton written by Richard Stallman, by
+   simplifying the original so-called "semantic" parser.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+/* All symbols defined below should begin with yy or YY, to avoid
+   infringing on user name space.  This should be done even for local
+   variables, as they might otherwise be expanded by user macros.
+   There are some unavoidable exceptions within include files to
+   define necessary library symbols; they are noted "INFRINGES ON
+   USER NAME SPACE" below.  */
+
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
+
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
+
+/* Skeleton name.  */
+#define YYSKELETON_NAME "yacc.c"
+
+/* Pure parsers.  */
+#define YYPURE 2
+
+/* Push parsers.  */
+#define YYPUSH 0
+
+/* Pull parsers.  */
+#define YYPULL 1
+
+
+
+
+/* First part of user prologue.  */
+#line 1 "src/cminus.y"
+
+  #define YYPARSER
+
+  #include "globals.h"
+  #include "util.h"
+  #include "scan.h"
+  #include "parse.h"
+
+
+#line 81 "build/cminus.tab.c"
+
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
+# ifndef YY_NULLPTR
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
+#  else
+#   define YY_NULLPTR ((void*)0)
+#  endif
+# endif
+
+#include "cminus.tab.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
+{
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_NUM = 3,                        /* NUM  */
+  YYSYMBOL_ID = 4,                         /* ID  */
+  YYSYMBOL_ELSE = 5,                       /* ELSE  */
+  YYSYMBOL_IF = 6,                         /* IF  */
+  YYSYMBOL_INT = 7,                        /* INT  */
+  YYSYMBOL_RETURN = 8,                     /* RETURN  */
+  YYSYMBOL_VOID = 9,                       /* VOID  */
+  YYSYMBOL_WHILE = 10,                     /* WHILE  */
+  YYSYMBOL_PLUS = 11,                      /* PLUS  */
+  YYSYMBOL_MINUS = 12,                     /* MINUS  */
+  YYSYMBOL_STAR = 13,                      /* STAR  */
+  YYSYMBOL_SLASH = 14,                     /* SLASH  */
+  YYSYMBOL_LT = 15,                        /* LT  */
+  YYSYMBOL_LE = 16,                        /* LE  */
+  YYSYMBOL_GT = 17,                        /* GT  */
+  YYSYMBOL_GE = 18,                        /* GE  */
+  YYSYMBOL_EQ = 19,                        /* EQ  */
+  YYSYMBOL_NE = 20,                        /* NE  */
+  YYSYMBOL_ASSIGN = 21,                    /* ASSIGN  */
+  YYSYMBOL_SEMI = 22,                      /* SEMI  */
+  YYSYMBOL_COMMA = 23,                     /* COMMA  */
+  YYSYMBOL_LPAREN = 24,                    /* LPAREN  */
+  YYSYMBOL_RPAREN = 25,                    /* RPAREN  */
+  YYSYMBOL_LBRACKET = 26,                  /* LBRACKET  */
+  YYSYMBOL_RBRACKET = 27,                  /* RBRACKET  */
+  YYSYMBOL_LBRACE = 28,                    /* LBRACE  */
+  YYSYMBOL_RBRACE = 29,                    /* RBRACE  */
+  YYSYMBOL_LEX_ERROR = 30,                 /* LEX_ERROR  */
+  YYSYMBOL_THEN = 31,                      /* THEN  */
+  YYSYMBOL_YYACCEPT = 32,                  /* $accept  */
+  YYSYMBOL_program = 33,                   /* program  */
+  YYSYMBOL_34_1 = 34,                      /* $@1  */
+  YYSYMBOL_35_declaration_list = 35,       /* declaration-list  */
+  YYSYMBOL_declaration = 36,               /* declaration  */
+  YYSYMBOL_37_var_declaration = 37,        /* var-declaration  */
+  YYSYMBOL_38_type_specifier = 38,         /* type-specifier  */
+  YYSYMBOL_39_fun_declaration = 39,        /* fun-declaration  */
+  YYSYMBOL_params = 40,                    /* params  */
+  YYSYMBOL_41_param_list = 41,             /* param-list  */
+  YYSYMBOL_param = 42,                     /* param  */
+  YYSYMBOL_43_compound_stmt = 43,          /* compound-stmt  */
+  YYSYMBOL_44_local_declarations = 44,     /* local-declarations  */
+  YYSYMBOL_45_statement_list = 45,         /* statement-list  */
+  YYSYMBOL_statement = 46,                 /* statement  */
+  YYSYMBOL_47_expression_stmt = 47,        /* expression-stmt  */
+  YYSYMBOL_48_selection_stmt = 48,         /* selection-stmt  */
+  YYSYMBOL_49_iteration_stmt = 49,         /* iteration-stmt  */
+  YYSYMBOL_50_return_stmt = 50,            /* return-stmt  */
+  YYSYMBOL_expression = 51,                /* expression  */
+  YYSYMBOL_var = 52,                       /* var  */
+  YYSYMBOL_53_simple_expression = 53,      /* simple-expression  */
+  YYSYMBOL_relop = 54,                     /* relop  */
+  YYSYMBOL_55_additive_expression = 55,    /* additive-expression  */
+  YYSYMBOL_addop = 56,                     /* addop  */
+  YYSYMBOL_term = 57,                      /* term  */
+  YYSYMBOL_mulop = 58,                     /* mulop  */
+  YYSYMBOL_factor = 59,                    /* factor  */
+  YYSYMBOL_call = 60,                      /* call  */
+  YYSYMBOL_args = 61,                      /* args  */
+  YYSYMBOL_62_arg_list = 62                /* arg-list  */
+};
+typedef enum yysymbol_kind_t yysymbol_kind_t;
+
+
+
+/* Unqualified %code blocks.  */
+#line 45 "src/cminus.y"
+
+  static int yyerror(CompileContext *ctx, char const *message);
+  static int yylex(YYSTYPE *lval, CompileContext *ctx);
+
+#line 183 "build/cminus.tab.c"
+
+#ifdef short
+# undef short
+#endif
+
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
+
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
+#endif
+
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
+
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
+typedef signed char yytype_int8;
+#endif
+
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
+#else
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
+#endif
+
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
+#else
+typedef short yytype_uint8;
+#endif
+
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
+#else
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
+#endif
+
+#ifndef YYSIZE_T
+# ifdef __SIZE_TYPE__
+#  define YYSIZE_T __SIZE_TYPE__
+# elif defined size_t
+#  define YYSIZE_T size_t
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYSIZE_T size_t
+# else
+#  define YYSIZE_T unsigned
+# endif
+#endif
+
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_int8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
+
+#ifndef YY_
+# if defined YYENABLE_NLS && YYENABLE_NLS
+#  if ENABLE_NLS
+#   include <libintl.h> /* INFRINGES ON USER NAME SPACE */
+#   define YY_(Msgid) dgettext ("bison-runtime", Msgid)
+#  endif
+# endif
+# ifndef YY_
+#  define YY_(Msgid) Msgid
+# endif
+#endif
+
+
+#ifndef YY_ATTRIBUTE_PURE
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
+#endif
+
+#ifndef YY_ATTRIBUTE_UNUSED
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
+# else
+#  define YY_ATTRIBUTE_UNUSED
+# endif
+#endif
+
+/* Suppress unused-variable warnings by "using" E.  */
+#if ! defined lint || defined __GNUC__
+# define YY_USE(E) ((void) (E))
+#else
+# define YY_USE(E) /* empty */
+#endif
+
+/* Suppress an incorrect diagnostic about yylval being uninitialized.  */
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
+    _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
+    _Pragma ("GCC diagnostic pop")
+#else
+# define YY_INITIAL_VALUE(Value) Value
+#endif
+#ifndef YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END
+#endif
+#ifndef YY_INITIAL_VALUE
+# define YY_INITIAL_VALUE(Value) /* Nothing. */
+#endif
+
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
+#endif
+
+
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if !defined yyoverflow
+
+/* The parser invokes alloca or malloc; define the necessary symbols.  */
+
+# ifdef YYSTACK_USE_ALLOCA
+#  if YYSTACK_USE_ALLOCA
+#   ifdef __GNUC__
+#    define YYSTACK_ALLOC __builtin_alloca
+#   elif defined __BUILTIN_VA_ARG_INCR
+#    include <alloca.h> /* INFRINGES ON USER NAME SPACE */
+#   elif defined _AIX
+#    define YYSTACK_ALLOC __alloca
+#   elif defined _MSC_VER
+#    include <malloc.h> /* INFRINGES ON USER NAME SPACE */
+#    define alloca _alloca
+#   else
+#    define YYSTACK_ALLOC alloca
+#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
+#     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
+#     ifndef EXIT_SUCCESS
+#      define EXIT_SUCCESS 0
+#     endif
+#    endif
+#   endif
+#  endif
+# endif
+
+# ifdef YYSTACK_ALLOC
+   /* Pacify GCC's 'empty if-body' warning.  */
+#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+    /* The OS might guarantee only one guard page at the bottom of the stack,
+       and a page size can be as small as 4096 bytes.  So we cannot safely
+       invoke alloca (N) if N exceeds 4096.  Use a slightly smaller number
+       to allow for a few compiler-allocated temporary stack slots.  */
+#   define YYSTACK_ALLOC_MAXIMUM 4032 /* reasonable circa 2006 */
+#  endif
+# else
+#  define YYSTACK_ALLOC YYMALLOC
+#  define YYSTACK_FREE YYFREE
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+#   define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
+#  endif
+#  if (defined __cplusplus && ! defined EXIT_SUCCESS \
+       && ! ((defined YYMALLOC || defined malloc) \
+             && (defined YYFREE || defined free)))
+#   include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+#   ifndef EXIT_SUCCESS
+#    define EXIT_SUCCESS 0
+#   endif
+#  endif
+#  ifndef YYMALLOC
+#   define YYMALLOC malloc
+#   if ! defined malloc && ! defined EXIT_SUCCESS
+void *malloc (YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+#  ifndef YYFREE
+#   define YYFREE free
+#   if ! defined free && ! defined EXIT_SUCCESS
+void free (void *); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+# endif
+#endif /* !defined yyoverflow */
+
+#if (! defined yyoverflow \
+     && (! defined __cplusplus \
+         || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+
+/* A type that is properly aligned for any stack member.  */
+union yyalloc
+{
+  yy_state_t yyss_alloc;
+  YYSTYPE yyvs_alloc;
+};
+
+/* The size of the maximum gap between one aligned stack and the next.  */
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
+
+/* The size of an array large to enough to hold all stacks, each with
+   N elements.  */
+# define YYSTACK_BYTES(N) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
+      + YYSTACK_GAP_MAXIMUM)
+
+# define YYCOPY_NEEDED 1
+
+/* Relocate STACK from its old location to the new one.  The
+   local variables YYSIZE and YYSTACKSIZE give the old and new number of
+   elements in the stack, and YYPTR gives the new location of the
+   stack.  Advance YYPTR to a properly aligned location for the next
+   stack.  */
+# define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
+    do                                                                  \
+      {                                                                 \
+        YYPTRDIFF_T yynewbytes;                                         \
+        YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
+        Stack = &yyptr->Stack_alloc;                                    \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
+      }                                                                 \
+    while (0)
+
+#endif
+
+#if defined YYCOPY_NEEDED && YYCOPY_NEEDED
+/* Copy COUNT objects from SRC to DST.  The source and destination do
+   not overlap.  */
+# ifndef YYCOPY
+#  if defined __GNUC__ && 1 < __GNUC__
+#   define YYCOPY(Dst, Src, Count) \
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
+#  else
+#   define YYCOPY(Dst, Src, Count)              \
+      do                                        \
+        {                                       \
+          YYPTRDIFF_T yyi;                      \
+          for (yyi = 0; yyi < (Count); yyi++)   \
+            (Dst)[yyi] = (Src)[yyi];            \
+        }                                       \
+      while (0)
+#  endif
+# endif
+#endif /* !YYCOPY_NEEDED */
+
+/* YYFINAL -- State number of the termination state.  */
+#define YYFINAL  3
+/* YYLAST -- Last index in YYTABLE.  */
+#define YYLAST   95
+
+/* YYNTOKENS -- Number of terminals.  */
+#define YYNTOKENS  32
+/* YYNNTS -- Number of nonterminals.  */
+#define YYNNTS  31
+/* YYNRULES -- Number of rules.  */
+#define YYNRULES  64
+/* YYNSTATES -- Number of states.  */
+#define YYNSTATES  103
+
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   286
+
+
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
+
+/* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
+{
+       0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
+       5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
+      15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
+      25,    26,    27,    28,    29,    30,    31
+};
+
+#if YYDEBUG
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_uint8 yyrline[] =
+{
+       0,    51,    51,    51,    55,    58,    62,    62,    64,    70,
+      78,    79,    81,    90,    92,    97,    99,   103,   108,   116,
+     122,   124,   128,   130,   133,   134,   135,   136,   137,   139,
+     141,   145,   150,   157,   163,   166,   171,   176,   180,   184,
+     193,   198,   200,   200,   200,   200,   201,   201,   203,   208,
+     210,   210,   212,   217,   219,   219,   221,   222,   222,   223,
+     228,   234,   234,   235,   237
+};
+#endif
+
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if YYDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
+/* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
+   First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
+static const char *const yytname[] =
+{
+  "\"end of file\"", "error", "\"invalid token\"", "NUM", "ID", "ELSE",
+  "IF", "INT", "RETURN", "VOID", "WHILE", "PLUS", "MINUS", "STAR", "SLASH",
+  "LT", "LE", "GT", "GE", "EQ", "NE", "ASSIGN", "SEMI", "COMMA", "LPAREN",
+  "RPAREN", "LBRACKET", "RBRACKET", "LBRACE", "RBRACE", "LEX_ERROR",
+  "THEN", "$accept", "program", "$@1", "declaration-list", "declaration",
+  "var-declaration", "type-specifier", "fun-declaration", "params",
+  "param-list", "param", "compound-stmt", "local-declarations",
+  "statement-list", "statement", "expression-stmt", "selection-stmt",
+  "iteration-stmt", "return-stmt", "expression", "var",
+  "simple-expression", "relop", "additive-expression", "addop", "term",
+  "mulop", "factor", "call", "args", "arg-list", YY_NULLPTR
+};
+
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
+{
+  return yytname[yysymbol];
+}
+#endif
+
+#define YYPACT_NINF (-75)
+
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
+
+#define YYTABLE_NINF (-15)
+
+#define yytable_value_is_error(Yyn) \
+  0
+
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
+static const yytype_int8 yypact[] =
+{
+     -75,     4,    54,   -75,   -75,   -75,    54,   -75,   -75,    10,
+     -75,   -75,   -14,   -75,    57,    21,    -8,    26,    20,    33,
+     -75,    45,    34,    46,    54,    51,    48,   -75,   -75,   -75,
+     -75,   -75,    54,   -75,    72,     3,     7,   -75,    41,    53,
+      18,    56,   -75,    12,   -75,   -75,   -75,   -75,   -75,   -75,
+     -75,    60,    58,   -75,    32,    55,   -75,   -75,    12,    12,
+      12,   -75,    61,    12,    62,   -75,    12,   -75,   -75,   -75,
+     -75,   -75,   -75,   -75,   -75,    12,    12,   -75,   -75,    12,
+     -75,    63,    66,    64,    65,   -75,    67,   -75,   -75,   -75,
+      59,    55,   -75,   -75,    12,   -75,    31,    31,   -75,    73,
+     -75,    31,   -75
+};
+
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
+{
+       2,     0,     0,     1,    10,    11,     3,     5,     6,     0,
+       7,     4,     0,     8,     0,     0,    11,     0,     0,    13,
+      16,     0,    17,     0,     0,     0,     0,    21,    12,    15,
+       9,    18,    23,    20,     0,     0,     0,    59,    38,     0,
+       0,     0,    30,     0,    19,    25,    22,    24,    26,    27,
+      28,     0,    57,    37,    41,    49,    53,    58,    62,     0,
+       0,    34,     0,     0,     0,    29,     0,    50,    51,    43,
+      42,    44,    45,    46,    47,     0,     0,    54,    55,     0,
+      64,     0,    61,     0,     0,    35,     0,    56,    36,    57,
+      40,    48,    52,    60,     0,    39,     0,     0,    63,    31,
+      33,     0,    32
+};
+
+/* YYPGOTO[NTERM-NUM].  */
+static const yytype_int8 yypgoto[] =
+{
+     -75,   -75,   -75,   -75,    75,    52,    14,   -75,   -75,   -75,
+      69,    71,   -75,   -75,   -39,   -75,   -75,   -75,   -75,   -40,
+     -74,   -75,   -75,    11,   -75,     9,   -75,    16,   -75,   -75,
+     -75
+};
+
+/* YYDEFGOTO[NTERM-NUM].  */
+static const yytype_int8 yydefgoto[] =
+{
+       0,     1,     2,     6,     7,     8,     9,    10,    18,    19,
+      20,    45,    32,    35,    46,    47,    48,    49,    50,    51,
+      52,    53,    75,    54,    76,    55,    79,    56,    57,    81,
+      82
+};
+
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int8 yytable[] =
+{
+      62,    89,    89,    64,     3,    89,    37,    38,    13,    39,
+      14,    40,    15,    41,    12,    37,    38,   -14,    80,    83,
+      84,    37,    38,    86,    21,    42,    88,    43,    17,    13,
+      22,    27,    44,    15,    37,    38,    43,    39,    17,    40,
+      61,    41,    43,    67,    68,    23,    34,    69,    70,    71,
+      72,    73,    74,    42,    98,    43,    24,    99,   100,    27,
+      26,     4,   102,     5,     4,    58,    16,    59,    77,    78,
+      67,    68,    25,    30,    27,    31,    36,    60,   101,    66,
+      63,    11,    65,    85,    33,    91,    90,    87,    93,    94,
+      96,    95,    97,    29,    28,    92
+};
+
+static const yytype_int8 yycheck[] =
+{
+      40,    75,    76,    43,     0,    79,     3,     4,    22,     6,
+      24,     8,    26,    10,     4,     3,     4,    25,    58,    59,
+      60,     3,     4,    63,     3,    22,    66,    24,    14,    22,
+       4,    28,    29,    26,     3,     4,    24,     6,    24,     8,
+      22,    10,    24,    11,    12,    25,    32,    15,    16,    17,
+      18,    19,    20,    22,    94,    24,    23,    96,    97,    28,
+      26,     7,   101,     9,     7,    24,     9,    26,    13,    14,
+      11,    12,    27,    22,    28,    27,     4,    24,     5,    21,
+      24,     6,    22,    22,    32,    76,    75,    25,    25,    23,
+      25,    27,    25,    24,    23,    79
+};
+
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
+{
+       0,    33,    34,     0,     7,     9,    35,    36,    37,    38,
+      39,    36,     4,    22,    24,    26,     9,    38,    40,    41,
+      42,     3,     4,    25,    23,    27,    26,    28,    43,    42,
+      22,    27,    44,    37,    38,    45,     4,     3,     4,     6,
+       8,    10,    22,    24,    29,    43,    46,    47,    48,    49,
+      50,    51,    52,    53,    55,    57,    59,    60,    24,    26,
+      24,    22,    51,    24,    51,    22,    21,    11,    12,    15,
+      16,    17,    18,    19,    20,    54,    56,    13,    14,    58,
+      51,    61,    62,    51,    51,    22,    51,    25,    51,    52,
+      55,    57,    59,    25,    23,    27,    25,    25,    51,    46,
+      46,     5,    46
+};
+
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
+{
+       0,    32,    34,    33,    35,    35,    36,    36,    37,    37,
+      38,    38,    39,    40,    40,    41,    41,    42,    42,    43,
+      44,    44,    45,    45,    46,    46,    46,    46,    46,    47,
+      47,    48,    48,    49,    50,    50,    51,    51,    52,    52,
+      53,    53,    54,    54,    54,    54,    54,    54,    55,    55,
+      56,    56,    57,    57,    58,    58,    59,    59,    59,    59,
+      60,    61,    61,    62,    62
+};
+
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
+{
+       0,     2,     0,     2,     2,     1,     1,     1,     3,     6,
+       1,     1,     6,     1,     1,     3,     1,     2,     4,     4,
+       2,     0,     2,     0,     1,     1,     1,     1,     1,     2,
+       1,     5,     7,     5,     2,     3,     3,     1,     1,     4,
+       3,     1,     1,     1,     1,     1,     1,     1,     3,     1,
+       1,     1,     3,     1,     1,     1,     3,     1,     1,     1,
+       4,     1,     0,     3,     1
+};
+
+
+enum { YYENOMEM = -2 };
+
+#define yyerrok         (yyerrstatus = 0)
+#define yyclearin       (yychar = YYEMPTY)
+
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
+
+
+#define YYRECOVERING()  (!!yyerrstatus)
+
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (ctx, YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
+
+
+/* Enable debugging if requested.  */
+#if YYDEBUG
+
+# ifndef YYFPRINTF
+#  include <stdio.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYFPRINTF fprintf
+# endif
+
+# define YYDPRINTF(Args)                        \
+do {                                            \
+  if (yydebug)                                  \
+    YYFPRINTF Args;                             \
+} while (0)
+
+
+
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
+do {                                                                      \
+  if (yydebug)                                                            \
+    {                                                                     \
+      YYFPRINTF (stderr, "%s ", Title);                                   \
+      yy_symbol_print (stderr,                                            \
+                  Kind, Value, ctx); \
+      YYFPRINTF (stderr, "\n");                                           \
+    }                                                                     \
+} while (0)
+
+
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
+
+static void
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, CompileContext *ctx)
+{
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
+  YY_USE (ctx);
+  if (!yyvaluep)
+    return;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+}
+
+
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
+
+static void
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, CompileContext *ctx)
+{
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
+
+  yy_symbol_value_print (yyo, yykind, yyvaluep, ctx);
+  YYFPRINTF (yyo, ")");
+}
+
+/*------------------------------------------------------------------.
+| yy_stack_print -- Print the state stack from its BOTTOM up to its |
+| TOP (included).                                                   |
+`------------------------------------------------------------------*/
+
+static void
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
+{
+  YYFPRINTF (stderr, "Stack now");
+  for (; yybottom <= yytop; yybottom++)
+    {
+      int yybot = *yybottom;
+      YYFPRINTF (stderr, " %d", yybot);
+    }
+  YYFPRINTF (stderr, "\n");
+}
+
+# define YY_STACK_PRINT(Bottom, Top)                            \
+do {                                                            \
+  if (yydebug)                                                  \
+    yy_stack_print ((Bottom), (Top));                           \
+} while (0)
+
+
+/*------------------------------------------------.
+| Report that the YYRULE is going to be reduced.  |
+`------------------------------------------------*/
+
+static void
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule, CompileContext *ctx)
+{
+  int yylno = yyrline[yyrule];
+  int yynrhs = yyr2[yyrule];
+  int yyi;
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
+             yyrule - 1, yylno);
+  /* The symbols being reduced.  */
+  for (yyi = 0; yyi < yynrhs; yyi++)
+    {
+      YYFPRINTF (stderr, "   $%d = ", yyi + 1);
+      yy_symbol_print (stderr,
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)], ctx);
+      YYFPRINTF (stderr, "\n");
+    }
+}
+
+# define YY_REDUCE_PRINT(Rule)          \
+do {                                    \
+  if (yydebug)                          \
+    yy_reduce_print (yyssp, yyvsp, Rule, ctx); \
+} while (0)
+
+/* Nonzero means print parse trace.  It is left uninitialized so that
+   multiple parsers can coexist.  */
+int yydebug;
+#else /* !YYDEBUG */
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
+# define YY_STACK_PRINT(Bottom, Top)
+# define YY_REDUCE_PRINT(Rule)
+#endif /* !YYDEBUG */
+
+
+/* YYINITDEPTH -- initial size of the parser's stacks.  */
+#ifndef YYINITDEPTH
+# define YYINITDEPTH 200
+#endif
+
+/* YYMAXDEPTH -- maximum size the stacks can grow to (effective only
+   if the built-in stack extension method is used).
+
+   Do not make this value too large; the results are undefined if
+   YYSTACK_ALLOC_MAXIMUM < YYSTACK_BYTES (YYMAXDEPTH)
+   evaluated with infinite-precision integer arithmetic.  */
+
+#ifndef YYMAXDEPTH
+# define YYMAXDEPTH 10000
+#endif
+
+
+
+
+
+
+/*-----------------------------------------------.
+| Release the memory associated to this symbol.  |
+`-----------------------------------------------*/
+
+static void
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, CompileContext *ctx)
+{
+  YY_USE (yyvaluep);
+  YY_USE (ctx);
+  if (!yymsg)
+    yymsg = "Deleting";
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+}
+
+
+
+
+
+
+/*----------.
+| yyparse.  |
+`----------*/
+
+int
+yyparse (CompileContext *ctx)
+{
+/* Lookahead token kind.  */
+int yychar;
+
+
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
+
+    /* Number of syntax errors so far.  */
+    int yynerrs = 0;
+
+    yy_state_fast_t yystate = 0;
+    /* Number of tokens to shift before error messages enabled.  */
+    int yyerrstatus = 0;
+
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
+
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
+
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
+
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
+
+  int yyn;
+  /* The return value of yyparse.  */
+  int yyresult;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
+  /* The variables used to return semantic value and location from the
+     action routines.  */
+  YYSTYPE yyval;
+
+
+
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
+
+  /* The number of symbols on the RHS of the reduced rule.
+     Keep to zero when no symbol should be popped.  */
+  int yylen = 0;
+
+  YYDPRINTF ((stderr, "Starting parse\n"));
+
+  yychar = YYEMPTY; /* Cause a token to be read.  */
+
+  goto yysetstate;
+
+
+/*------------------------------------------------------------.
+| yynewstate -- push a new state, which is found in yystate.  |
+`------------------------------------------------------------*/
+yynewstate:
+  /* In all cases, when you get here, the value and location stacks
+     have just been pushed.  So pushing a state here evens the stacks.  */
+  yyssp++;
+
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
+
+  if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
+    {
+      /* Get the current used size of the three stacks, in elements.  */
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
+
+# if defined yyoverflow
+      {
+        /* Give user a chance to reallocate the stack.  Use copies of
+           these so that the &'s don't force the real ones into
+           memory.  */
+        yy_state_t *yyss1 = yyss;
+        YYSTYPE *yyvs1 = yyvs;
+
+        /* Each stack pointer address is followed by the size of the
+           data in use in that stack, in bytes.  This used to be a
+           conditional around just the two extra args, but that might
+           be undefined if yyoverflow is a macro.  */
+        yyoverflow (YY_("memory exhausted"),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yystacksize);
+        yyss = yyss1;
+        yyvs = yyvs1;
+      }
+# else /* defined YYSTACK_RELOCATE */
+      /* Extend the stack our own way.  */
+      if (YYMAXDEPTH <= yystacksize)
+        YYNOMEM;
+      yystacksize *= 2;
+      if (YYMAXDEPTH < yystacksize)
+        yystacksize = YYMAXDEPTH;
+
+      {
+        yy_state_t *yyss1 = yyss;
+        union yyalloc *yyptr =
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
+        if (! yyptr)
+          YYNOMEM;
+        YYSTACK_RELOCATE (yyss_alloc, yyss);
+        YYSTACK_RELOCATE (yyvs_alloc, yyvs);
+#  undef YYSTACK_RELOCATE
+        if (yyss1 != yyssa)
+          YYSTACK_FREE (yyss1);
+      }
+# endif
+
+      yyssp = yyss + yysize - 1;
+      yyvsp = yyvs + yysize - 1;
+
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
+
+      if (yyss + yystacksize - 1 <= yyssp)
+        YYABORT;
+    }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
+
+
+  if (yystate == YYFINAL)
+    YYACCEPT;
+
+  goto yybackup;
+
+
+/*-----------.
+| yybackup.  |
+`-----------*/
+yybackup:
+  /* Do appropriate processing given the current state.  Read a
+     lookahead token if we need one and don't already have one.  */
+
+  /* First try to decide what to do without reference to lookahead token.  */
+  yyn = yypact[yystate];
+  if (yypact_value_is_default (yyn))
+    goto yydefault;
+
+  /* Not known => get a lookahead token if don't already have one.  */
+
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
+  if (yychar == YYEMPTY)
+    {
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex (&yylval, ctx);
+    }
+
+  if (yychar <= YYEOF)
+    {
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
+      YYDPRINTF ((stderr, "Now at end of input.\n"));
+    }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
+    }
+  else
+    {
+      yytoken = YYTRANSLATE (yychar);
+      YY_SYMBOL_PRINT ("Next token is", yytoken, &yylval, &yylloc);
+    }
+
+  /* If the proper action on seeing token YYTOKEN is to reduce or to
+     detect an error, take that action.  */
+  yyn += yytoken;
+  if (yyn < 0 || YYLAST < yyn || yycheck[yyn] != yytoken)
+    goto yydefault;
+  yyn = yytable[yyn];
+  if (yyn <= 0)
+    {
+      if (yytable_value_is_error (yyn))
+        goto yyerrlab;
+      yyn = -yyn;
+      goto yyreduce;
+    }
+
+  /* Count tokens shifted since error; after three, turn off error
+     status.  */
+  if (yyerrstatus)
+    yyerrstatus--;
+
+  /* Shift the lookahead token.  */
+  YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
+  yystate = yyn;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
+  goto yynewstate;
+
+
+/*-----------------------------------------------------------.
+| yydefault -- do the default action for the current state.  |
+`-----------------------------------------------------------*/
+yydefault:
+  yyn = yydefact[yystate];
+  if (yyn == 0)
+    goto yyerrlab;
+  goto yyreduce;
+
+
+/*-----------------------------.
+| yyreduce -- do a reduction.  |
+`-----------------------------*/
+yyreduce:
+  /* yyn is the number of a rule to reduce with.  */
+  yylen = yyr2[yyn];
+
+  /* If YYLEN is nonzero, implement the default value of the action:
+     '$$ = $1'.
+
+     Otherwise, the following line sets YYVAL to garbage.
+     This behavior is undocumented and Bison
+     users should not rely upon it.  Assigning to YYVAL
+     unconditionally makes the parser a bit smaller, and it avoids a
+     GCC warning that YYVAL may be used uninitialized.  */
+  yyval = yyvsp[1-yylen];
+
+
+  YY_REDUCE_PRINT (yyn);
+  switch (yyn)
+    {
+  case 2: /* $@1: %empty  */
+#line 51 "src/cminus.y"
+         { ctx->syntaxTree = NULL; }
+#line 1215 "build/cminus.tab.c"
+    break;
+
+  case 3: /* program: $@1 declaration-list  */
+#line 51 "src/cminus.y"
+                                                      {
+  ctx->syntaxTree = (yyvsp[0].nodeList).head;
+}
+#line 1223 "build/cminus.tab.c"
+    break;
+
+  case 4: /* declaration-list: declaration-list declaration  */
+#line 55 "src/cminus.y"
+                                               {
+  (yyval.nodeList) = appendNodeList((yyvsp[-1].nodeList), (yyvsp[0].treeNode));
+}
+#line 1231 "build/cminus.tab.c"
+    break;
+
+  case 5: /* declaration-list: declaration  */
+#line 58 "src/cminus.y"
+              {
+  (yyval.nodeList) = newNodeList((yyvsp[0].treeNode));
+}
+#line 1239 "build/cminus.tab.c"
+    break;
+
+  case 6: /* declaration: var-declaration  */
+#line 62 "src/cminus.y"
+                             { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1245 "build/cminus.tab.c"
+    break;
+
+  case 7: /* declaration: fun-declaration  */
+#line 62 "src/cminus.y"
+                                                            { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1251 "build/cminus.tab.c"
+    break;
+
+  case 8: /* var-declaration: type-specifier ID SEMI  */
+#line 64 "src/cminus.y"
+                                        {
+  (yyval.treeNode) = newDeclNode(ctx, VarDeclK);
+  setChild((yyval.treeNode), 0, (yyvsp[-2].treeNode));
+  (yyval.treeNode)->attr.name = (yyvsp[-1].identifier);
+  (yyval.treeNode)->type = (yyvsp[-2].treeNode)->type;
+}
+#line 1262 "build/cminus.tab.c"
+    break;
+
+  case 9: /* var-declaration: type-specifier ID LBRACKET NUM RBRACKET SEMI  */
+#line 70 "src/cminus.y"
+                                               {
+  (yyval.treeNode) = newDeclNode(ctx, VarDeclK);
+  setChild((yyval.treeNode), 0, (yyvsp[-5].treeNode));
+  getChild((yyval.treeNode), 0)->attr.val = (yyvsp[-2].number);
+  (yyval.treeNode)->attr.name = (yyvsp[-4].identifier);
+  (yyval.treeNode)->type = (yyvsp[-5].treeNode)->type;
+}
+#line 1274 "build/cminus.tab.c"
+    break;
+
+  case 10: /* type-specifier: INT  */
+#line 78 "src/cminus.y"
+                    { (yyval.treeNode) = newTypeNode(ctx); (yyval.treeNode)->type = IntK; }
+#line 1280 "build/cminus.tab.c"
+    break;
+
+  case 11: /* type-specifier: VOID  */
+#line 79 "src/cminus.y"
+       { (yyval.treeNode) = newTypeNode(ctx); (yyval.treeNode)->type = VoidK; }
+#line 1286 "build/cminus.tab.c"
+    break;
+
+  case 12: /* fun-declaration: type-specifier ID LPAREN params RPAREN compound-stmt  */
+#line 81 "src/cminus.y"
+                                                                      {
+  (yyval.treeNode) = newDeclNode(ctx, FunDeclK);
+  setChild((yyval.treeNode), 0, (yyvsp[-5].treeNode));
+  (yyval.treeNode)->attr.name = (yyvsp[-4].identifier);
+  setChild((yyval.treeNode), 1, (yyvsp[-2].treeNode));
+  setChild((yyval.treeNode), 2, (yyvsp[0].treeNode));
+  (yyval.treeNode)->type = (yyvsp[-5].treeNode)->type;
+}
+#line 1299 "build/cminus.tab.c"
+    break;
+
+  case 13: /* params: param-list  */
+#line 90 "src/cminus.y"
+                   {
+  (yyval.treeNode) = (yyvsp[0].nodeList).head;
+}
+#line 1307 "build/cminus.tab.c"
+    break;
+
+  case 14: /* params: VOID  */
+#line 92 "src/cminus.y"
+         {
+  (yyval.treeNode) = newParamNode(ctx);
+  (yyval.treeNode)->nChildren = 0;
+}
+#line 1316 "build/cminus.tab.c"
+    break;
+
+  case 15: /* param-list: param-list COMMA param  */
+#line 97 "src/cminus.y"
+                                   {
+  (yyval.nodeList) = appendNodeList((yyvsp[-2].nodeList), (yyvsp[0].treeNode));
+}
+#line 1324 "build/cminus.tab.c"
+    break;
+
+  case 16: /* param-list: param  */
+#line 99 "src/cminus.y"
+          {
+  (yyval.nodeList) = newNodeList((yyvsp[0].treeNode));
+}
+#line 1332 "build/cminus.tab.c"
+    break;
+
+  case 17: /* param: type-specifier ID  */
+#line 103 "src/cminus.y"
+                         {
+  (yyval.treeNode) = newParamNode(ctx);
+  setChild((yyval.treeNode), 0, (yyvsp[-1].treeNode));
+  (yyval.treeNode)->attr.name = (yyvsp[0].identifier);
+  (yyval.treeNode)->type = (yyvsp[-1].treeNode)->type;
+}
+#line 1343 "build/cminus.tab.c"
+    break;
+
+  case 18: /* param: type-specifier ID LBRACKET RBRACKET  */
+#line 108 "src/cminus.y"
+                                        {
+  (yyval.treeNode) = newParamNode(ctx);
+  setChild((yyval.treeNode), 0, (yyvsp[-3].treeNode));
+  getChild((yyval.treeNode), 0)->attr.val = 0;
+  (yyval.treeNode)->attr.name = (yyvsp[-2].identifier);
+  (yyval.treeNode)->type = (yyvsp[-3].treeNode)->type;
+}
+#line 1355 "build/cminus.tab.c"
+    break;
+
+  case 19: /* compound-stmt: LBRACE local-declarations statement-list RBRACE  */
+#line 116 "src/cminus.y"
+                                                               {
+  (yyval.treeNode) = newStmtNode(ctx, CompdK);
+  setChild((yyval.treeNode), 0, (yyvsp[-2].nodeList).head);
+  setChild((yyval.treeNode), 1, (yyvsp[-1].nodeList).head);
+}
+#line 1365 "build/cminus.tab.c"
+    break;
+
+  case 20: /* local-declarations: local-declarations var-declaration  */
+#line 122 "src/cminus.y"
+                                                       {
+  (yyval.nodeList) = appendNodeList((yyvsp[-1].nodeList), (yyvsp[0].treeNode));
+}
+#line 1373 "build/cminus.tab.c"
+    break;
+
+  case 21: /* local-declarations: %empty  */
+#line 124 "src/cminus.y"
+                {
+  (yyval.nodeList) = newNodeList(NULL);
+}
+#line 1381 "build/cminus.tab.c"
+    break;
+
+  case 22: /* statement-list: statement-list statement  */
+#line 128 "src/cminus.y"
+                                         {
+  (yyval.nodeList) = appendNodeList((yyvsp[-1].nodeList), (yyvsp[0].treeNode));
+}
+#line 1389 "build/cminus.tab.c"
+    break;
+
+  case 23: /* statement-list: %empty  */
+#line 130 "src/cminus.y"
+                {
+  (yyval.nodeList) = newNodeList(NULL);
+}
+#line 1397 "build/cminus.tab.c"
+    break;
+
+  case 24: /* statement: expression-stmt  */
+#line 133 "src/cminus.y"
+                           { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1403 "build/cminus.tab.c"
+    break;
+
+  case 25: /* statement: compound-stmt  */
+#line 134 "src/cminus.y"
+                  { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1409 "build/cminus.tab.c"
+    break;
+
+  case 26: /* statement: selection-stmt  */
+#line 135 "src/cminus.y"
+                   { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1415 "build/cminus.tab.c"
+    break;
+
+  case 27: /* statement: iteration-stmt  */
+#line 136 "src/cminus.y"
+                   { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1421 "build/cminus.tab.c"
+    break;
+
+  case 28: /* statement: return-stmt  */
+#line 137 "src/cminus.y"
+                { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1427 "build/cminus.tab.c"
+    break;
+
+  case 29: /* expression-stmt: expression SEMI  */
+#line 139 "src/cminus.y"
+                                 {
+  (yyval.treeNode) = (yyvsp[-1].treeNode);
+}
+#line 1435 "build/cminus.tab.c"
+    break;
+
+  case 30: /* expression-stmt: SEMI  */
+#line 141 "src/cminus.y"
+         {
+  (yyval.treeNode) = NULL;
+}
+#line 1443 "build/cminus.tab.c"
+    break;
+
+  case 31: /* selection-stmt: IF LPAREN expression RPAREN statement  */
+#line 145 "src/cminus.y"
+                                                      {
+  (yyval.treeNode) = newStmtNode(ctx, SelectK);
+  setChild((yyval.treeNode), 0, (yyvsp[-2].treeNode));
+  setChild((yyval.treeNode), 1, (yyvsp[0].treeNode));
+  (yyval.treeNode)->nChildren = 2;
+}
+#line 1454 "build/cminus.tab.c"
+    break;
+
+  case 32: /* selection-stmt: IF LPAREN expression RPAREN statement ELSE statement  */
+#line 150 "src/cminus.y"
+                                                                    {
+  (yyval.treeNode) = newStmtNode(ctx, SelectK);
+  setChild((yyval.treeNode), 0, (yyvsp[-4].treeNode));
+  setChild((yyval.treeNode), 1, (yyvsp[-2].treeNode));
+  setChild((yyval.treeNode), 2, (yyvsp[0].treeNode));
+}
+#line 1465 "build/cminus.tab.c"
+    break;
+
+  case 33: /* iteration-stmt: WHILE LPAREN expression RPAREN statement  */
+#line 157 "src/cminus.y"
+                                                         {
+  (yyval.treeNode) = newStmtNode(ctx, IterK);
+  setChild((yyval.treeNode), 0, (yyvsp[-2].treeNode));
+  setChild((yyval.treeNode), 1, (yyvsp[0].treeNode));
+}
+#line 1475 "build/cminus.tab.c"
+    break;
+
+  case 34: /* return-stmt: RETURN SEMI  */
+#line 163 "src/cminus.y"
+                         {
+  (yyval.treeNode) = newStmtNode(ctx, RetK);
+  (yyval.treeNode)->nChildren = 0;
+}
+#line 1484 "build/cminus.tab.c"
+    break;
+
+  case 35: /* return-stmt: RETURN expression SEMI  */
+#line 166 "src/cminus.y"
+                           {
+  (yyval.treeNode) = newStmtNode(ctx, RetK);
+  setChild((yyval.treeNode), 0, (yyvsp[-1].treeNode));
+}
+#line 1493 "build/cminus.tab.c"
+    break;
+
+  case 36: /* expression: var ASSIGN expression  */
+#line 171 "src/cminus.y"
+                                  {
+  (yyval.treeNode) = newExprNode(ctx, OpExprK);
+  setChild((yyval.treeNode), 0, (yyvsp[-2].treeNode));
+  setChild((yyval.treeNode), 1, (yyvsp[0].treeNode));
+  (yyval.treeNode)->attr.op = ASSIGN;
+}
+#line 1504 "build/cminus.tab.c"
+    break;
+
+  case 37: /* expression: simple-expression  */
+#line 176 "src/cminus.y"
+                      {
+  (yyval.treeNode) = (yyvsp[0].treeNode);
+}
+#line 1512 "build/cminus.tab.c"
+    break;
+
+  case 38: /* var: ID  */
+#line 180 "src/cminus.y"
+        {
+  (yyval.treeNode) = newExprNode(ctx, VarK);
+  (yyval.treeNode)->nChildren = 0;
+  (yyval.treeNode)->attr.name = (yyvsp[0].identifier);
+}
+#line 1522 "build/cminus.tab.c"
+    break;
+
+  case 39: /* var: ID LBRACKET expression RBRACKET  */
+#line 184 "src/cminus.y"
+                                    {
+  (yyval.treeNode) = newExprNode(ctx, OpExprK);
+  setChild((yyval.treeNode), 0, newExprNode(ctx, VarK));
+  getChild((yyval.treeNode), 0)->nChildren = 0;
+  getChild((yyval.treeNode), 0)->attr.name = (yyvsp[-3].identifier);
+  setChild((yyval.treeNode), 1, (yyvsp[-1].treeNode));
+  (yyval.treeNode)->attr.op = LBRACKET;
+}
+#line 1535 "build/cminus.tab.c"
+    break;
+
+  case 40: /* simple-expression: additive-expression relop additive-expression  */
+#line 193 "src/cminus.y"
+                                                                 {
+  (yyval.treeNode) = newExprNode(ctx, OpExprK);
+  setChild((yyval.treeNode), 0, (yyvsp[-2].treeNode));
+  setChild((yyval.treeNode), 1, (yyvsp[0].treeNode));
+  (yyval.treeNode)->attr.op = (yyvsp[-1].tok);
+}
+#line 1546 "build/cminus.tab.c"
+    break;
+
+  case 41: /* simple-expression: additive-expression  */
+#line 198 "src/cminus.y"
+                        { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1552 "build/cminus.tab.c"
+    break;
+
+  case 42: /* relop: LE  */
+#line 200 "src/cminus.y"
+          { (yyval.tok) = LE; }
+#line 1558 "build/cminus.tab.c"
+    break;
+
+  case 43: /* relop: LT  */
+#line 200 "src/cminus.y"
+                            { (yyval.tok) = LT; }
+#line 1564 "build/cminus.tab.c"
+    break;
+
+  case 44: /* relop: GT  */
+#line 200 "src/cminus.y"
+                                              { (yyval.tok) = GT; }
+#line 1570 "build/cminus.tab.c"
+    break;
+
+  case 45: /* relop: GE  */
+#line 200 "src/cminus.y"
+                                                                { (yyval.tok) = GE; }
+#line 1576 "build/cminus.tab.c"
+    break;
+
+  case 46: /* relop: EQ  */
+#line 201 "src/cminus.y"
+       { (yyval.tok) = EQ; }
+#line 1582 "build/cminus.tab.c"
+    break;
+
+  case 47: /* relop: NE  */
+#line 201 "src/cminus.y"
+                         { (yyval.tok) = NE; }
+#line 1588 "build/cminus.tab.c"
+    break;
+
+  case 48: /* additive-expression: additive-expression addop term  */
+#line 203 "src/cminus.y"
+                                                    {
+  (yyval.treeNode) = newExprNode(ctx, OpExprK);
+  setChild((yyval.treeNode), 0, (yyvsp[-2].treeNode));
+  setChild((yyval.treeNode), 1, (yyvsp[0].treeNode));
+  (yyval.treeNode)->attr.op = (yyvsp[-1].tok);
+}
+#line 1599 "build/cminus.tab.c"
+    break;
+
+  case 49: /* additive-expression: term  */
+#line 208 "src/cminus.y"
+         { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1605 "build/cminus.tab.c"
+    break;
+
+  case 50: /* addop: PLUS  */
+#line 210 "src/cminus.y"
+            { (yyval.tok) = PLUS; }
+#line 1611 "build/cminus.tab.c"
+    break;
+
+  case 51: /* addop: MINUS  */
+#line 210 "src/cminus.y"
+                                   { (yyval.tok) = MINUS; }
+#line 1617 "build/cminus.tab.c"
+    break;
+
+  case 52: /* term: term mulop factor  */
+#line 212 "src/cminus.y"
+                        {
+  (yyval.treeNode) = newExprNode(ctx, OpExprK);
+  setChild((yyval.treeNode), 0, (yyvsp[-2].treeNode));
+  setChild((yyval.treeNode), 1, (yyvsp[0].treeNode));
+  (yyval.treeNode)->attr.op = (yyvsp[-1].tok);
+}
+#line 1628 "build/cminus.tab.c"
+    break;
+
+  case 53: /* term: factor  */
+#line 217 "src/cminus.y"
+           { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1634 "build/cminus.tab.c"
+    break;
+
+  case 54: /* mulop: STAR  */
+#line 219 "src/cminus.y"
+            { (yyval.tok) = STAR; }
+#line 1640 "build/cminus.tab.c"
+    break;
+
+  case 55: /* mulop: SLASH  */
+#line 219 "src/cminus.y"
+                                   { (yyval.tok) = SLASH; }
+#line 1646 "build/cminus.tab.c"
+    break;
+
+  case 56: /* factor: LPAREN expression RPAREN  */
+#line 221 "src/cminus.y"
+                                 { (yyval.treeNode) = (yyvsp[-1].treeNode); }
+#line 1652 "build/cminus.tab.c"
+    break;
+
+  case 57: /* factor: var  */
+#line 222 "src/cminus.y"
+        { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1658 "build/cminus.tab.c"
+    break;
+
+  case 58: /* factor: call  */
+#line 222 "src/cminus.y"
+                            { (yyval.treeNode) = (yyvsp[0].treeNode); }
+#line 1664 "build/cminus.tab.c"
+    break;
+
+  case 59: /* factor: NUM  */
+#line 223 "src/cminus.y"
+        {
+    (yyval.treeNode) = newExprNode(ctx, ConstK);
+    (yyval.treeNode)->attr.val = (yyvsp[0].number);
+  }
+#line 1673 "build/cminus.tab.c"
+    break;
+
+  case 60: /* call: ID LPAREN args RPAREN  */
+#line 228 "src/cminus.y"
+                            {
+  (yyval.treeNode) = newExprNode(ctx, CallK);
+  setChild((yyval.treeNode), 0, (yyvsp[-1].treeNode));
+  (yyval.treeNode)->attr.name = (yyvsp[-3].identifier);
+}
+#line 1683 "build/cminus.tab.c"
+    break;
+
+  case 61: /* args: arg-list  */
+#line 234 "src/cminus.y"
+               { (yyval.treeNode) = (yyvsp[0].nodeList).head; }
+#line 1689 "build/cminus.tab.c"
+    break;
+
+  case 62: /* args: %empty  */
+#line 234 "src/cminus.y"
+                                               { (yyval.treeNode) = NULL; }
+#line 1695 "build/cminus.tab.c"
+    break;
+
+  case 63: /* arg-list: arg-list COMMA expression  */
+#line 235 "src/cminus.y"
+                                    {
+  (yyval.nodeList) = appendNodeList((yyvsp[-2].nodeList), (yyvsp[0].treeNode));
+}
+#line 1703 "build/cminus.tab.c"
+    break;
+
+  case 64: /* arg-list: expression  */
+#line 237 "src/cminus.y"
+               {
+  (yyval.nodeList) = newNodeList((yyvsp[0].treeNode));
+}
+#line 1711 "build/cminus.tab.c"
+    break;
+
+
+#line 1715 "build/cminus.tab.c"
+
+      default: break;
+    }
+  /* User semantic actions sometimes alter yychar, and that requires
+     that yytoken be updated with the new translation.  We take the
+     approach of translating immediately before every use of yytoken.
+     One alternative is translating here after every semantic action,
+     but that translation would be missed if the semantic action invokes
+     YYABORT, YYACCEPT, or YYERROR immediately after altering yychar or
+     if it invokes YYBACKUP.  In the case of YYABORT or YYACCEPT, an
+     incorrect destructor might then be invoked immediately.  In the
+     case of YYERROR or YYBACKUP, subsequent parser actions might lead
+     to an incorrect destructor call or verbose syntax error message
+     before the lookahead is translated.  */
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
+
+  YYPOPSTACK (yylen);
+  yylen = 0;
+
+  *++yyvsp = yyval;
+
+  /* Now 'shift' the result of the reduction.  Determine what state
+     that goes to, based on the state we popped back to and the rule
+     number reduced by.  */
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
+
+  goto yynewstate;
+
+
+/*--------------------------------------.
+| yyerrlab -- here on detecting error.  |
+`--------------------------------------*/
+yyerrlab:
+  /* Make sure we have latest lookahead translation.  See comments at
+     user semantic actions for why this is necessary.  */
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
+  /* If not already recovering from an error, report this error.  */
+  if (!yyerrstatus)
+    {
+      ++yynerrs;
+      yyerror (ctx, YY_("syntax error"));
+    }
+
+  if (yyerrstatus == 3)
+    {
+      /* If just tried and failed to reuse lookahead token after an
+         error, discard it.  */
+
+      if (yychar <= YYEOF)
+        {
+          /* Return failure if at end of input.  */
+          if (yychar == YYEOF)
+            YYABORT;
+        }
+      else
+        {
+          yydestruct ("Error: discarding",
+                      yytoken, &yylval, ctx);
+          yychar = YYEMPTY;
+        }
+    }
+
+  /* Else will try to reuse lookahead token after shifting the error
+     token.  */
+  goto yyerrlab1;
+
+
+/*---------------------------------------------------.
+| yyerrorlab -- error raised explicitly by YYERROR.  |
+`---------------------------------------------------*/
+yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
+
+  /* Do not reclaim the symbols of the rule whose action triggered
+     this YYERROR.  */
+  YYPOPSTACK (yylen);
+  yylen = 0;
+  YY_STACK_PRINT (yyss, yyssp);
+  yystate = *yyssp;
+  goto yyerrlab1;
+
+
+/*-------------------------------------------------------------.
+| yyerrlab1 -- common code for both syntax error and YYERROR.  |
+`-------------------------------------------------------------*/
+yyerrlab1:
+  yyerrstatus = 3;      /* Each real token shifted decrements this.  */
+
+  /* Pop stack until we find a state that shifts the error token.  */
+  for (;;)
+    {
+      yyn = yypact[yystate];
+      if (!yypact_value_is_default (yyn))
+        {
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
+            {
+              yyn = yytable[yyn];
+              if (0 < yyn)
+                break;
+            }
+        }
+
+      /* Pop the current state because it cannot handle the error token.  */
+      if (yyssp == yyss)
+        YYABORT;
+
+
+      yydestruct ("Error: popping",
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, ctx);
+      YYPOPSTACK (1);
+      yystate = *yyssp;
+      YY_STACK_PRINT (yyss, yyssp);
+    }
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+
+
+  /* Shift the error token.  */
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
+
+  yystate = yyn;
+  goto yynewstate;
+
+
+/*-------------------------------------.
+| yyacceptlab -- YYACCEPT comes here.  |
+`-------------------------------------*/
+yyacceptlab:
+  yyresult = 0;
+  goto yyreturnlab;
+
+
+/*-----------------------------------.
+| yyabortlab -- YYABORT comes here.  |
+`-----------------------------------*/
+yyabortlab:
+  yyresult = 1;
+  goto yyreturnlab;
+
+
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
+yyexhaustedlab:
+  yyerror (ctx, YY_("memory exhausted"));
+  yyresult = 2;
+  goto yyreturnlab;
+
+
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
+  if (yychar != YYEMPTY)
+    {
+      /* Make sure we have latest lookahead translation.  See comments at
+         user semantic actions for why this is necessary.  */
+      yytoken = YYTRANSLATE (yychar);
+      yydestruct ("Cleanup: discarding lookahead",
+                  yytoken, &yylval, ctx);
+    }
+  /* Do not reclaim the symbols of the rule whose action triggered
+     this YYABORT or YYACCEPT.  */
+  YYPOPSTACK (yylen);
+  YY_STACK_PRINT (yyss, yyssp);
+  while (yyssp != yyss)
+    {
+      yydestruct ("Cleanup: popping",
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, ctx);
+      YYPOPSTACK (1);
+    }
+#ifndef yyoverflow
+  if (yyss != yyssa)
+    YYSTACK_FREE (yyss);
+#endif
+
+  return yyresult;
+}
+
+#line 241 "src/cminus.y"
+
+
+static int yyerror(CompileContext *ctx, char const *message) {
+  TokenType token = ctx->scan->lastToken;
+  if(token == LEX_ERROR) fprintf(ctx->listing, "Syntax error due to Lexical error\n");
+  else {
+    fprintf(ctx->listing, "Syntax error at line %d: %s\n", ctx->lineno, message);
+    fprintf(ctx->listing, "Current token: ");
+    printToken(ctx, token, ctx->scan->tokenSlice);
+    ctx->Error = TRUE;
+  }
+  return 0;
+}
+
+static int yylex(YYSTYPE *lval, CompileContext *ctx) {
+  TokenType tok = getToken(ctx, lval);
+  if(ctx->Error) tok = LEX_ERROR;
+  ctx->scan->lastToken = tok;
+  return tok;
+}
+
+TreeNode *parse(CompileContext *ctx) {
+  yyparse(ctx);
+  return ctx->syntaxTree;
+}
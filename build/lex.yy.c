@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <regex.h>
+#include <pthread.h>
+typedef size_t yy_size_t;
+struct yy_buffer_state { char *base; size_t size; int owned; };
+typedef struct yy_buffer_state *YY_BUFFER_STATE;
+#define YY_END_OF_BUFFER_CHAR 0
+#define YY_BUF_SIZE 16384
+#define YY_EXTRA_TYPE CompileContext *
+  #include "globals.h"
+  #include "util.h"
+  #include "scan.h"
+  #include "atom.h"
+  #include "cminus.tab.h"
+  #include "arena.h"
+
+  enum _ErrorType {
+      NO_ERROR, INVALID_TOKEN_ERROR, COMMENT_ERROR
+  };
+
+  static void _printToken(CompileContext *ctx, TokenType);
+struct yyguts_t { FILE *yyin_r, *yyout_r; char *yytext_r; int yyleng_r; char *cur; char *end; char hold; int held; YY_BUFFER_STATE buf; YY_EXTRA_TYPE extra; void *lval; };
+typedef void *yyscan_t;
+#define yyin (((struct yyguts_t*)yyscanner)->yyin_r)
+#define yyout (((struct yyguts_t*)yyscanner)->yyout_r)
+#define yytext (((struct yyguts_t*)yyscanner)->yytext_r)
+#define yyleng (((struct yyguts_t*)yyscanner)->yyleng_r)
+#define yyextra (((struct yyguts_t*)yyscanner)->extra)
+
+#define yylval ((YYSTYPE*)((struct yyguts_t*)yyscanner)->lval)
+static regex_t yy_re[31]; static int yy_re_init;
+static const char *yy_pat[] = {"^((\n))", "^(([ \t]+))", "^(else)", "^(if)", "^(int)", "^(return)", "^(void)", "^(while)", "^(\\+)", "^(-)", "^(\\*)", "^(\\/)", "^(<)", "^(<=)", "^(>)", "^(>=)", "^(==)", "^(!=)", "^(=)", "^(;)", "^(,)", "^(\\()", "^(\\))", "^(\\[)", "^(\\])", "^(\\{)", "^(\\})", "^((([A-Za-z])+))", "^((([0-9])+))", "^(\\/\\*)", "^([^\n])"};
+static void yy_unhold(yyscan_t yyscanner) { if(((struct yyguts_t*)yyscanner)->held) { *((struct yyguts_t*)yyscanner)->cur = ((struct yyguts_t*)yyscanner)->hold; ((struct yyguts_t*)yyscanner)->held = 0; } }
+static void yy_load(yyscan_t yyscanner) {
+  if(((struct yyguts_t*)yyscanner)->buf) return;
+  FILE *f = yyin; if(!f) f = stdin;
+  size_t cap = 4096, n = 0; char *b = malloc(cap + 2); size_t r;
+  while((r = fread(b + n, 1, cap - n, f)) > 0) { n += r; if(n == cap) { cap *= 2; b = realloc(b, cap + 2); } }
+  b[n] = 0; b[n+1] = 0;
+  ((struct yyguts_t*)yyscanner)->buf = malloc(sizeof(struct yy_buffer_state)); ((struct yyguts_t*)yyscanner)->buf->base = b; ((struct yyguts_t*)yyscanner)->buf->size = n; ((struct yyguts_t*)yyscanner)->buf->owned = 1; ((struct yyguts_t*)yyscanner)->cur = b; ((struct yyguts_t*)yyscanner)->end = b + n;
+}
+YY_BUFFER_STATE yy_scan_buffer(char *base, yy_size_t size, yyscan_t yyscanner) {
+  YY_BUFFER_STATE bs = malloc(sizeof(struct yy_buffer_state)); bs->base = base; bs->size = size - 2; bs->owned = 0;
+  ((struct yyguts_t*)yyscanner)->buf = bs; ((struct yyguts_t*)yyscanner)->cur = base; ((struct yyguts_t*)yyscanner)->end = base + size - 2; ((struct yyguts_t*)yyscanner)->held = 0; return bs;
+}
+void yy_delete_buffer(YY_BUFFER_STATE b, yyscan_t yyscanner) { if(!b) return; if(b->owned) free(b->base); if(((struct yyguts_t*)yyscanner)->buf == b) ((struct yyguts_t*)yyscanner)->buf = NULL; free(b); }
+void yyrestart(FILE *f, yyscan_t yyscanner) { yy_delete_buffer(((struct yyguts_t*)yyscanner)->buf, yyscanner); yyin = f; }
+static int input(yyscan_t yyscanner) {
+  yy_unhold(yyscanner); if(((struct yyguts_t*)yyscanner)->cur >= ((struct yyguts_t*)yyscanner)->end) return EOF; return (unsigned char)*((struct yyguts_t*)yyscanner)->cur++;
+}
+static void yyunput_unused(void) { (void)input; }
+int yylex_init_extra(YY_EXTRA_TYPE e, yyscan_t *s) { struct yyguts_t *g = calloc(1, sizeof *g); g->extra = e; *s = g; return 0; }
+int yylex_init(yyscan_t *s) { return yylex_init_extra(0, s); }
+int yylex_destroy(yyscan_t yyscanner) { yy_delete_buffer(((struct yyguts_t*)yyscanner)->buf, yyscanner); free(yyscanner); return 0; }
+YY_EXTRA_TYPE yyget_extra(yyscan_t yyscanner) { return yyextra; }
+void yyset_extra(YY_EXTRA_TYPE e, yyscan_t yyscanner) { yyextra = e; }
+char *yyget_text(yyscan_t yyscanner) { return yytext; }
+int yyget_leng(yyscan_t yyscanner) { return yyleng; }
+void yyset_in(FILE *f, yyscan_t yyscanner) { yyin = f; }
+void yyset_out(FILE *f, yyscan_t yyscanner) { yyout = f; }
+int yylex(YYSTYPE *yylval_param, yyscan_t yyscanner) {
+  ((struct yyguts_t*)yyscanner)->lval = yylval_param;
+  int k; { static pthread_mutex_t m = PTHREAD_MUTEX_INITIALIZER; pthread_mutex_lock(&m); if(!yy_re_init) { for(k=0;k<31;++k) if(regcomp(&yy_re[k], yy_pat[k], REG_EXTENDED)) { fprintf(stderr, "bad re %s\n", yy_pat[k]); exit(2);} yy_re_init = 1; } pthread_mutex_unlock(&m); }
+  yy_load(yyscanner); yy_unhold(yyscanner);
+  for(;;) {
+    yy_unhold(yyscanner);
+    if(((struct yyguts_t*)yyscanner)->cur >= ((struct yyguts_t*)yyscanner)->end) {
+      yytext = ((struct yyguts_t*)yyscanner)->cur; yyleng = 0;
+      { 
+  return ENDFILE;
+}
+      return 0;
+    }
+    int best = -1; int blen = 0; regmatch_t m; char win[512]; size_t wl = ((struct yyguts_t*)yyscanner)->end - ((struct yyguts_t*)yyscanner)->cur; if(wl > 511) wl = 511; memcpy(win, ((struct yyguts_t*)yyscanner)->cur, wl); win[wl] = 0;
+    for(k=0;k<31;++k) { if(regexec(&yy_re[k], win, 1, &m, 0) == 0 && m.rm_so == 0 && (int)m.rm_eo > blen) { best = k; blen = m.rm_eo; } }
+    if(best < 0) { best = 30; blen = 1; }
+    yytext = ((struct yyguts_t*)yyscanner)->cur; yyleng = blen; ((struct yyguts_t*)yyscanner)->cur += blen; ((struct yyguts_t*)yyscanner)->hold = *((struct yyguts_t*)yyscanner)->cur; *((struct yyguts_t*)yyscanner)->cur = 0; ((struct yyguts_t*)yyscanner)->held = 1;
+    switch(best) {
+    case 0:
+{ ++yyextra->lineno; }
+    break;
+    case 1:
+{/* skip whitespace */}
+    break;
+    case 2:
+return ELSE;
+    break;
+    case 3:
+return IF;
+    break;
+    case 4:
+return INT;
+    break;
+    case 5:
+return RETURN;
+    break;
+    case 6:
+return VOID;
+    break;
+    case 7:
+return WHILE;
+    break;
+    case 8:
+return PLUS;
+    break;
+    case 9:
+return MINUS;
+    break;
+    case 10:
+return STAR;
+    break;
+    case 11:
+return SLASH;
+    break;
+    case 12:
+return LT;
+    break;
+    case 13:
+return LE;
+    break;
+    case 14:
+return GT;
+    break;
+    case 15:
+return GE;
+    break;
+    case 16:
+return EQ;
+    break;
+    case 17:
+return NE;
+    break;
+    case 18:
+return ASSIGN;
+    break;
+    case 19:
+return SEMI;
+    break;
+    case 20:
+return COMMA;
+    break;
+    case 21:
+return LPAREN;
+    break;
+    case 22:
+return RPAREN;
+    break;
+    case 23:
+return LBRACKET;
+    break;
+    case 24:
+return RBRACKET;
+    break;
+    case 25:
+return LBRACE;
+    break;
+    case 26:
+return RBRACE;
+    break;
+    case 27:
+{ yylval->identifier = internName(yyextra, yytext, yyleng); return ID; }
+    break;
+    case 28:
+{ yylval->number = atoi(yytext); return NUM; }
+    break;
+    case 29:
+{
+  int ch;
+  int flag = 0;
+  while((ch = input(yyscanner)) != EOF) {
+    if(ch == '*') {
+      flag = 1;
+    }
+    else if(flag == 1 && ch == '/') {
+      break;
+    }
+    else {
+      flag = 0;
+      if(ch == '\n') ++yyextra->lineno;
+    }
+  }
+  if(ch == EOF) {
+    yyextra->scan->errorType = COMMENT_ERROR;
+    yyextra->Error = TRUE;
+    return ERROR;
+  }
+}
+    break;
+    case 30:
+{
+  yyextra->scan->errorType = INVALID_TOKEN_ERROR;
+  yyextra->Error = TRUE;
+  return ERROR;
+}
+    break;
+    }
+  }
+}
+
+
+void scanSourceText(CompileContext *ctx, SourceText *text) {
+  struct ScanState *scan = arenaAlloc(ctx->arena, sizeof(struct ScanState));
+  yyscan_t scanner;
+
+  if(scan == NULL || yylex_init_extra(ctx, &scanner) != 0) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  scan->scanner = scanner;
+  scan->sourceText = text->base;
+  scan->tokenSlice.offset = 0;
+  scan->tokenSlice.length = 0;
+  scan->lastToken = ENDFILE;
+  scan->errorType = NO_ERROR;
+  ctx->scan = scan;
+  scan->buffer = yy_scan_buffer(text->base, text->size + 2, scanner);
+  yyset_out(ctx->listing, scanner);
+}
+
+void closeScanner(CompileContext *ctx) {
+  struct ScanState *scan = ctx->scan;
+  if(scan == NULL) return;
+  if(scan->buffer != NULL) yy_delete_buffer(scan->buffer, scan->scanner);
+  yylex_destroy(scan->scanner);
+  ctx->scan = NULL;
+}
+
+TokenType getToken(CompileContext *ctx, YYSTYPE *lval) {
+  struct ScanState *scan = ctx->scan;
+  TokenType currentToken = yylex(lval, scan->scanner);
+  scan->tokenSlice.offset =
+    yyget_text(scan->scanner) - scan->sourceText;
+  scan->tokenSlice.length = yyget_leng(scan->scanner);
+  _printToken(ctx, currentToken);
+  return currentToken;
+}
+
+static char const *getErrorText(enum _ErrorType errorType) {
+  if(errorType == COMMENT_ERROR) return "Comment Error";
+  else if(errorType == INVALID_TOKEN_ERROR) return "Invalid Token Error";
+  return "-- Unknown Error";
+}
+
+static void _printToken(CompileContext *ctx, TokenType currentToken) {
+  FILE *listing = ctx->listing;
+  struct ScanState *scan = ctx->scan;
+
+  if(TRACING(ctx, TraceScan)) {
+    fprintf(listing, "\t%d\t\t", ctx->lineno);
+    fprintf(listing, "%s\t\t", getTokenName(currentToken));
+    if(currentToken == ERROR) {
+      fprintf(listing, "%s\n", getErrorText(scan->errorType));
+    }
+    else {
+      fprintf(listing, "%.*s\n", scan->tokenSlice.length,
+              SLICE_TEXT(ctx, scan->tokenSlice));
+    }
+  }
+
+  if(currentToken == ERROR) {
+    fprintf(listing, "Lexical error at line %d\n", ctx->lineno);
+    fprintf(listing, "%s\n", getErrorText(scan->errorType));
+  }
+}
\ No newline at end of file
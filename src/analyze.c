@@ -2,108 +2,385 @@
 #include "util.h"
 #include "symtab.h"
 #include "analyze.h"
+#include "atom.h"
+#include "arena.h"
+
+#include <pthread.h>
+
+#define ERROR_MSG(a, b, c) (analyzeErrorMsg(ctx, a, b, c))
+#define SYMTAB_ERROR(a, b, c) symtabError(ctx, a, b, c)
+#define TYPE_ERROR(a, b, c) do { deferTypeError(ctx, a, b, c); return; } while(0)
+
+#define NO_BINDING (-1)
+
+/* A binding makes a symbol visible under its name until
+ * the scope declaring it is exited; the bindings of one
+ * name are chained from the innermost outwards
+ */
+struct BindingRec {
+  struct SymbolRec *sym;
+  unsigned atom; /* atomId of the name */
+  ScopeIndex scope;
+  int shadowed; /* next outer binding of the name */
+  int order; /* top-level declaration it was made in */
+};
+
+/* An error found by a walk that cannot report it yet */
+struct ErrorRec {
+  int found;
+  enum AnalyzeError err;
+  int lineno;
+  char msg[128];
+};
+
+/* A reference from a function body to a global symbol,
+ * added to its line list once the bodies are merged */
+struct GlobalRef {
+  struct SymbolRec *sym;
+  int lineno;
+};
+
+/* A unit is one function analyzed on its own by
+ * analyzeFunctions, against the global scope as it was
+ * when the function was declared
+ */
+struct UnitRec {
+  TreeNode *fnode;
+  int order; /* position among the top-level declarations */
+
+  /* the scopes of the function; scopes[0] stands
+     for the global scope */
+  struct ScopeRec *scopes;
+  int nScopes;
+
+  /* nodes whose scope field holds an index into scopes */
+  TreeNode **patch;
+  int nPatch;
+  int capPatch;
+
+  struct GlobalRef *refs;
+  int nRefs;
+  int capRefs;
+
+  struct ErrorRec symtabError;
+  struct ErrorRec typeError;
+};
+
+/* AnalyzeState is the analyzer part of a CompileContext */
+struct AnalyzeState {
+  /* Whole list of scopes created so far, grown on demand */
+  /* scopes[0] EQUALS the global scope */
+  struct ScopeRec *scopes;
+  int nScopes;
+  int capScopes;
+
+  /* innermost open scope; the enclosing ones
+     are reached through the parent links */
+  ScopeIndex currentScope;
+
+  /* bindings in the order they were made; the ones of a
+     scope are popped when it is exited */
+  struct BindingRec *bindings;
+  int nBindings;
+  int capBindings;
+
+  /* innermost binding of every atom, NO_BINDING if
+     the name is not visible */
+  int *visible;
+  unsigned nVisible;
+
+  /* indicates that you are analyzing a function */
+  int functionFlag;
+
+  /* indicates that you are in the middle of,
+     or done with analyzing the main function */
+  int mainFlag;
+
+  /* 1: global scope */
+  /* 0: function scope */
+
+  int scopeIdCounter;
+  int functionLocCounter;
+
+  TreeNode *funcNode;
+
+  /* top-level declaration being analyzed */
+  int order;
+
+  /* set while analyzing a unit: the state holding
+     the global scope, and the unit itself */
+  struct AnalyzeState *globals;
+  struct UnitRec *unit;
+
+  /* symbol table errors are kept here instead of being
+     reported, unless it is NULL */
+  struct ErrorRec *symtabError;
+
+  /* the first type error, held back until reportTypeError */
+  struct ErrorRec typeError;
+};
+
+static void buildSymtab_pre(CompileContext *ctx, TreeNode *tnode);
+static void buildSymtab_post(CompileContext *ctx, TreeNode *tnode);
+static void typeCheck_pre(CompileContext *ctx, TreeNode *tnode);
+static void typeCheck_post(CompileContext *ctx, TreeNode *tnode);
+
+/* The tree is analyzed in a single walk: every node is
+ * resolved and then type checked.  Type errors do not end
+ * the walk, only type checking, because a symbol table
+ * error anywhere in the program is reported before them.
+ */
+static void analyzeNode(CompileContext *ctx, TreeNode *tnode);
+
+static void analyzeSiblings(CompileContext *ctx, TreeNode *tnode) {
+  while (tnode != NULL) {
+    analyzeNode(ctx, tnode);
+    tnode = getSibling(tnode);
+  }
+}
 
-#define MAX_SCOPES_COUNT 50
-#define MAX_SCOPE_DEPTH 20
-#define ERROR_MSG(a, b, c) (analyzeErrorMsg(a, b, c))
-
-typedef void (*TraverseFunc)(TreeNode *);
+static void analyzeNode(CompileContext *ctx, TreeNode *tnode) {
+  buildSymtab_pre(ctx, tnode);
+  typeCheck_pre(ctx, tnode);
+  int i;
+  for (i = 0; i < tnode->nChildren; ++i) {
+    analyzeSiblings(ctx, getChild(tnode, i));
+  }
+  buildSymtab_post(ctx, tnode);
+  if (!ctx->analyze->typeError.found) typeCheck_post(ctx, tnode);
+}
 
-/* Whole list of scopes created so far */
-/* scopeWholeLilst[0] EQUALS the global scope */
-static struct ScopeRec scopeWholeList[MAX_SCOPES_COUNT];
-static int len_scopeWholeList;
+static void keepError(struct ErrorRec *error, enum AnalyzeError err, int lineno,
+                      char const *msg) {
+  error->found = 1;
+  error->err = err;
+  error->lineno = lineno;
+  snprintf(error->msg, sizeof(error->msg), "%s", msg);
+}
 
-/* for referencing parent scopes */
-static struct ScopeRec *scopeStack[MAX_SCOPE_DEPTH];
-static int h_scopeStack;
+static void reportError(CompileContext *ctx, struct ErrorRec const *error) {
+  ERROR_MSG(error->err, error->lineno, error->msg);
+  abortCompile(ctx);
+}
 
-/* indicates that you are analyzing a function */
-static int functionFlag;
+static void deferTypeError(CompileContext *ctx, enum AnalyzeError err, int lineno,
+                           char const *msg) {
+  keepError(&ctx->analyze->typeError, err, lineno, msg);
+}
 
-/* indicates that you are in the middle of,
-   or done with analyzing the main function */
-static int mainFlag;
+/* a symbol table error ends the walk; it is reported at
+ * once unless the walk keeps its errors for later */
+static void symtabError(CompileContext *ctx, enum AnalyzeError err, int lineno,
+                        char const *msg) {
+  if(ctx->analyze->symtabError != NULL) keepError(ctx->analyze->symtabError, err, lineno, msg);
+  else ERROR_MSG(err, lineno, msg);
+  abortCompile(ctx);
+}
 
-/* 1: global scope */
-/* 0: function scope */
+/* Function growArray returns a copy of an array from the
+ * arena with twice the capacity, or first elements for an
+ * empty one; the old array stays behind in the arena until
+ * the compilation ends
+ */
+static void *growArray(Arena arena, void *array, int n, int *cap, int first, size_t size) {
+  int newCap = *cap ? *cap * 2 : first;
+  void *grown = arenaAlloc(arena, newCap * size);
+  if(grown == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  if(n > 0) memcpy(grown, array, n * size);
+  *cap = newCap;
+  return grown;
+}
 
-static int scopeIdCounter;
-static int functionLocCounter;
+struct ScopeRec *scopeAt(CompileContext *ctx, ScopeIndex i) {
+  return &ctx->analyze->scopes[i];
+}
 
-static char* funcName;
+static struct ScopeRec *getCurrentScope(CompileContext *ctx) {
+  return scopeAt(ctx, ctx->analyze->currentScope);
+}
 
-static TreeNode *externDecl = NULL;
+static struct ScopeRec *getPrevScope(CompileContext *ctx) {
+  return scopeAt(ctx, getCurrentScope(ctx)->parent);
+}
 
-static void NOOP(TreeNode *_) {
-  /* DO NOTHING */
+static struct BindingRec *lookupBinding(CompileContext *ctx, char const *name) {
+  struct AnalyzeState *state = ctx->analyze;
+  unsigned atom = atomId(name);
+  if(atom >= state->nVisible) return NULL;
+  int b = state->visible[atom];
+  if(b != NO_BINDING) return &state->bindings[b];
+
+  // a unit sees the globals declared up to its own function
+  if(state->globals != NULL) {
+    b = state->globals->visible[atom];
+    if(b != NO_BINDING && state->globals->bindings[b].order <= state->order) {
+      return &state->globals->bindings[b];
+    }
+  }
+  return NULL;
 }
 
-static void traverseSiblings(
-    TreeNode *tnode, TraverseFunc funcPre, TraverseFunc funcPost);
-static void traverseSingle(
-    TreeNode *tnode, TraverseFunc funcPre, TraverseFunc funcPost);
+static void pushBinding(CompileContext *ctx, struct SymbolRec *sym) {
+  struct AnalyzeState *state = ctx->analyze;
+  struct BindingRec *binding;
 
-static void traverseSiblings(
-    TreeNode *tnode, TraverseFunc funcPre, TraverseFunc funcPost) {
-  while (tnode != NULL) {
-    traverseSingle(tnode, funcPre, funcPost);
-    tnode = tnode->sibling;
+  if(state->nBindings == state->capBindings) {
+    state->bindings = growArray(ctx->arena, state->bindings, state->nBindings,
+                                &state->capBindings, 256, sizeof(struct BindingRec));
   }
+
+  binding = &state->bindings[state->nBindings];
+  binding->sym = sym;
+  binding->atom = atomId(getTreeNode(sym)->attr.name);
+  binding->scope = state->currentScope;
+  binding->order = state->order;
+  binding->shadowed = state->visible[binding->atom];
+  state->visible[binding->atom] = state->nBindings++;
 }
 
-static void traverseSingle(
-    TreeNode *tnode, TraverseFunc funcPre, TraverseFunc funcPost) {
-  funcPre(tnode);
-  int i;
-  for (i = 0; i < tnode->nChildren; ++i) {
-    traverseSiblings(tnode->child[i], funcPre, funcPost);
+static void popBindings(struct AnalyzeState *state, int first) {
+  while(state->nBindings > first) {
+    struct BindingRec *binding = &state->bindings[--state->nBindings];
+    state->visible[binding->atom] = binding->shadowed;
   }
-  funcPost(tnode);
 }
 
-static struct SymbolRec *lookupSymbol(char const *name) {
-  int i = h_scopeStack - 1;
-  while(i >= 0) {
-    struct ScopeRec *scope = scopeStack[i];
-    struct SymbolRec *sym = st_lookup(scope->symtab, name);
-    if (sym != NULL) {
-      return sym;
+/* the table of a scope is made on its first symbol, as
+ * most block scopes declare nothing */
+static void insertSymbol(CompileContext *ctx, struct ScopeRec *scope, struct SymbolRec *sym) {
+  if(scope->symtab == NULL) scope->symtab = constructSymtab(ctx->arena);
+  st_insert(ctx->arena, scope->symtab, sym);
+  pushBinding(ctx, sym);
+}
+
+/* a unit keeps track of the nodes it points at its own
+ * scopes, which move when the units are merged */
+static void setScope(CompileContext *ctx, TreeNode *tnode, ScopeIndex scope) {
+  struct UnitRec *unit = ctx->analyze->unit;
+
+  tnode->scope = scope;
+  if(unit != NULL && scope > 0) {
+    if(unit->nPatch == unit->capPatch) {
+      unit->patch = growArray(ctx->arena, unit->patch, unit->nPatch,
+                              &unit->capPatch, 64, sizeof(TreeNode *));
     }
-    --i;
-  } 
-  return NULL;
+    unit->patch[unit->nPatch++] = tnode;
+  }
 }
 
-static void enterExistingScope(struct ScopeRec *scope) {
-  scopeStack[h_scopeStack] = scope;
-  ++h_scopeStack;
+/* references are only wanted for the symbol table listing;
+ * a unit leaves those of global symbols to the merge */
+static void addReference(CompileContext *ctx, struct BindingRec *binding, int lineno) {
+  struct UnitRec *unit = ctx->analyze->unit;
+
+  if(unit != NULL && binding->scope == 0) {
+    if(unit->nRefs == unit->capRefs) {
+      unit->refs = growArray(ctx->arena, unit->refs, unit->nRefs,
+                             &unit->capRefs, 64, sizeof(struct GlobalRef));
+    }
+    unit->refs[unit->nRefs].sym = binding->sym;
+    unit->refs[unit->nRefs].lineno = lineno;
+    ++unit->nRefs;
+  }
+  else addLineno(ctx->arena, binding->sym, lineno);
 }
 
-static void enterScope(void) {
-  struct ScopeRec *new_scope = &scopeWholeList[len_scopeWholeList++];
-  new_scope->scopeId = scopeIdCounter++;
-  new_scope->scopeDepth = h_scopeStack;
-  new_scope->symtab = constructSymtab();
-  
-  enterExistingScope(new_scope);
+static void enterScope(CompileContext *ctx) {
+  struct AnalyzeState *state = ctx->analyze;
+  struct ScopeRec *new_scope;
+
+  if(state->nScopes == state->capScopes) {
+    state->scopes = growArray(ctx->arena, state->scopes, state->nScopes,
+                              &state->capScopes, 64, sizeof(struct ScopeRec));
+  }
+
+  new_scope = &state->scopes[state->nScopes];
+  new_scope->scopeId = state->scopeIdCounter++;
+  new_scope->scopeDepth = state->currentScope == NO_SCOPE ? 0 : getCurrentScope(ctx)->scopeDepth + 1;
+  new_scope->parent = state->currentScope;
+  new_scope->firstBinding = state->nBindings;
+  new_scope->symtab = NULL;
+
+  state->currentScope = state->nScopes++;
 }
 
-static struct ScopeRec *exitScope() {
-  struct ScopeRec *exitingScope = scopeStack[--h_scopeStack];
+static ScopeIndex exitScope(CompileContext *ctx) {
+  struct AnalyzeState *state = ctx->analyze;
+  ScopeIndex exitingScope = state->currentScope;
+
+  // the names declared in the scope go out of sight
+  popBindings(state, getCurrentScope(ctx)->firstBinding);
+  state->currentScope = getCurrentScope(ctx)->parent;
 
   return exitingScope;
 }
 
-static struct ScopeRec *getPrevScope() {
-  return scopeStack[h_scopeStack - 2];
+/* a function is declared in the global scope ... */
+static void declareFunction(CompileContext *ctx, TreeNode *tnode) {
+  char _buf[128];
+  char const *name = tnode->attr.name;
+  struct BindingRec *binding = lookupBinding(ctx, name);
+
+  if(binding != NULL && binding->scope == ctx->analyze->currentScope) {
+    // symbol already defined
+    sprintf(_buf, "symbol '%s' is already defined at line %d.", name, getDeclLineno(binding->sym));
+    SYMTAB_ERROR(SYMBOL_REDIFINITION, tnode->lineno, _buf);
+  }
+
+  insertSymbol(ctx, getCurrentScope(ctx), newSymbol(ctx->arena, tnode, ctx->analyze->functionLocCounter));
+  ++ctx->analyze->functionLocCounter;
+
+  if(ctx->analyze->mainFlag) {
+    // this function appears after the main function
+    SYMTAB_ERROR(MAIN_FUNCTION_MUST_APPEAR_LAST, tnode->lineno, "");
+  }
+
+  // check if 'main' function
+  if(name == internString(ctx, "main")) {
+    if(tnode->type != VoidK) {
+      // return type is not 'void'
+      SYMTAB_ERROR(MAIN_FUNCTION_RETURN_TYPE_MUST_BE_VOID, tnode->lineno, "");
+    }
+    if(getChild(tnode, 1)->nChildren > 0) {
+      // non-void parameters
+      SYMTAB_ERROR(MAIN_FUNCTION_PAARM_TYPE_MUST_BE_VOID, tnode->lineno, "");
+    }
+
+    // no error, this is the valid main function
+    ctx->analyze->mainFlag = 1;
+  }
 }
 
-static struct ScopeRec *getCurrentScope() {
-  return scopeStack[h_scopeStack - 1];
+/* ... and its parameters and body in a scope of its own */
+static void enterFunction(CompileContext *ctx, TreeNode *tnode) {
+  ctx->analyze->functionFlag = 1;
+  enterScope(ctx);
+
+  // calculate address of top address of topmost parameter
+  int nParams = 0;
+  TreeNode *paramNode = getChild(tnode, 1);
+  if(paramNode->nChildren > 0) {
+    while(paramNode != NULL) {
+      ++nParams;
+      paramNode = getSibling(paramNode);
+    }
+  }
+
+  getCurrentScope(ctx)->stackCounter = 4 + 4*nParams;
 }
 
-static void buildSymtab_pre(TreeNode *tnode) {
+static void buildSymtab_pre(CompileContext *ctx, TreeNode *tnode) {
+  /** Function Declaration **/
+  if(tnode->nodekind == DeclK && tnode->kind.decl == FunDeclK) {
+    // the function of a unit has been declared by analyzeFunctions
+    if(ctx->analyze->unit == NULL) declareFunction(ctx, tnode);
+    enterFunction(ctx, tnode);
+    return;
+  }
+
   /* **** INSERT NEW SYMBOLS **** */
   switch(tnode->nodekind) {
   case ParamK:
@@ -118,37 +395,26 @@ static void buildSymtab_pre(TreeNode *tnode) {
     char _buf[128];
 
     char const *name = tnode->attr.name;
-    struct ScopeRec *scope = getCurrentScope();
+    struct ScopeRec *scope = getCurrentScope(ctx);
+    struct BindingRec *binding = lookupBinding(ctx, name);
     struct SymbolRec *sym;
 
-    sym = st_lookup(getCurrentScope()->symtab, name);
-    if(sym != NULL) {
+    if(binding != NULL && binding->scope == ctx->analyze->currentScope) {
       // symbol already defined
-      sprintf(_buf, "symbol '%s' is already defined at line %d.", name, getDeclLineno(sym));
-      ERROR_MSG(SYMBOL_REDIFINITION, tnode->lineno, _buf);
-      exit(-1);
-    }
-
-    /** Function Declaration **/
-    if(tnode->nodekind == DeclK && tnode->kind.decl == FunDeclK) {
-      sym = newSymbol(tnode, functionLocCounter);
-      st_insert(scope->symtab, sym);
-
-      ++functionLocCounter;
+      sprintf(_buf, "symbol '%s' is already defined at line %d.", name, getDeclLineno(binding->sym));
+      SYMTAB_ERROR(SYMBOL_REDIFINITION, tnode->lineno, _buf);
     }
 
     /** Variable Declaration **/
-    else if(tnode->nodekind == DeclK && tnode->kind.decl == VarDeclK) {
+    if(tnode->nodekind == DeclK) {
       if(tnode->type == VoidK) {
         sprintf(_buf, "variable '%s' cannot be of type 'void'.", name);
-        ERROR_MSG(VARIABLE_HAS_INCOMPLETE_TYPE, tnode->lineno, _buf);
-        exit(-1);
+        SYMTAB_ERROR(VARIABLE_HAS_INCOMPLETE_TYPE, tnode->lineno, _buf);
       }
 
-      int arrSize = tnode->child[0]->attr.val;
+      int arrSize = getChild(tnode, 0)->attr.val;
       if(arrSize == 0) {
-        ERROR_MSG(ZERO_SIZED_ARRAY_DECLARATION, tnode->lineno, "");
-        exit(-1);
+        SYMTAB_ERROR(ZERO_SIZED_ARRAY_DECLARATION, tnode->lineno, "");
       }
       if(arrSize == -1) arrSize = 1;
 
@@ -156,30 +422,29 @@ static void buildSymtab_pre(TreeNode *tnode) {
       if(scope->scopeId > 0) {
         scope->stackCounter -= 4 * arrSize;
         scope->blockSize += 4* arrSize;
-        sym = newSymbol(tnode, scope->stackCounter);
+        sym = newSymbol(ctx->arena, tnode, scope->stackCounter);
       }
       /* global variable symbols */
       else {
         scope->stackCounter += 4 * arrSize;
-        sym = newSymbol(tnode, scope->stackCounter);
+        sym = newSymbol(ctx->arena, tnode, scope->stackCounter);
       }
 
-      tnode->scope_ref = getCurrentScope();
-      st_insert(scope->symtab, sym);
+      setScope(ctx, tnode, ctx->analyze->currentScope);
+      insertSymbol(ctx, scope, sym);
     }
     // parameter
     else {
       if(tnode->type == VoidK) {
         sprintf(_buf, "parameter '%s' cannot be of type 'void'.", name);
-        ERROR_MSG(PARAMETER_HAS_INCOMPLETE_TYPE, tnode->lineno, _buf);
-        exit(-1);
+        SYMTAB_ERROR(PARAMETER_HAS_INCOMPLETE_TYPE, tnode->lineno, _buf);
       }
 
       scope->stackCounter -= 4;
-      sym = newSymbol(tnode, scope->stackCounter);
+      sym = newSymbol(ctx->arena, tnode, scope->stackCounter);
 
-      tnode->scope_ref = getCurrentScope();
-      st_insert(scope->symtab, sym);
+      setScope(ctx, tnode, ctx->analyze->currentScope);
+      insertSymbol(ctx, scope, sym);
 
       // you don't have to care whether the parameter is of type array or not
     }
@@ -191,84 +456,30 @@ static void buildSymtab_pre(TreeNode *tnode) {
   }
 
   /* **** WORKING WITH SCOPES **** */
-  switch (tnode->nodekind) {
-  case StmtK:
-    if(tnode->kind.stmt != CompdK) break;
-
-    if(functionFlag) {
+  if(tnode->nodekind == StmtK && tnode->kind.stmt == CompdK) {
+    if(ctx->analyze->functionFlag) {
       // This compound statement is a function body
       // The function has already created new scope for this block
       // Thus, you don't have to enter the scope
-      functionFlag = 0;
+      ctx->analyze->functionFlag = 0;
     }
-    else enterScope();
+    else enterScope(ctx);
 
-    getCurrentScope()->stackCounter = -4;
-    getCurrentScope()->blockSize = 0;
-    if(h_scopeStack > 2) {
-      getCurrentScope()->stackCounter = getPrevScope()->stackCounter;
+    getCurrentScope(ctx)->stackCounter = -4;
+    getCurrentScope(ctx)->blockSize = 0;
+    if(getCurrentScope(ctx)->scopeDepth > 1) {
+      getCurrentScope(ctx)->stackCounter = getPrevScope(ctx)->stackCounter;
     }
-
-    break;
-
-  case DeclK:
-    if(tnode->kind.decl != FunDeclK) break;
-
-    /** Function Declaration **/
-
-    if(mainFlag) {
-      // this function appears after the main function
-      ERROR_MSG(MAIN_FUNCTION_MUST_APPEAR_LAST, tnode->lineno, "");
-      exit(-1);
-    }
-
-    functionFlag = 1;
-    enterScope();
-
-    // calculate address of top address of topmost parameter
-    int nParams = 0;
-    TreeNode *paramNode = tnode->child[1];
-    if(paramNode->nChildren > 0) {
-      while(paramNode != NULL) {
-        ++nParams;
-        paramNode = paramNode->sibling;
-      }
-    }
-
-    getCurrentScope()->stackCounter = 4 + 4*nParams;
-
-    // check if 'main' function
-    if(strcmp(tnode->attr.name, "main") == 0) {
-      if(tnode->type != VoidK) {
-        // return type is not 'void'
-        ERROR_MSG(MAIN_FUNCTION_RETURN_TYPE_MUST_BE_VOID, tnode->lineno, "");
-        exit(-1);
-      }
-      if(tnode->child[1]->nChildren > 0) {
-        // non-void parameters
-        ERROR_MSG(MAIN_FUNCTION_PAARM_TYPE_MUST_BE_VOID, tnode->lineno, "");
-        exit(-1);
-      }
-
-      // no error, this is the valid main function
-      mainFlag = 1;
-    }
-
-    break;
-
-  default:
-    break;
   }
-
 }
 
-static void buildSymtab_post(TreeNode *tnode) {
+static void buildSymtab_post(CompileContext *ctx, TreeNode *tnode) {
   switch (tnode->nodekind) {
   case StmtK:
     if(tnode->kind.stmt != CompdK) break;
     
     // store scope reference to AST node
-    tnode->scope_ref = exitScope();
+    setScope(ctx, tnode, exitScope(ctx));
     break;
 
   case ExprK: {
@@ -276,17 +487,18 @@ static void buildSymtab_post(TreeNode *tnode) {
 
     // var-expression / call-expression
     char const *name = tnode->attr.name;
-    struct SymbolRec *sym = lookupSymbol(name);
-    if(sym != NULL)  {
-      addLineno(sym, tnode->lineno);
+    struct BindingRec *binding = lookupBinding(ctx, name);
+    if(binding != NULL)  {
+      struct SymbolRec *sym = binding->sym;
+      if(TRACING(ctx, TraceAnalyze)) addReference(ctx, binding, tnode->lineno);
       tnode->loc = getMemLoc(sym);
-      tnode->scope_ref = getTreeNode(sym)->scope_ref;
+      setScope(ctx, tnode, getTreeNode(sym)->scope);
+      tnode->sym_ref = sym;
     }
     else {
       char _buf[128];
       sprintf(_buf, "identifier '%s' cannot be resolved.", name);
-      ERROR_MSG(IDENTIFIER_NOT_FOUND, tnode->lineno, _buf);
-      exit(-1);
+      SYMTAB_ERROR(IDENTIFIER_NOT_FOUND, tnode->lineno, _buf);
     }
     break;
   }
@@ -295,97 +507,315 @@ static void buildSymtab_post(TreeNode *tnode) {
   }
 }
 
-static void addExternalFunctions(void) {
+void initBuiltins(CompileContext *ctx) {
   TreeNode *declRoot;
   TreeNode *paramNode;
-  void *sym;
 
   /* int input(void) */
-  declRoot = newDeclNode(FunDeclK);
-  declRoot->child[0] = newTypeNode();
-  declRoot->child[0]->type = IntK;
-  declRoot->attr.name = "input";
-  declRoot->child[1] = newParamNode();
-  declRoot->child[1]->nChildren = 0;
-  declRoot->child[2] = newStmtNode(CompdK);
+  declRoot = newDeclNode(ctx, FunDeclK);
+  setChild(declRoot, 0, newTypeNode(ctx));
+  getChild(declRoot, 0)->type = IntK;
+  declRoot->attr.name = internString(ctx, "input");
+  setChild(declRoot, 1, newParamNode(ctx));
+  getChild(declRoot, 1)->nChildren = 0;
+  setChild(declRoot, 2, newStmtNode(ctx, CompdK));
   declRoot->type = IntK;
 
-  sym = newSymbol(declRoot, functionLocCounter);
-  st_insert(getCurrentScope()->symtab, sym);
-  ++functionLocCounter;
-
-  externDecl = declRoot;
+  ctx->builtins = declRoot;
 
   /* void output(int) */
-  declRoot = newDeclNode(FunDeclK);
-  declRoot->child[0] = newTypeNode();
-  declRoot->child[0]->type = VoidK;
-  declRoot->attr.name = "output";
-
-  paramNode = newParamNode();
-  paramNode->child[0] = newTypeNode();
-  paramNode->child[0]->type = IntK;
-  paramNode->attr.name = "";
+  declRoot = newDeclNode(ctx, FunDeclK);
+  setChild(declRoot, 0, newTypeNode(ctx));
+  getChild(declRoot, 0)->type = VoidK;
+  declRoot->attr.name = internString(ctx, "output");
+
+  paramNode = newParamNode(ctx);
+  setChild(paramNode, 0, newTypeNode(ctx));
+  getChild(paramNode, 0)->type = IntK;
+  paramNode->attr.name = internString(ctx, "");
   paramNode->type = IntK;
 
-  declRoot->child[1] = paramNode;
-  declRoot->child[2] = newStmtNode(CompdK);
+  setChild(declRoot, 1, paramNode);
+  setChild(declRoot, 2, newStmtNode(ctx, CompdK));
   declRoot->type = VoidK;
 
-  sym = newSymbol(declRoot, functionLocCounter);
-  st_insert(getCurrentScope()->symtab, sym);
-  ++functionLocCounter;
+  setSibling(ctx->builtins, declRoot);
+}
+
+static void addExternalFunctions(CompileContext *ctx) {
+  TreeNode *declRoot;
+  void *sym;
+
+  for(declRoot = ctx->builtins; declRoot != NULL; declRoot = getSibling(declRoot)) {
+    // built-ins are listed as declared where analysis starts
+    declRoot->lineno = ctx->lineno;
 
-  externDecl->sibling = declRoot;
+    sym = newSymbol(ctx->arena, declRoot, ctx->analyze->functionLocCounter);
+    insertSymbol(ctx, getCurrentScope(ctx), sym);
+    ++ctx->analyze->functionLocCounter;
+  }
 }
 
-void buildSymtab(TreeNode *syntaxTree) {
-  len_scopeWholeList = 0;
-  h_scopeStack = 0;
-  functionFlag = 0;
-  mainFlag = 0;
-  scopeIdCounter = 0;
-  functionLocCounter = 0;
+static struct AnalyzeState *newAnalyzeState(CompileContext *ctx) {
+  struct AnalyzeState *state = arenaCalloc(ctx->arena, 1, sizeof(struct AnalyzeState));
+  if(state == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  state->currentScope = NO_SCOPE;
+
+  // every name in the tree is interned by now
+  state->nVisible = atomCount(ctx);
+  state->visible = arenaAlloc(ctx->arena, (state->nVisible + 1) * sizeof(int));
+  if(state->visible == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  memset(state->visible, 0xff, state->nVisible * sizeof(int)); // NO_BINDING
+  return state;
+}
+
+/* Every function body only reads the global scope and
+ * writes scopes of its own, so with ctx->analyzeThreads
+ * above 1 the bodies are analyzed at once as units:
+ *
+ *  - the top-level declarations are made first, in order,
+ *    up to the first symbol table error among them;
+ *  - a pool of threads analyzes the functions declared
+ *    before that error, each against its own AnalyzeState
+ *    and arena, keeping errors instead of reporting them;
+ *  - the units are merged in order, so that scopes, line
+ *    lists and the error reported come out the same as
+ *    in the single walk.
+ */
+struct UnitPool {
+  CompileContext *ctx;
+  struct UnitRec *units;
+  int nUnits;
+
+  pthread_mutex_t lock;
+  int next; /* next unit to be taken */
+  int failed; /* first unit with a symbol table error, nUnits if none */
+};
+
+struct UnitWorker {
+  struct UnitPool *pool;
+  struct ArenaRec *arena;
+  pthread_t thread;
+};
+
+static void analyzeUnit(CompileContext *ctx, struct UnitRec *unit) {
+  struct AnalyzeState *state = ctx->analyze;
+
+  state->unit = unit;
+  state->order = unit->order;
+  state->symtabError = &unit->symtabError;
+  state->typeError.found = 0;
+  state->functionFlag = 0;
+  state->funcNode = NULL;
+
+  // scope 0 stands in for the global scope
+  state->scopes = NULL;
+  state->nScopes = 0;
+  state->capScopes = 0;
+  state->currentScope = NO_SCOPE;
+  state->scopeIdCounter = 0;
+  enterScope(ctx);
+
+  if(setjmp(ctx->failure) == 0) {
+    analyzeNode(ctx, unit->fnode);
+  }
+  // a symbol table error leaves the bindings of the function behind
+  popBindings(state, 0);
+
+  unit->scopes = state->scopes;
+  unit->nScopes = state->nScopes;
+  unit->typeError = state->typeError;
+}
+
+static void *unitWorkerMain(void *arg) {
+  struct UnitWorker *w = arg;
+  struct UnitPool *pool = w->pool;
+  CompileContext ctx = *pool->ctx;
+
+  ctx.arena = w->arena;
+  ctx.analyze = newAnalyzeState(&ctx);
+  ctx.analyze->globals = pool->ctx->analyze;
+
+  for(;;) {
+    pthread_mutex_lock(&pool->lock);
+    int i = pool->next++;
+    int skip = i > pool->failed;
+    pthread_mutex_unlock(&pool->lock);
+
+    if(i >= pool->nUnits) break;
+    // nothing after a failed unit gets reported
+    if(skip) continue;
+
+    analyzeUnit(&ctx, &pool->units[i]);
+    if(pool->units[i].symtabError.found) {
+      pthread_mutex_lock(&pool->lock);
+      if(i < pool->failed) pool->failed = i;
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+  return NULL;
+}
+
+/* the scopes of a unit go after those merged so far */
+static void mergeUnit(CompileContext *ctx, struct UnitRec *unit) {
+  struct AnalyzeState *state = ctx->analyze;
+  int offset = state->nScopes - 1;
+  int i;
+
+  for(i = 1; i < unit->nScopes; ++i) {
+    if(state->nScopes == state->capScopes) {
+      state->scopes = growArray(ctx->arena, state->scopes, state->nScopes,
+                                &state->capScopes, 64, sizeof(struct ScopeRec));
+    }
+    struct ScopeRec *scope = &state->scopes[state->nScopes++];
+    *scope = unit->scopes[i];
+    scope->scopeId = state->scopeIdCounter++;
+    if(scope->parent > 0) scope->parent += offset;
+  }
+  for(i = 0; i < unit->nPatch; ++i) {
+    unit->patch[i]->scope += offset;
+  }
+  for(i = 0; i < unit->nRefs; ++i) {
+    addLineno(ctx->arena, unit->refs[i].sym, unit->refs[i].lineno);
+  }
+}
+
+static void analyzeFunctions(CompileContext *ctx, TreeNode *syntaxTree) {
+  struct AnalyzeState *state = ctx->analyze;
+  struct ErrorRec globalError;
+  struct UnitPool pool;
+  struct UnitWorker *workers;
+  CompileContext globalCtx = *ctx;
+  TreeNode *tnode;
+  int nDecls = 0;
+  int nWorkers;
+  int i;
+
+  for(tnode = syntaxTree; tnode != NULL; tnode = getSibling(tnode)) ++nDecls;
+  pool.units = arenaCalloc(ctx->arena, nDecls, sizeof(struct UnitRec));
+  if(pool.units == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  pool.ctx = ctx;
+  pool.nUnits = 0;
+
+  // declare everything at the top level, up to the first error
+  globalError.found = 0;
+  state->symtabError = &globalError;
+  if(setjmp(globalCtx.failure) == 0) {
+    for(tnode = syntaxTree; tnode != NULL; tnode = getSibling(tnode)) {
+      if(tnode->nodekind == DeclK && tnode->kind.decl == FunDeclK) {
+        declareFunction(&globalCtx, tnode);
+        pool.units[pool.nUnits].fnode = tnode;
+        pool.units[pool.nUnits].order = state->order;
+        ++pool.nUnits;
+      }
+      else analyzeNode(&globalCtx, tnode);
+      ++state->order;
+    }
+  }
+  state->symtabError = NULL;
+
+  nWorkers = ctx->analyzeThreads < pool.nUnits ? ctx->analyzeThreads : pool.nUnits;
+  if(ctx->unitArenas == NULL) {
+    ctx->unitArenas = calloc(ctx->analyzeThreads, sizeof(struct ArenaRec *));
+    if(ctx->unitArenas == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+  }
+  workers = arenaCalloc(ctx->arena, nWorkers + 1, sizeof(struct UnitWorker));
+  if(workers == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  for(i = 0; i < nWorkers; ++i) {
+    if(ctx->unitArenas[i] == NULL) ctx->unitArenas[i] = constructArena();
+    if(ctx->unitArenas[i] == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+    workers[i].pool = &pool;
+    workers[i].arena = ctx->unitArenas[i];
+  }
+
+  pool.next = 0;
+  pool.failed = pool.nUnits;
+  pthread_mutex_init(&pool.lock, NULL);
+
+  // worker 0 runs on the calling thread
+  for(i = 1; i < nWorkers; ++i) {
+    if(pthread_create(&workers[i].thread, NULL, unitWorkerMain, &workers[i]) != 0) {
+      fprintf(stderr, "Unable to start worker thread\n");
+      exit(1);
+    }
+  }
+  if(nWorkers > 0) unitWorkerMain(&workers[0]);
+  for(i = 1; i < nWorkers; ++i) pthread_join(workers[i].thread, NULL);
+  pthread_mutex_destroy(&pool.lock);
+
+  // report what the single walk would have reported first
+  if(pool.failed < pool.nUnits) reportError(ctx, &pool.units[pool.failed].symtabError);
+  if(globalError.found) reportError(ctx, &globalError);
+
+  for(i = 0; i < pool.nUnits; ++i) {
+    mergeUnit(ctx, &pool.units[i]);
+    if(pool.units[i].typeError.found && !state->typeError.found) {
+      state->typeError = pool.units[i].typeError;
+    }
+  }
+}
+
+void buildSymtab(CompileContext *ctx, TreeNode *syntaxTree) {
+  ctx->analyze = newAnalyzeState(ctx);
 
   // enter the global scope
-  enterScope();
-  getCurrentScope()->stackCounter = 0;
-  getCurrentScope()->blockSize = 0;   // never used for global scope
+  enterScope(ctx);
+  getCurrentScope(ctx)->stackCounter = 0;
+  getCurrentScope(ctx)->blockSize = 0;   // never used for global scope
 
-  addExternalFunctions();
+  addExternalFunctions(ctx);
 
-  traverseSiblings(syntaxTree, buildSymtab_pre, buildSymtab_post);
+  if(ctx->analyzeThreads > 1) analyzeFunctions(ctx, syntaxTree);
+  else analyzeSiblings(ctx, syntaxTree);
 
   // exit the global scope
-  exitScope();
+  exitScope(ctx);
 
-  assert(h_scopeStack == 0);
-  assert(functionFlag == 0);
-  assert(mainFlag == 1);
+  assert(ctx->analyze->currentScope == NO_SCOPE);
+  assert(ctx->analyze->functionFlag == 0);
 
-  if(!mainFlag) {
+  if(!ctx->analyze->mainFlag) {
     // main function has never been found
     ERROR_MSG(MAIN_FUNCTION_NOT_EXISTS, 0, "");
-    exit(-1);
+    abortCompile(ctx);
   }
 
-  if(TraceAnalyze) {
+  if(TRACING(ctx, TraceAnalyze)) {
     int i;
-    for(i=0; i<len_scopeWholeList; ++i) {
-      printSymbolTable(listing, scopeWholeList[i].symtab, scopeWholeList[i].scopeDepth);
+    for(i=0; i<ctx->analyze->nScopes; ++i) {
+      printSymbolTable(ctx->listing, ctx->analyze->scopes[i].symtab, ctx->analyze->scopes[i].scopeDepth);
     }
   }
 }
 
-static void typeCheck_pre(TreeNode *tnode) {
-  if(tnode->nodekind == StmtK && tnode->kind.stmt == CompdK) {
-    enterExistingScope(tnode->scope_ref);
-  } else if (tnode->nodekind == DeclK && tnode->kind.decl == FunDeclK) {
-    funcName = tnode->attr.name;
+/* the node has been resolved by buildSymtab_post, which
+ * left the symbol of every VarK and CallK in its sym_ref */
+
+static void typeCheck_pre(CompileContext *ctx, TreeNode *tnode) {
+  if (tnode->nodekind == DeclK && tnode->kind.decl == FunDeclK) {
+    ctx->analyze->funcNode = tnode;
   }
 }
 
-static void typeCheck_post(TreeNode *tnode) {
+static void typeCheck_post(CompileContext *ctx, TreeNode *tnode) {
   NodeKind nodekind = tnode->nodekind;
 
   if(nodekind == ExprK) {
@@ -393,39 +823,34 @@ static void typeCheck_post(TreeNode *tnode) {
 
     if(kind == OpExprK) {
       if (tnode->attr.op == LBRACKET) {
-        TreeNode *indexVal = tnode->child[1];
+        TreeNode *indexVal = getChild(tnode, 1);
         if (indexVal->type == VoidK) {
-          ERROR_MSG(ARRAY_SUBSCRIPT_TYPE_ERROR, tnode->lineno, "");
-          exit(-1);
+          TYPE_ERROR(ARRAY_SUBSCRIPT_TYPE_ERROR, tnode->lineno, "");
         }
 
         // check subscipted variable is array variable
-        char *name = tnode->child[0]->attr.name;
-        TreeNode *varNode = getTreeNode(lookupSymbol(name));
-        int arrSize = varNode->child[0]->attr.val;
+        TreeNode *varNode = getTreeNode(getChild(tnode, 0)->sym_ref);
+        int arrSize = getChild(varNode, 0)->attr.val;
 
         if(arrSize == -1) {
-          ERROR_MSG(SUBSCRIPTED_VALUE_TYPE_ERROR, tnode->lineno, "");
-          exit(-1);
+          TYPE_ERROR(SUBSCRIPTED_VALUE_TYPE_ERROR, tnode->lineno, "");
         }
 
         tnode->type = IntK;
       } else if (tnode->attr.op == ASSIGN) {
-        TreeNode *lhs = tnode->child[0];
-        TreeNode *rhs = tnode->child[1];
+        TreeNode *lhs = getChild(tnode, 0);
+        TreeNode *rhs = getChild(tnode, 1);
         if (lhs->type == VoidK) {
-          ERROR_MSG(EXPRESSION_IS_NOT_ASSIGNABLE, tnode->lineno, "");
-          exit(-1);
+          TYPE_ERROR(EXPRESSION_IS_NOT_ASSIGNABLE, tnode->lineno, "");
         }
         else if (rhs->type == VoidK) {
-          ERROR_MSG(INCOMPATIBLE_ASSIGNMENT_ERROR, tnode->lineno, "");
-          exit(-1);
+          TYPE_ERROR(INCOMPATIBLE_ASSIGNMENT_ERROR, tnode->lineno, "");
         } else {
           tnode->type = rhs->type;
         }
       } else {
-        TreeNode *left = tnode->child[0];
-        TreeNode *right = tnode->child[1];
+        TreeNode *left = getChild(tnode, 0);
+        TreeNode *right = getChild(tnode, 1);
         // TODO MORE
         char _buf[128];
         char _left_type[10];
@@ -436,8 +861,7 @@ static void typeCheck_post(TreeNode *tnode) {
           if (right->type == VoidK) sprintf(_right_type, "void");
           else sprintf(_right_type, "int");
           sprintf(_buf, "operand1 has type %s, operand2 has type %s", _left_type, _right_type);
-          ERROR_MSG(INVALID_OPERANDS_BINARY_OPERATION, tnode->lineno, _buf);
-          exit(-1);
+          TYPE_ERROR(INVALID_OPERANDS_BINARY_OPERATION, tnode->lineno, _buf);
         } else {
           tnode->type = IntK;
         }
@@ -447,41 +871,34 @@ static void typeCheck_post(TreeNode *tnode) {
       tnode->type = IntK;
     }
     else if(kind == VarK) {
-      char const *name = tnode->attr.name;
-      void *sym = lookupSymbol(name);
-      TreeNode *symNode = getTreeNode(sym);
+      TreeNode *symNode = getTreeNode(tnode->sym_ref);
       assert(symNode != NULL);
       assert(symNode->type == IntK);
-      tnode->sym_ref = sym;
       tnode->type = symNode->type; 
     }
     else if(kind == CallK) {
-      char const *name = tnode->attr.name;
-      TreeNode *symNode = getTreeNode(lookupSymbol(name));
+      TreeNode *symNode = getTreeNode(tnode->sym_ref);
       assert(symNode != NULL);
       
-      TreeNode *symParam = symNode->child[1];
+      TreeNode *symParam = getChild(symNode, 1);
       if(symParam->nChildren == 0) symParam = NULL;
-      TreeNode *nowParam = tnode->child[0];
+      TreeNode *nowParam = getChild(tnode, 0);
 
       while(nowParam) {
         if (symParam==NULL){
-          ERROR_MSG(TOO_MANY_ARGUMENTS_ERROR, tnode->lineno, "");
-          exit(-1);
+          TYPE_ERROR(TOO_MANY_ARGUMENTS_ERROR, tnode->lineno, "");
         }
         if (nowParam->type == VoidK) {
-          ERROR_MSG(
+          TYPE_ERROR(
               INCOMPATIBLE_PARAMETER_PASSING, tnode->lineno,
               "expected int but actual was void");
-          exit(-1);
         } else{
-          nowParam = nowParam->sibling;
-          symParam = symParam->sibling; 
+          nowParam = getSibling(nowParam);
+          symParam = getSibling(symParam); 
         }
       }
       if (symParam) {
-        ERROR_MSG(TOO_FEW_ARGUMENTS_ERROR, tnode->lineno, "");
-        exit(-1);
+        TYPE_ERROR(TOO_FEW_ARGUMENTS_ERROR, tnode->lineno, "");
       }
       tnode->type = symNode->type;
     }
@@ -494,39 +911,36 @@ static void typeCheck_post(TreeNode *tnode) {
     ExprKind kind = tnode->kind.expr;
 
     if(kind == CompdK) {
-      exitScope();
+      // NOTHING TO CHECK
     }
     else if(kind == SelectK) {
-      if (tnode->child[0]->type == VoidK) {
-        ERROR_MSG(
+      if (getChild(tnode, 0)->type == VoidK) {
+        TYPE_ERROR(
             STATEMENT_EXPRESSION_TYPE_ERROR, tnode->lineno,
             "'if' statement requires expression of type 'int'");
-        exit(-1);
       }
     }
     else if(kind == IterK) {
-      if (tnode->child[0]->type == VoidK) {
-        ERROR_MSG(
+      if (getChild(tnode, 0)->type == VoidK) {
+        TYPE_ERROR(
             STATEMENT_EXPRESSION_TYPE_ERROR, tnode->lineno,
             "'while' statement requires expression of type 'int'");
-        exit(-1);
       }
     }
     else if(kind == RetK) {
       // requires the function to match RETURN statement against
-      TreeNode *symNode = getTreeNode(lookupSymbol(funcName));
+      TreeNode *symNode = ctx->analyze->funcNode;
       assert(symNode != NULL);
       
       TypeKind nowType;
       if (tnode->nChildren > 0){
-        nowType = tnode->child[0]->type;
+        nowType = getChild(tnode, 0)->type;
       } else {
         nowType = VoidK;
       }
 
       if (symNode->type != nowType) {
-        ERROR_MSG(RETURN_TYPE_MISMATCH_ERROR, tnode->lineno, "");
-        exit(-1);
+        TYPE_ERROR(RETURN_TYPE_MISMATCH_ERROR, tnode->lineno, "");
       }
     }
     else {
@@ -536,11 +950,6 @@ static void typeCheck_post(TreeNode *tnode) {
   }
 }
 
-void typeCheck(TreeNode *syntaxTree) {
-  h_scopeStack = 0;
-
-  // scopeWholeList[0] == global scope
-  enterExistingScope(&scopeWholeList[0]);
-  traverseSiblings(syntaxTree, typeCheck_pre, typeCheck_post);
-  exitScope();
+void reportTypeError(CompileContext *ctx) {
+  if(ctx->analyze->typeError.found) reportError(ctx, &ctx->analyze->typeError);
 }
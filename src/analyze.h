@@ -3,16 +3,44 @@
 
 #include "symtab.h"
 
+/* Scopes are kept in a table that grows on demand and
+ * refer to their parent scope by index; scope 0 is the
+ * global scope, NO_SCOPE stands for no scope
+ */
+typedef int ScopeIndex;
+#define NO_SCOPE (-1)
+
 struct ScopeRec {
   int scopeId;
   int scopeDepth;
   int stackCounter;
   int blockSize;
-  BucketList *symtab;
+  ScopeIndex parent;
+  int firstBinding; /* bindings made in this scope start here */
+  Symtab symtab; /* NULL until a symbol is inserted */
 };
 
-void buildSymtab(TreeNode *);
+/* Function scopeAt returns the scope with the given index */
+struct ScopeRec *scopeAt(CompileContext *, ScopeIndex);
+
+/* procedure initBuiltins declares the built-in functions
+ * input and output; the declarations are kept for every
+ * compilation run on the context
+ */
+void initBuiltins(CompileContext *);
+
+/* procedure buildSymtab builds the symbol tables and
+ * type checks the tree in the same walk; a type error is
+ * held back for reportTypeError, so that symbol table
+ * errors are still reported first.  With ctx->analyzeThreads
+ * above 1 the function bodies are analyzed on that many
+ * threads, with the same results.
+ */
+void buildSymtab(CompileContext *, TreeNode *);
 
-void typeCheck(TreeNode *);
+/* procedure reportTypeError reports the first type
+ * error found by buildSymtab, if any
+ */
+void reportTypeError(CompileContext *);
 
 #endif
@@ -0,0 +1,119 @@
+#include "globals.h"
+#include "arena.h"
+
+/* default size of a chunk; larger requests get a chunk of their own */
+#define CHUNK_SIZE (64 * 1024)
+
+/* every allocation is aligned to this boundary */
+#define ALIGNMENT 16
+
+/* resetArena keeps at most this many chunks for reuse */
+#define MAX_SPARE_CHUNKS 64
+
+struct ChunkRec {
+  struct ChunkRec *next;
+  char *cur;
+  char *end;
+};
+
+struct ArenaRec {
+  struct ChunkRec *chunks;
+  struct ChunkRec *spare; /* emptied chunks of CHUNK_SIZE bytes */
+  int nSpare;
+};
+
+static size_t chunkHeaderSize(void) {
+  return (sizeof(struct ChunkRec) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+}
+
+static struct ChunkRec *newChunk(size_t size) {
+  struct ChunkRec *chunk = malloc(chunkHeaderSize() + size);
+  if(chunk == NULL) return NULL;
+  chunk->next = NULL;
+  chunk->cur = (char *)chunk + chunkHeaderSize();
+  chunk->end = chunk->cur + size;
+  return chunk;
+}
+
+Arena constructArena(void) {
+  Arena arena = malloc(sizeof(struct ArenaRec));
+  if(arena == NULL) return NULL;
+  arena->chunks = NULL;
+  arena->spare = NULL;
+  arena->nSpare = 0;
+  return arena;
+}
+
+static void freeChunks(struct ChunkRec *chunk) {
+  struct ChunkRec *next;
+  while(chunk != NULL) {
+    next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+}
+
+void destroyArena(Arena arena) {
+  if(arena == NULL) return;
+  freeChunks(arena->chunks);
+  freeChunks(arena->spare);
+  free(arena);
+}
+
+void resetArena(Arena arena) {
+  struct ChunkRec *chunk = arena->chunks, *next;
+  while(chunk != NULL) {
+    char *base = (char *)chunk + chunkHeaderSize();
+    next = chunk->next;
+    if(chunk->end - base == CHUNK_SIZE && arena->nSpare < MAX_SPARE_CHUNKS) {
+      chunk->cur = base;
+      chunk->next = arena->spare;
+      arena->spare = chunk;
+      ++arena->nSpare;
+    }
+    else free(chunk);
+    chunk = next;
+  }
+  arena->chunks = NULL;
+}
+
+void *arenaAlloc(Arena arena, size_t size) {
+  struct ChunkRec *chunk = arena->chunks;
+  size = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+
+  if(chunk == NULL || (size_t)(chunk->end - chunk->cur) < size) {
+    if(size > CHUNK_SIZE / 4) {
+      /* oversized request: give it a private chunk behind the current one
+       * so the space left in the current chunk is not wasted */
+      struct ChunkRec *big = newChunk(size);
+      if(big == NULL) return NULL;
+      if(chunk == NULL) arena->chunks = big;
+      else {
+        big->next = chunk->next;
+        chunk->next = big;
+      }
+      big->cur = big->end;
+      return big->end - size;
+    }
+
+    if(arena->spare != NULL) {
+      chunk = arena->spare;
+      arena->spare = chunk->next;
+      --arena->nSpare;
+    }
+    else chunk = newChunk(CHUNK_SIZE);
+    if(chunk == NULL) return NULL;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+  }
+
+  void *p = chunk->cur;
+  chunk->cur += size;
+  return p;
+}
+
+void *arenaCalloc(Arena arena, size_t n, size_t size) {
+  void *p = arenaAlloc(arena, n * size);
+  if(p != NULL) memset(p, 0, n * size);
+  return p;
+}
@@ -0,0 +1,30 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+/* An arena hands out memory by bumping a pointer
+ * through large chunks; nothing is freed on its own,
+ * the whole arena is released at once by destroyArena
+ */
+typedef struct ArenaRec *Arena;
+
+Arena constructArena(void);
+void destroyArena(Arena arena);
+
+/* procedure resetArena releases everything allocated from
+ * the arena at once but keeps its chunks for reuse
+ */
+void resetArena(Arena arena);
+
+/* Function arenaAlloc returns size bytes of uninitialized
+ * memory, or NULL when out of memory
+ */
+void *arenaAlloc(Arena arena, size_t size);
+
+/* Function arenaCalloc returns zeroed memory for
+ * an array of n elements
+ */
+void *arenaCalloc(Arena arena, size_t n, size_t size);
+
+#endif
@@ -0,0 +1,132 @@
+#include "globals.h"
+#include "atom.h"
+#include "arena.h"
+
+#include <stddef.h>
+
+/* initial number of slots in the atom table, a power of two */
+#define INITIAL_SLOTS 1024
+
+struct AtomRec {
+  unsigned hash;
+  unsigned id; /* atoms are numbered from 0 as they are made */
+  int length;
+  char name[];
+};
+
+struct AtomTable {
+  struct AtomRec **slots;
+  unsigned nSlots;
+  unsigned nAtoms;
+};
+
+/* FNV-1a */
+static unsigned hashName(char const *s, int length) {
+  unsigned h = 2166136261u;
+  int i;
+  for(i = 0; i < length; ++i) {
+    h ^= (unsigned char)s[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static struct AtomRec *allocAtom(CompileContext *ctx, int length) {
+  size_t size = offsetof(struct AtomRec, name) + length + 1;
+  struct AtomRec *atom = arenaAlloc(ctx->sessionArena, size);
+  if(atom == NULL) {
+    fprintf(stderr, "Out of memory error at line %d\n", ctx->lineno);
+    exit(1);
+  }
+  return atom;
+}
+
+static void growSlots(struct AtomTable *table) {
+  unsigned newSize = table->nSlots ? table->nSlots * 2 : INITIAL_SLOTS;
+  struct AtomRec **newSlots = calloc(newSize, sizeof(struct AtomRec *));
+  unsigned i;
+
+  if(newSlots == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+
+  for(i = 0; i < table->nSlots; ++i) {
+    struct AtomRec *atom = table->slots[i];
+    if(atom == NULL) continue;
+    unsigned h = atom->hash & (newSize - 1);
+    while(newSlots[h] != NULL) h = (h + 1) & (newSize - 1);
+    newSlots[h] = atom;
+  }
+
+  free(table->slots);
+  table->slots = newSlots;
+  table->nSlots = newSize;
+}
+
+void initAtoms(CompileContext *ctx) {
+  struct AtomTable *table = arenaAlloc(ctx->sessionArena, sizeof(struct AtomTable));
+  if(table == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  table->slots = NULL;
+  table->nSlots = 0;
+  table->nAtoms = 0;
+  ctx->atoms = table;
+}
+
+void clearAtoms(CompileContext *ctx) {
+  if(ctx->atoms == NULL) return;
+  free(ctx->atoms->slots);
+  ctx->atoms = NULL;
+}
+
+char *internName(CompileContext *ctx, char const *s, int length) {
+  struct AtomTable *table = ctx->atoms;
+  unsigned hash = hashName(s, length);
+  unsigned h;
+
+  if(2 * (table->nAtoms + 1) > table->nSlots) growSlots(table);
+
+  h = hash & (table->nSlots - 1);
+  while(table->slots[h] != NULL) {
+    struct AtomRec *atom = table->slots[h];
+    if(atom->hash == hash && atom->length == length &&
+       memcmp(atom->name, s, length) == 0) {
+      return atom->name;
+    }
+    h = (h + 1) & (table->nSlots - 1);
+  }
+
+  struct AtomRec *atom = allocAtom(ctx, length);
+  atom->hash = hash;
+  atom->id = table->nAtoms;
+  atom->length = length;
+  memcpy(atom->name, s, length);
+  atom->name[length] = '\0';
+
+  table->slots[h] = atom;
+  ++table->nAtoms;
+  return atom->name;
+}
+
+char *internString(CompileContext *ctx, char const *s) {
+  return internName(ctx, s, strlen(s));
+}
+
+unsigned atomCount(CompileContext *ctx) {
+  return ctx->atoms->nAtoms;
+}
+
+unsigned atomHash(char const *name) {
+  struct AtomRec const *atom =
+    (struct AtomRec const *)(name - offsetof(struct AtomRec, name));
+  return atom->hash;
+}
+
+unsigned atomId(char const *name) {
+  struct AtomRec const *atom =
+    (struct AtomRec const *)(name - offsetof(struct AtomRec, name));
+  return atom->id;
+}
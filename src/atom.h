@@ -0,0 +1,41 @@
+#ifndef _ATOM_H_
+#define _ATOM_H_
+
+/* An atom is an interned identifier: every distinct
+ * spelling is stored exactly once together with its
+ * hash value, so two interned names are equal if and
+ * only if their pointers are equal.
+ */
+
+/* procedure initAtoms creates the atom table of a
+ * compilation; atoms are allocated from ctx->sessionArena
+ */
+void initAtoms(CompileContext *ctx);
+
+/* procedure clearAtoms forgets every atom; their
+ * storage is released with ctx->sessionArena
+ */
+void clearAtoms(CompileContext *ctx);
+
+/* Function internName returns the atom spelled by the
+ * first length characters of s, creating it if needed
+ */
+char *internName(CompileContext *ctx, char const *s, int length);
+
+/* Function internString interns a NUL-terminated string */
+char *internString(CompileContext *ctx, char const *s);
+
+/* Function atomCount returns the number of atoms */
+unsigned atomCount(CompileContext *ctx);
+
+/* Function atomHash returns the precomputed hash of an
+ * interned name; name must come from internName
+ */
+unsigned atomHash(char const *name);
+
+/* Function atomId returns the number of an interned name;
+ * atoms are numbered densely from 0, below atomCount()
+ */
+unsigned atomId(char const *name);
+
+#endif
@@ -0,0 +1,204 @@
+#include "globals.h"
+#include "batch.h"
+#include "compile.h"
+#include "cache.h"
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Files are handed out by work stealing: each worker owns
+ * a contiguous range of jobs and takes them from the
+ * front; a worker whose range runs dry steals the back
+ * half of another worker's range.
+ */
+
+struct Job {
+  char const *path;
+  CompileStatus status;
+  double millis;
+  char *listing; /* captured listing text */
+  size_t listingSize;
+  int done;
+};
+
+struct Worker {
+  pthread_t thread;
+  pthread_mutex_t lock; /* guards begin and end */
+  int begin, end; /* jobs not taken yet */
+  int id;
+  struct Batch *batch;
+};
+
+struct Batch {
+  struct Job *jobs;
+  int nJobs;
+  struct Worker *workers;
+  int nWorkers;
+  CompileOptions const *options;
+
+  /* jobs are reported in input order as they finish */
+  pthread_mutex_t reportLock;
+  int nextReport;
+  int nFailed;
+};
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static char const *statusText(CompileStatus status) {
+  switch(status) {
+  case COMPILE_OK: return "ok";
+  case COMPILE_SYNTAX_ERROR: return "syntax error";
+  case COMPILE_SEMANTIC_ERROR: return "semantic error";
+  case COMPILE_IO_ERROR: return "i/o error";
+  }
+  return "unknown";
+}
+
+static int takeJob(struct Worker *w) {
+  int job = -1;
+  pthread_mutex_lock(&w->lock);
+  if(w->begin < w->end) job = w->begin++;
+  pthread_mutex_unlock(&w->lock);
+  return job;
+}
+
+static int stealJobs(struct Worker *thief) {
+  struct Batch *batch = thief->batch;
+  int i;
+
+  for(i = 1; i < batch->nWorkers; ++i) {
+    struct Worker *victim = &batch->workers[(thief->id + i) % batch->nWorkers];
+    int begin = 0, end = 0;
+
+    pthread_mutex_lock(&victim->lock);
+    if(victim->begin < victim->end) {
+      end = victim->end;
+      begin = end - (victim->end - victim->begin + 1) / 2;
+      victim->end = begin;
+    }
+    pthread_mutex_unlock(&victim->lock);
+
+    if(begin < end) {
+      pthread_mutex_lock(&thief->lock);
+      thief->begin = begin;
+      thief->end = end;
+      pthread_mutex_unlock(&thief->lock);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static void reportJobs(struct Batch *batch) {
+  while(batch->nextReport < batch->nJobs && batch->jobs[batch->nextReport].done) {
+    struct Job *job = &batch->jobs[batch->nextReport++];
+    printf("%s: %s (%.3f ms)\n", job->path, statusText(job->status), job->millis);
+    if(job->status != COMPILE_OK) {
+      ++batch->nFailed;
+      fwrite(job->listing, 1, job->listingSize, stdout);
+    }
+    free(job->listing);
+    job->listing = NULL;
+  }
+}
+
+static void runJob(struct Batch *batch, struct Job *job) {
+  double start = now();
+  FILE *listing = open_memstream(&job->listing, &job->listingSize);
+
+  if(listing == NULL) {
+    job->status = COMPILE_IO_ERROR;
+  }
+  else {
+    job->status = compileFile(job->path, listing, batch->options);
+    fclose(listing);
+  }
+  job->millis = now() - start;
+
+  pthread_mutex_lock(&batch->reportLock);
+  job->done = TRUE;
+  reportJobs(batch);
+  pthread_mutex_unlock(&batch->reportLock);
+}
+
+static void *workerMain(void *arg) {
+  struct Worker *w = arg;
+  for(;;) {
+    int job = takeJob(w);
+    if(job < 0) {
+      if(!stealJobs(w)) break;
+      continue;
+    }
+    runJob(w->batch, &w->batch->jobs[job]);
+  }
+  return NULL;
+}
+
+int compileBatch(char **files, int nFiles, int nThreads,
+                 CompileOptions const *options) {
+  struct Batch batch;
+  double start = now();
+  int i;
+
+  if(nThreads <= 0) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    nThreads = n > 0 ? (int)n : 1;
+  }
+  if(nThreads > nFiles) nThreads = nFiles;
+  if(nThreads < 1) nThreads = 1;
+
+  batch.jobs = calloc(nFiles, sizeof(struct Job));
+  batch.workers = calloc(nThreads, sizeof(struct Worker));
+  if(batch.jobs == NULL || batch.workers == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  batch.nJobs = nFiles;
+  batch.nWorkers = nThreads;
+  batch.options = options;
+  batch.nextReport = 0;
+  batch.nFailed = 0;
+  pthread_mutex_init(&batch.reportLock, NULL);
+
+  for(i = 0; i < nFiles; ++i) batch.jobs[i].path = files[i];
+
+  /* deal the files out in equal contiguous ranges */
+  for(i = 0; i < nThreads; ++i) {
+    struct Worker *w = &batch.workers[i];
+    pthread_mutex_init(&w->lock, NULL);
+    w->begin = (int)((long)nFiles * i / nThreads);
+    w->end = (int)((long)nFiles * (i + 1) / nThreads);
+    w->id = i;
+    w->batch = &batch;
+  }
+
+  /* worker 0 runs on the calling thread */
+  for(i = 1; i < nThreads; ++i) {
+    if(pthread_create(&batch.workers[i].thread, NULL, workerMain,
+                      &batch.workers[i]) != 0) {
+      fprintf(stderr, "Unable to start worker thread\n");
+      exit(1);
+    }
+  }
+  workerMain(&batch.workers[0]);
+  for(i = 1; i < nThreads; ++i) pthread_join(batch.workers[i].thread, NULL);
+
+  printf("%d files, %d failed, %.3f s wall time on %d threads\n",
+         nFiles, batch.nFailed, (now() - start) / 1e3, nThreads);
+  if(options != NULL && options->cache != NULL) {
+    unsigned long hits, misses;
+    cacheStats(options->cache, &hits, &misses);
+    printf("cache: %lu hits, %lu misses\n", hits, misses);
+  }
+
+  for(i = 0; i < nThreads; ++i) pthread_mutex_destroy(&batch.workers[i].lock);
+  pthread_mutex_destroy(&batch.reportLock);
+  free(batch.workers);
+  free(batch.jobs);
+  return batch.nFailed;
+}
@@ -0,0 +1,17 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+struct CompileOptions;
+
+/* procedure compileBatch compiles nFiles source files on
+ * nThreads worker threads (0 picks one per online CPU),
+ * all with the same options, which may be NULL.
+ * A status line and the wall time of every file are
+ * reported to stdout in input order, followed by the
+ * listing of each file that failed to compile.
+ * Returns the number of files that failed.
+ */
+int compileBatch(char **files, int nFiles, int nThreads,
+                 struct CompileOptions const *options);
+
+#endif
@@ -0,0 +1,311 @@
+#include "globals.h"
+#include "cache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+/* first line of every entry; bump when the layout changes */
+#define ENTRY_MAGIC "cminus-cache 1\n"
+
+#define ENTRY_SUFFIX ".tmc"
+#define TEMP_PREFIX ".tmp."
+
+/* temporary files older than this were left by a crash */
+#define STALE_TEMP_SECONDS 3600
+
+struct CompileCache {
+  char *dir;
+  size_t maxBytes;
+
+  /* identity of the compiler binary, part of every key */
+  unsigned char compilerId[SHA256_DIGEST_SIZE];
+
+  pthread_mutex_t lock; /* guards the fields below */
+  unsigned long hits, misses;
+  size_t bytesSinceEviction;
+};
+
+static void hashCompiler(CompileCache *cache) {
+  Sha256 sha;
+  struct stat st;
+
+  sha256Init(&sha);
+  sha256Update(&sha, ENTRY_MAGIC, strlen(ENTRY_MAGIC));
+  /* a rebuilt compiler has a new size or mtime */
+  if (stat("/proc/self/exe", &st) == 0) {
+    sha256Update(&sha, &st.st_dev, sizeof(st.st_dev));
+    sha256Update(&sha, &st.st_ino, sizeof(st.st_ino));
+    sha256Update(&sha, &st.st_size, sizeof(st.st_size));
+    sha256Update(&sha, &st.st_mtim, sizeof(st.st_mtim));
+  }
+  sha256Update(&sha, __DATE__ __TIME__, strlen(__DATE__ __TIME__));
+  sha256Final(&sha, cache->compilerId);
+}
+
+CompileCache *openCache(char const *dir, size_t maxBytes) {
+  CompileCache *cache;
+
+  if (mkdir(dir, 0777) != 0 && errno != EEXIST) return NULL;
+  if (access(dir, R_OK | W_OK | X_OK) != 0) return NULL;
+
+  cache = malloc(sizeof(CompileCache));
+  if (cache == NULL) return NULL;
+  cache->dir = strdup(dir);
+  if (cache->dir == NULL) {
+    free(cache);
+    return NULL;
+  }
+  cache->maxBytes = maxBytes;
+  cache->hits = cache->misses = 0;
+  cache->bytesSinceEviction = 0;
+  pthread_mutex_init(&cache->lock, NULL);
+  hashCompiler(cache);
+  return cache;
+}
+
+void cacheKey(CompileCache *cache, CompileContext *ctx,
+              char const *text, size_t size,
+              unsigned char key[SHA256_DIGEST_SIZE]) {
+  Sha256 sha;
+  int flags[8];
+  uint64_t length = size;
+
+  flags[0] = ctx->EchoSource;
+  flags[1] = ctx->TraceScan;
+  flags[2] = ctx->TraceParse;
+  flags[3] = ctx->TraceAnalyze;
+  flags[4] = ctx->TraceCode;
+  flags[5] = ctx->DumpIR;
+  flags[6] = ctx->optLevel;
+  flags[7] = ctx->TracePeephole;
+
+  sha256Init(&sha);
+  sha256Update(&sha, cache->compilerId, sizeof(cache->compilerId));
+  sha256Update(&sha, flags, sizeof(flags));
+  sha256Update(&sha, &length, sizeof(length));
+  sha256Update(&sha, text, size);
+  sha256Final(&sha, key);
+}
+
+/* entryPath returns the malloc'ed path of the entry for key */
+static char *entryPath(CompileCache *cache, unsigned char const key[SHA256_DIGEST_SIZE]) {
+  size_t dirLen = strlen(cache->dir);
+  char *path = malloc(dirLen + 1 + 2 * SHA256_DIGEST_SIZE + sizeof(ENTRY_SUFFIX));
+  int i;
+
+  if (path == NULL) return NULL;
+  memcpy(path, cache->dir, dirLen);
+  path[dirLen] = '/';
+  for (i = 0; i < SHA256_DIGEST_SIZE; ++i) {
+    sprintf(path + dirLen + 1 + 2 * i, "%02x", key[i]);
+  }
+  strcpy(path + dirLen + 1 + 2 * SHA256_DIGEST_SIZE, ENTRY_SUFFIX);
+  return path;
+}
+
+static void count(CompileCache *cache, int hit) {
+  pthread_mutex_lock(&cache->lock);
+  if (hit) ++cache->hits;
+  else ++cache->misses;
+  pthread_mutex_unlock(&cache->lock);
+}
+
+int lookupCache(CompileCache *cache, unsigned char const key[SHA256_DIGEST_SIZE],
+                int *status, char **listing, size_t *listingSize,
+                char **code, size_t *codeSize) {
+  char *path = entryPath(cache, key);
+  char magic[sizeof(ENTRY_MAGIC)];
+  FILE *fp = path != NULL ? fopen(path, "rb") : NULL;
+  size_t lsize, csize;
+  int stored, hit = FALSE;
+
+  *listing = *code = NULL;
+  if (fp != NULL &&
+      fread(magic, 1, strlen(ENTRY_MAGIC), fp) == strlen(ENTRY_MAGIC) &&
+      memcmp(magic, ENTRY_MAGIC, strlen(ENTRY_MAGIC)) == 0 &&
+      fscanf(fp, "%d %zu %zu", &stored, &lsize, &csize) == 3 && fgetc(fp) == '\n') {
+    *listing = malloc(lsize + 1);
+    *code = malloc(csize + 1);
+    if (*listing != NULL && *code != NULL &&
+        fread(*listing, 1, lsize, fp) == lsize &&
+        fread(*code, 1, csize, fp) == csize) {
+      *status = stored;
+      *listingSize = lsize;
+      *codeSize = csize;
+      hit = TRUE;
+      /* a hit makes the entry the most recently used */
+      futimens(fileno(fp), NULL);
+    }
+    else {
+      free(*listing);
+      free(*code);
+      *listing = *code = NULL;
+    }
+  }
+  if (fp != NULL) fclose(fp);
+  free(path);
+  count(cache, hit);
+  return hit;
+}
+
+struct Entry {
+  char *name;
+  off_t size;
+  struct timespec used;
+};
+
+static int compareEntries(void const *a, void const *b) {
+  struct Entry const *x = a, *y = b;
+  if (x->used.tv_sec != y->used.tv_sec) return x->used.tv_sec < y->used.tv_sec ? -1 : 1;
+  if (x->used.tv_nsec != y->used.tv_nsec) return x->used.tv_nsec < y->used.tv_nsec ? -1 : 1;
+  return 0;
+}
+
+/* procedure evict removes least recently used entries until
+ * the cache is back under 90% of its cap.  Only one process
+ * evicts at a time; the others skip eviction meanwhile.
+ */
+static void evict(CompileCache *cache) {
+  size_t dirLen = strlen(cache->dir);
+  char *lockPath = malloc(dirLen + sizeof("/lock"));
+  struct Entry *entries = NULL;
+  size_t nEntries = 0, capEntries = 0, i;
+  unsigned long long total = 0;
+  time_t now = time(NULL);
+  struct dirent *de;
+  DIR *dir;
+  int lockFd;
+
+  if (lockPath == NULL) return;
+  sprintf(lockPath, "%s/lock", cache->dir);
+  lockFd = open(lockPath, O_RDWR | O_CREAT, 0666);
+  free(lockPath);
+  if (lockFd < 0) return;
+  if (flock(lockFd, LOCK_EX | LOCK_NB) != 0) {
+    close(lockFd);
+    return;
+  }
+
+  dir = opendir(cache->dir);
+  while (dir != NULL && (de = readdir(dir)) != NULL) {
+    size_t len = strlen(de->d_name);
+    int isEntry = len > strlen(ENTRY_SUFFIX) &&
+      strcmp(de->d_name + len - strlen(ENTRY_SUFFIX), ENTRY_SUFFIX) == 0;
+    int isTemp = strncmp(de->d_name, TEMP_PREFIX, strlen(TEMP_PREFIX)) == 0;
+    struct stat st;
+
+    if (!isEntry && !isTemp) continue;
+    if (fstatat(dirfd(dir), de->d_name, &st, 0) != 0) continue;
+    if (isTemp) {
+      if (now - st.st_mtime > STALE_TEMP_SECONDS) unlinkat(dirfd(dir), de->d_name, 0);
+      continue;
+    }
+    if (nEntries == capEntries) {
+      struct Entry *grown;
+      capEntries = capEntries ? capEntries * 2 : 256;
+      grown = realloc(entries, capEntries * sizeof(struct Entry));
+      if (grown == NULL) break;
+      entries = grown;
+    }
+    entries[nEntries].name = strdup(de->d_name);
+    if (entries[nEntries].name == NULL) break;
+    entries[nEntries].size = st.st_size;
+    entries[nEntries].used = st.st_mtim;
+    total += st.st_size;
+    ++nEntries;
+  }
+
+  if (total > cache->maxBytes) {
+    unsigned long long target = cache->maxBytes / 10 * 9;
+    qsort(entries, nEntries, sizeof(struct Entry), compareEntries);
+    for (i = 0; i < nEntries && total > target; ++i) {
+      if (unlinkat(dirfd(dir), entries[i].name, 0) == 0) total -= entries[i].size;
+    }
+  }
+
+  for (i = 0; i < nEntries; ++i) free(entries[i].name);
+  free(entries);
+  if (dir != NULL) closedir(dir);
+  flock(lockFd, LOCK_UN);
+  close(lockFd);
+}
+
+/* writeEntry writes an entry to a fresh temporary file and
+ * renames it into place, so readers only ever see complete
+ * entries.  Returns TRUE on success.
+ */
+static int writeEntry(CompileCache *cache, char const *path,
+                      int status, char const *listing, size_t listingSize,
+                      char const *code, size_t codeSize) {
+  char *tempPath = malloc(strlen(cache->dir) + sizeof("/" TEMP_PREFIX "XXXXXX"));
+  int fd, ok;
+  FILE *fp;
+
+  if (tempPath == NULL) return FALSE;
+  sprintf(tempPath, "%s/" TEMP_PREFIX "XXXXXX", cache->dir);
+  fd = mkstemp(tempPath);
+  if (fd < 0) {
+    free(tempPath);
+    return FALSE;
+  }
+  fchmod(fd, 0644);
+  fp = fdopen(fd, "wb");
+  if (fp == NULL) {
+    close(fd);
+    unlink(tempPath);
+    free(tempPath);
+    return FALSE;
+  }
+
+  fputs(ENTRY_MAGIC, fp);
+  fprintf(fp, "%d %zu %zu\n", status, listingSize, codeSize);
+  fwrite(listing, 1, listingSize, fp);
+  fwrite(code, 1, codeSize, fp);
+  ok = !ferror(fp);
+  if (fclose(fp) != 0) ok = FALSE;
+
+  if (!ok || rename(tempPath, path) != 0) {
+    unlink(tempPath);
+    ok = FALSE;
+  }
+  free(tempPath);
+  return ok;
+}
+
+void storeCache(CompileCache *cache, unsigned char const key[SHA256_DIGEST_SIZE],
+                int status, char const *listing, size_t listingSize,
+                char const *code, size_t codeSize) {
+  char *path = entryPath(cache, key);
+  int evictNow = FALSE;
+
+  if (path != NULL && writeEntry(cache, path, status, listing, listingSize, code, codeSize)) {
+    pthread_mutex_lock(&cache->lock);
+    cache->bytesSinceEviction += listingSize + codeSize;
+    evictNow = cache->bytesSinceEviction > cache->maxBytes / 8;
+    if (evictNow) cache->bytesSinceEviction = 0;
+    pthread_mutex_unlock(&cache->lock);
+  }
+  free(path);
+  if (evictNow) evict(cache);
+}
+
+void cacheStats(CompileCache *cache, unsigned long *hits, unsigned long *misses) {
+  pthread_mutex_lock(&cache->lock);
+  *hits = cache->hits;
+  *misses = cache->misses;
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void closeCache(CompileCache *cache) {
+  if (cache == NULL) return;
+  if (cache->bytesSinceEviction > 0) evict(cache);
+  pthread_mutex_destroy(&cache->lock);
+  free(cache->dir);
+  free(cache);
+}
@@ -0,0 +1,53 @@
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <stddef.h>
+#include "sha256.h"
+
+/* The compile cache keeps the status, listing and code of
+ * every compilation in a directory, one file per
+ * entry named after a SHA-256 key over the compiler
+ * binary, the tracing flags and the source text.
+ * Entries are written to a temporary file and renamed
+ * into place, so concurrent compilers never see a partial
+ * entry.  The least recently used entries (by mtime) are
+ * evicted once the directory grows past its size cap.
+ * One CompileCache may be shared by several threads.
+ */
+typedef struct CompileCache CompileCache;
+
+/* Function openCache opens or creates the cache directory;
+ * maxBytes caps the total size of its entries.
+ * Returns NULL if the directory is unusable.
+ */
+CompileCache *openCache(char const *dir, size_t maxBytes);
+
+/* procedure closeCache evicts entries if needed and
+ * releases the cache
+ */
+void closeCache(CompileCache *cache);
+
+/* procedure cacheKey computes the key of compiling text
+ * with the tracing flags of ctx
+ */
+void cacheKey(CompileCache *cache, CompileContext *ctx,
+              char const *text, size_t size,
+              unsigned char key[SHA256_DIGEST_SIZE]);
+
+/* Function lookupCache finds the entry for key and returns
+ * its CompileStatus, and its listing and code in malloc'ed
+ * buffers.  Returns TRUE on a hit.
+ */
+int lookupCache(CompileCache *cache, unsigned char const key[SHA256_DIGEST_SIZE],
+                int *status, char **listing, size_t *listingSize,
+                char **code, size_t *codeSize);
+
+/* procedure storeCache adds an entry for key */
+void storeCache(CompileCache *cache, unsigned char const key[SHA256_DIGEST_SIZE],
+                int status, char const *listing, size_t listingSize,
+                char const *code, size_t codeSize);
+
+/* procedure cacheStats returns the hit and miss counts */
+void cacheStats(CompileCache *cache, unsigned long *hits, unsigned long *misses);
+
+#endif
@@ -1,324 +1,609 @@
 #include "globals.h"
-#include "analyze.h"
 #include "cgen.h"
 #include "code.h"
-
-enum label {
-  IF_LABEL,
-  ITER_LABEL,
-  RET_LABEL
+#include "ir.h"
+#include "opt.h"
+#include "arena.h"
+
+/* The code of a function is emitted from its IR, block by
+ * block in layout order.  Temporaries live in the $t
+ * registers from their definition to their last use; when
+ * the registers run out, the one used last is spilled to
+ * a slot of the frame, and the temporaries in registers
+ * are spilled across a call.  A spilled temporary, like a
+ * variable in memory or a constant, is loaded into a
+ * scratch register where it is used.
+ *
+ * Above -O0, scalar locals and parameters are kept in
+ * $s0-$s7 when they are used often enough to pay for
+ * saving the register.  The uses of each one are counted,
+ * ten times over for every loop around them, and the
+ * hottest ones take a register first; two variables never
+ * live at the same time may share one.  The rest stay in
+ * their stack slots.
+ */
+#define MIN_HOME_WEIGHT 3
+
+struct FunctionGen {
+  IrFunction *fn;
+
+  /* by variable: its $s register or REG_NONE, and its
+     relative offset if it is in the frame */
+  Reg *home;
+  int *varOffset;
+
+  /* by temporary: the index of its last use in its block,
+     -1 for none, its spill slot and its register, REG_NONE
+     while spilled */
+  int *lastUse;
+  int *slot;
+  Reg *tempReg;
+
+  /* the temporary in every $t register, -1 for none */
+  int regTemp[N_TEMP_REGS];
+
+  char *labelled; /* by block id */
 };
 
-static int labelCounterIF = 0;
-static int labelCounterITER = 0;
-static int labelCounterRET = 0;
-
-static char currentRetLabel[64];
-
-static char const *nextLabel(enum label label) {
-  static char _buf[64];
-  switch(label) {
-  case IF_LABEL:
-    sprintf(_buf, "IF_%d", labelCounterIF);
-    ++labelCounterIF;
-    break;
-  case ITER_LABEL:
-    sprintf(_buf, "ITER_%d", labelCounterITER);
-    ++labelCounterITER;
-    break;
-  case RET_LABEL:
-    sprintf(_buf, "RET_%d", labelCounterRET);
-    ++labelCounterRET;
-    break;
-  }
-
-  return _buf;
-}
-
-static void genStatement(TreeNode *tnode);
-static void genCompdStmt(TreeNode *tnode);
-static void genSelectStmt(TreeNode *tnode);
-static void genIterStmt(TreeNode *tnode);
-static void genRetStmt(TreeNode *tnode);
-static void genArgExpression(TreeNode *exprNode);
-static void genExpression(TreeNode *tnode);
-static void genAssignExpr(TreeNode *tnode);
-static void genBinaryExpr(TreeNode *tnode);
-
-static void genArrayAddr(TreeNode *tnode);
-static void genVarExprLHS(TreeNode *tnode);
-static void genArrayExprLHS(TreeNode *tnode);
-static void genVarExpr(TreeNode *tnode);
-static void genArrayExpr(TreeNode *tnode);
-static void genCallExpr(TreeNode *tnode);
-
 static int normalizeLocalOffset(int offset) {
   assert((offset + 400) % 4 == 0);
   return offset / 4;
 }
 
-static void genStatement(TreeNode *stmtNode) {
-  assert(stmtNode->nodekind == StmtK || stmtNode->nodekind == ExprK);
-
-  if(stmtNode->nodekind == StmtK) {
-    if(stmtNode->kind.stmt == CompdK) {
-      genCompdStmt(stmtNode);
-    }
-    else if(stmtNode->kind.stmt == SelectK) {
-      genSelectStmt(stmtNode);
-    }
-    else if(stmtNode->kind.stmt == IterK) {
-      genIterStmt(stmtNode);
-    }
-    else if(stmtNode->kind.stmt == RetK) {
-      genRetStmt(stmtNode);
-    }
-    else {
-      assert(!"unreachable");
-    }
-  }
-  else {
-    assert(stmtNode->nodekind == ExprK);
-    emitComment("**** statement of a expression ****");
-    genExpression(stmtNode);
-    emitComment("**** ************************* ****");
-    emitComment("\n");
-  }
+static char const *blockLabel(CompileContext *ctx, IrBlock *block, char *_buf) {
+  sprintf(_buf, "L%d", ctx->cgen->labelBase + block->id);
+  return _buf;
 }
 
-static void genCompdStmt(TreeNode *tnode) {
-  assert(tnode->nodekind == StmtK && tnode->kind.stmt == CompdK);
-
-  struct ScopeRec *scopeRef = tnode->scope_ref;
-  int blockSize = scopeRef->blockSize;
+/**** choosing the homes of the variables ****/
 
-  emitBlockEnter(blockSize);
+static int isHomeCandidate(IrVar const *var) {
+  return !var->global && !var->array;
+}
 
-  TreeNode *stmtNode = tnode->child[1];
-  while(stmtNode) {
-    genStatement(stmtNode);
-    stmtNode = stmtNode->sibling;
-  }
+struct WeightScan {
+  int *weight;
+  int w;
+};
 
-  emitBlockExit(blockSize);
+static void addWeight(Operand *opd, void *arg) {
+  struct WeightScan *scan = arg;
+  if(opd->kind == OPD_VAR) scan->weight[opd->val] += scan->w;
 }
 
-static void genSelectStmt(TreeNode *tnode) {
-  if(tnode->nChildren == 2) {
-    char label0[64];
-    strcpy(label0, nextLabel(IF_LABEL));
+struct Interference {
+  int *cand;     /* by variable: candidate number or -1 */
+  int nCands;
+  unsigned char *edges; /* nCands * nCands */
+};
 
-    genExpression(tnode->child[0]);
-    emitBranching(label0, 0);
-    genStatement(tnode->child[1]);
-    emitLabel(label0);
-  }
-  else {
-    char label0[64], label1[64];
-    strcpy(label0, nextLabel(IF_LABEL));
-    strcpy(label1, nextLabel(IF_LABEL));
-
-    genExpression(tnode->child[0]);
-    emitBranching(label0, 0);
-    genStatement(tnode->child[1]);
-    emitUncondBranching(label1);
-    emitLabel(label0);
-    genStatement(tnode->child[2]);
-    emitLabel(label1);
-  }
+static void interfere(struct Interference *g, int v, int w) {
+  int a = g->cand[v], b = g->cand[w];
+  if(a < 0 || b < 0 || a == b) return;
+  g->edges[a * g->nCands + b] = 1;
+  g->edges[b * g->nCands + a] = 1;
 }
 
-static void genIterStmt(TreeNode *tnode) {
-  char label0[64], label1[64];
-  strcpy(label0, nextLabel(ITER_LABEL));
-  strcpy(label1, nextLabel(ITER_LABEL));
-
-  emitLabel(label0);
-  genExpression(tnode->child[0]);
-  emitBranching(label1, 0);
-  genStatement(tnode->child[1]);
-  emitUncondBranching(label0);
-  emitLabel(label1);
+static void markLiveVar(Operand *opd, void *arg) {
+  if(opd->kind == OPD_VAR) LIVE_SET((unsigned *)arg, opd->val);
 }
 
-static void genRetStmt(TreeNode *tnode) {
-  if(tnode->nChildren == 1) {
-    genExpression(tnode->child[0]);
+/* buildInterference connects every variable defined with
+ * the variables live there, the source of a move aside */
+static void buildInterference(CompileContext *ctx, IrFunction *fn, struct Interference *g) {
+  unsigned *live = irAlloc(ctx, LIVE_WORDS(fn), sizeof(unsigned));
+  int i, j, v, w;
+
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    memcpy(live, block->liveOut, LIVE_WORDS(fn) * sizeof(unsigned));
+    termUses(block, markLiveVar, live);
+
+    for(j = block->nInstrs; j-- > 0; ) {
+      IrInstr *instr = &block->instrs[j];
+      if(instr->dst.kind == OPD_VAR) {
+        int d = instr->dst.val;
+        for(v = 0; v < fn->nVars; ++v) {
+          if(!LIVE_TEST(live, v)) continue;
+          if(instr->op == IR_MOVE && instr->a.kind == OPD_VAR && instr->a.val == v) continue;
+          interfere(g, d, v);
+        }
+        LIVE_CLEAR(live, d);
+      }
+      instrUses(instr, markLiveVar, live);
+    }
+  }
+
+  // the parameters, and whatever is read before being set,
+  // all have their values on entry
+  for(v = 0; v < fn->nVars; ++v) {
+    if(!LIVE_TEST(fn->blocks[0]->liveIn, v)) continue;
+    for(w = v + 1; w < fn->nVars; ++w) {
+      if(LIVE_TEST(fn->blocks[0]->liveIn, w)) interfere(g, v, w);
+    }
   }
-  emitUncondBranching(currentRetLabel);
 }
 
-static void genArgExpression(TreeNode *exprNode) {
-  assert(exprNode->nodekind == ExprK);
+struct Candidate {
+  int var;
+  int weight;
+};
 
-  ExprKind kind = exprNode->kind.expr;
-  int flag = 0;
+static int compareCandidates(void const *a, void const *b) {
+  struct Candidate const *x = a, *y = b;
+  if(x->weight != y->weight) return x->weight > y->weight ? -1 : 1;
+  return x->var < y->var ? -1 : x->var > y->var;
+}
 
-  if(kind == VarK) {
-    TreeNode *declNode = getTreeNode(exprNode->sym_ref);
-    if(declNode->child[0]->attr.val >= 0) {
-      flag = 1;
+/* chooseHomes fills in fg->home and returns the $s
+ * registers used, one bit per register from $s0 */
+static unsigned chooseHomes(CompileContext *ctx, struct FunctionGen *fg) {
+  static int const loopWeight[] = { 1, 10, 100, 1000, 10000 };
+  IrFunction *fn = fg->fn;
+  struct WeightScan scan;
+  struct Interference g;
+  struct Candidate *order;
+  int *weight;
+  unsigned used = 0;
+  int i, j, v;
+
+  for(v = 0; v < fn->nVars; ++v) fg->home[v] = REG_NONE;
+  if(ctx->optLevel < 1) return 0;
+
+  weight = irAlloc(ctx, fn->nVars, sizeof(int));
+  scan.weight = weight;
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    scan.w = loopWeight[block->loopDepth < 4 ? block->loopDepth : 4];
+    for(j = 0; j < block->nInstrs; ++j) {
+      IrInstr *instr = &block->instrs[j];
+      if(instr->dst.kind == OPD_VAR) weight[instr->dst.val] += scan.w;
+      instrUses(instr, addWeight, &scan);
     }
+    termUses(block, addWeight, &scan);
   }
 
-  if(flag) {
-    genArrayAddr(exprNode);
+  g.cand = irAlloc(ctx, fn->nVars, sizeof(int));
+  order = irAlloc(ctx, fn->nVars, sizeof(struct Candidate));
+  g.nCands = 0;
+  for(v = 0; v < fn->nVars; ++v) {
+    g.cand[v] = -1;
+    if(!isHomeCandidate(&fn->vars[v]) || weight[v] < MIN_HOME_WEIGHT) continue;
+    order[g.nCands].var = v;
+    order[g.nCands].weight = weight[v];
+    g.cand[v] = g.nCands++;
   }
-  else {
-    genExpression(exprNode);
+  if(g.nCands == 0) return 0;
+
+  computeLiveness(ctx, fn);
+  g.edges = irAlloc(ctx, (size_t)g.nCands * g.nCands, 1);
+  buildInterference(ctx, fn, &g);
+
+  qsort(order, g.nCands, sizeof(struct Candidate), compareCandidates);
+
+  for(i = 0; i < g.nCands; ++i) {
+    unsigned busy = 0;
+    v = order[i].var;
+    for(j = 0; j < i; ++j) {
+      int w = order[j].var;
+      if(fg->home[w] != REG_NONE && g.edges[g.cand[v] * g.nCands + g.cand[w]]) {
+        busy |= 1u << (fg->home[w] - REG_S0);
+      }
+    }
+    for(j = 0; j < N_SAVED_REGS; ++j) {
+      if(busy & 1u << j) continue;
+      fg->home[v] = REG_S0 + j;
+      used |= 1u << j;
+      break;
+    }
   }
+  return used;
 }
 
-/* RHS expression gen */
-static void genExpression(TreeNode *exprNode) {
-  // always end on $v0
+/**** frame layout ****/
 
-  assert(exprNode->nodekind == ExprK);
+struct SlotScan {
+  struct FunctionGen *fg;
+  int index;
+};
 
-  ExprKind kind = exprNode->kind.expr;
+static void noteUse(Operand *opd, void *arg) {
+  struct SlotScan *scan = arg;
+  if(opd->kind == OPD_TEMP) scan->fg->lastUse[opd->val] = scan->index;
+}
 
-  if(kind == VarK) {
-    genVarExpr(exprNode);
+/* layoutFrame places the variables kept in the frame and
+ * gives every temporary a spill slot, sharing slots
+ * between temporaries not live at the same time; returns
+ * the words of the frame below the saved registers */
+static int layoutFrame(CompileContext *ctx, struct FunctionGen *fg) {
+  IrFunction *fn = fg->fn;
+  struct SlotScan scan;
+  char *slotBusy = irAlloc(ctx, fn->nTemps, 1);
+  int words = 0, nSlots = 0;
+  int i, j, v, t;
+
+  for(v = 0; v < fn->nVars; ++v) {
+    IrVar *var = &fn->vars[v];
+    if(var->global || var->decl == NULL) continue;
+    fg->varOffset[v] = normalizeLocalOffset(var->loc);
+    if(!var->param && -(fg->varOffset[v] + 1) > words) words = -(fg->varOffset[v] + 1);
   }
-  else if(kind == OpExprK) {
-    if(exprNode->attr.op == ASSIGN) {
-      genAssignExpr(exprNode);
-    }
-    else if(exprNode->attr.op == LBRACKET) {
-      genArrayExpr(exprNode);
-    }
-    else {
-      genBinaryExpr(exprNode);
-    }
-  }
-  else if(kind == CallK) {
-    genCallExpr(exprNode);
-  }
-  else {
-    assert(kind == ConstK);
-    emitConstExpr(exprNode->attr.val);
+  for(v = 0; v < fn->nVars; ++v) {
+    IrVar *var = &fn->vars[v];
+    if(var->global || var->decl != NULL || fg->home[v] != REG_NONE) continue;
+    fg->varOffset[v] = -(++words + 1);
   }
 
-}
-
-static void genAssignExpr(TreeNode *tnode) {
-  TreeNode *lhs, *rhs;
-  lhs = tnode->child[0];
-  rhs = tnode->child[1];
-
-  if(lhs->kind.expr == VarK) {
-    genVarExprLHS(lhs);
+  for(t = 0; t < fn->nTemps; ++t) fg->lastUse[t] = -1;
+  scan.fg = fg;
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    for(j = 0; j < block->nInstrs; ++j) {
+      scan.index = j;
+      instrUses(&block->instrs[j], noteUse, &scan);
+    }
+    scan.index = block->nInstrs;
+    termUses(block, noteUse, &scan);
   }
-  else {
-    assert(lhs->kind.expr == OpExprK && lhs->attr.op == LBRACKET);
-    genArrayExprLHS(lhs);
+
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    for(j = 0; j < block->nInstrs; ++j) {
+      IrInstr *instr = &block->instrs[j];
+      Operand *opds[2] = { &instr->a, &instr->b };
+      int k, s;
+      for(k = 0; k < 2; ++k) {
+        if(opds[k]->kind == OPD_TEMP && fg->lastUse[opds[k]->val] == j) {
+          slotBusy[fg->slot[opds[k]->val]] = FALSE;
+        }
+      }
+      if(instr->dst.kind != OPD_TEMP || fg->lastUse[instr->dst.val] < 0) continue;
+      for(s = 0; slotBusy[s]; ++s) { }
+      slotBusy[s] = TRUE;
+      fg->slot[instr->dst.val] = s;
+      if(s >= nSlots) nSlots = s + 1;
+    }
+    // no temporary outlives its block
+    memset(slotBusy, 0, fn->nTemps);
   }
-  emitPushValue();
 
-  genExpression(rhs);
-  emitPopLHS();
+  for(t = 0; t < fn->nTemps; ++t) fg->slot[t] = -(words + fg->slot[t] + 2);
+  return words + nSlots;
+}
 
-  emitBinaryOp(ASSIGN);
+/**** temporaries and operands ****/
 
-  // $v0 holds rhs value
+static int isPoolReg(Reg reg) {
+  return reg < N_TEMP_REGS;
 }
 
-static void genBinaryExpr(TreeNode *tnode) {
-  TreeNode *lhs, *rhs;
-  lhs = tnode->child[0];
-  rhs = tnode->child[1];
+static void spillTemp(CompileContext *ctx, struct FunctionGen *fg, Reg reg) {
+  int temp = fg->regTemp[reg];
+  emitLocalRef(ctx, reg, fg->slot[temp], SET_VALUE);
+  fg->tempReg[temp] = REG_NONE;
+  fg->regTemp[reg] = -1;
+}
 
-  genExpression(lhs);
-  emitPushValue();
+/* allocTemp gives temp a register, spilling the temporary
+ * used last if there is none free */
+static Reg allocTemp(CompileContext *ctx, struct FunctionGen *fg, int temp) {
+  Reg reg, victim = REG_T0;
+  for(reg = 0; isPoolReg(reg); ++reg) {
+    if(fg->regTemp[reg] < 0) break;
+    if(fg->lastUse[fg->regTemp[reg]] > fg->lastUse[fg->regTemp[victim]]) victim = reg;
+  }
+  if(!isPoolReg(reg)) {
+    reg = victim;
+    spillTemp(ctx, fg, reg);
+  }
+  fg->regTemp[reg] = temp;
+  fg->tempReg[temp] = reg;
+  return reg;
+}
 
-  genExpression(rhs);
-  emitPopLHS();
+static void releaseTemp(struct FunctionGen *fg, Operand opd, int index) {
+  Reg reg;
+  if(opd.kind != OPD_TEMP || fg->lastUse[opd.val] != index) return;
+  reg = fg->tempReg[opd.val];
+  if(reg == REG_NONE) return;
+  fg->regTemp[reg] = -1;
+  fg->tempReg[opd.val] = REG_NONE;
+}
 
-  emitBinaryOp(tnode->attr.op);
+static void accessVar(CompileContext *ctx, struct FunctionGen *fg, int v, Reg reg,
+                      enum addressing_mode mode) {
+  IrVar *var = &fg->fn->vars[v];
+  if(var->global) emitGlobalRef(ctx, reg, var->name, mode);
+  else emitLocalRef(ctx, reg, fg->varOffset[v], mode);
 }
 
-static void genArrayAddr(TreeNode *tnode) {
-  int isPointer = getTreeNode(tnode->sym_ref)->child[0]->attr.val == 0;
-  if(isPointer) genVarExpr(tnode);
-  else genVarExprLHS(tnode);
+/* useOperand returns the register holding an operand,
+ * loading it into scratch if need be */
+static Reg useOperand(CompileContext *ctx, struct FunctionGen *fg, Operand opd, Reg scratch) {
+  switch(opd.kind) {
+  case OPD_TEMP:
+    if(fg->tempReg[opd.val] != REG_NONE) return fg->tempReg[opd.val];
+    emitLocalRef(ctx, scratch, fg->slot[opd.val], GET_VALUE);
+    return scratch;
+  case OPD_CONST:
+    if(opd.val == 0) return REG_ZERO;
+    emitConstExpr(ctx, scratch, opd.val);
+    return scratch;
+  case OPD_VAR:
+    if(fg->home[opd.val] != REG_NONE) return fg->home[opd.val];
+    accessVar(ctx, fg, opd.val, scratch, GET_VALUE);
+    return scratch;
+  default:
+    assert(!"unreachable code");
+    return scratch;
+  }
 }
 
-static void genVarExprLHS(TreeNode *tnode) {
-  struct ScopeRec *scope_ref = tnode->scope_ref;
-  if(scope_ref->scopeId == 0) {
-    emitGlobalRef(tnode->attr.name, GET_ADDRESS);
+/* defReg returns the register to compute dst into;
+ * finishDef then stores it if dst is in memory.  A
+ * division kept only for its trap has no dst. */
+static Reg defReg(CompileContext *ctx, struct FunctionGen *fg, Operand dst) {
+  if(dst.kind == OPD_NONE) return REG_V1;
+  if(dst.kind == OPD_TEMP) {
+    if(fg->lastUse[dst.val] < 0) return REG_V1;
+    return allocTemp(ctx, fg, dst.val);
   }
-  else {
-    int relativeOffset = normalizeLocalOffset(tnode->loc);
-    emitLocalRef(relativeOffset, GET_ADDRESS);
+  assert(dst.kind == OPD_VAR);
+  if(fg->home[dst.val] != REG_NONE) return fg->home[dst.val];
+  return REG_V1;
+}
+
+static void finishDef(CompileContext *ctx, struct FunctionGen *fg, Operand dst, Reg reg) {
+  if(dst.kind == OPD_VAR && fg->home[dst.val] == REG_NONE) {
+    accessVar(ctx, fg, dst.val, reg, SET_VALUE);
   }
 }
 
-static void genArrayExprLHS(TreeNode *tnode) {
-  genArrayAddr(tnode->child[0]);
-  emitPushValue();
+/* defineFrom sets dst to the value in src */
+static void defineFrom(CompileContext *ctx, struct FunctionGen *fg, Operand dst, Reg src) {
+  if(dst.kind == OPD_NONE) return;
+  if(dst.kind == OPD_TEMP && fg->lastUse[dst.val] < 0) return;
+  if(dst.kind == OPD_VAR && fg->home[dst.val] == REG_NONE) {
+    accessVar(ctx, fg, dst.val, src, SET_VALUE);
+    return;
+  }
+  emitMove(ctx, defReg(ctx, fg, dst), src);
+}
 
-  genExpression(tnode->child[1]);
-  emitPopLHS();
+/**** instructions ****/
 
-  emitArrayOp(GET_ADDRESS);
-}
+/* genByConstant does a multiplication or a division by a
+ * constant without mul or div where that is cheaper,
+ * returning FALSE when it is not */
+static int genByConstant(CompileContext *ctx, struct FunctionGen *fg, IrInstr *instr, int index) {
+  Operand x = instr->a, c = instr->b;
+  Reg a, reg;
 
-static void genVarExpr(TreeNode *tnode) {
-  struct ScopeRec *scope_ref = tnode->scope_ref;
-  if(scope_ref->scopeId == 0) {
-    emitGlobalRef(tnode->attr.name, GET_VALUE);
-  }
-  else {
-    int relativeOffset = normalizeLocalOffset(tnode->loc);
-    emitLocalRef(relativeOffset, GET_VALUE);
+  if(ctx->optLevel < 1) return FALSE;
+  if(instr->op == IR_MUL && x.kind == OPD_CONST) {
+    x = instr->b;
+    c = instr->a;
   }
+  if(c.kind != OPD_CONST || x.kind == OPD_CONST) return FALSE;
+  if(instr->op == IR_MUL ? !isCheapMultiplier(c.val) :
+     instr->op != IR_DIV || !isCheapDivisor(c.val)) return FALSE;
+
+  a = useOperand(ctx, fg, x, REG_V1);
+  releaseTemp(fg, x, index);
+  reg = defReg(ctx, fg, instr->dst);
+  if(instr->op == IR_MUL) emitMultiplyConst(ctx, reg, a, c.val);
+  else emitDivideConst(ctx, reg, a, c.val);
+  finishDef(ctx, fg, instr->dst, reg);
+  return TRUE;
 }
 
-static void genArrayExpr(TreeNode *tnode) {
-  genArrayAddr(tnode->child[0]);
-  emitPushValue();
+static void genInstr(CompileContext *ctx, struct FunctionGen *fg, IrInstr *instr, int index) {
+  IrVar *var;
+  Reg a, b, reg;
+
+  switch(instr->op) {
+  case IR_MOVE:
+    if(instr->dst.kind == OPD_TEMP && fg->lastUse[instr->dst.val] < 0) return;
+    if(instr->a.kind != OPD_TEMP &&
+       !(instr->dst.kind == OPD_VAR && fg->home[instr->dst.val] == REG_NONE)) {
+      // a constant or a variable goes straight into the register of dst
+      reg = defReg(ctx, fg, instr->dst);
+      a = useOperand(ctx, fg, instr->a, reg);
+      if(a != reg) emitMove(ctx, reg, a);
+      return;
+    }
+    a = useOperand(ctx, fg, instr->a, REG_V1);
+    releaseTemp(fg, instr->a, index);
+    defineFrom(ctx, fg, instr->dst, a);
+    return;
 
-  genExpression(tnode->child[1]);
-  emitPopLHS();
+  case IR_ADDR:
+    var = &fg->fn->vars[instr->a.val];
+    reg = defReg(ctx, fg, instr->dst);
+    // an array parameter holds the address
+    accessVar(ctx, fg, instr->a.val, reg, var->param ? GET_VALUE : GET_ADDRESS);
+    finishDef(ctx, fg, instr->dst, reg);
+    return;
 
-  emitArrayOp(GET_VALUE);
-}
+  case IR_LOAD:
+    a = useOperand(ctx, fg, instr->a, REG_V1);
+    releaseTemp(fg, instr->a, index);
+    reg = defReg(ctx, fg, instr->dst);
+    emitMemoryOp(ctx, GET_VALUE, reg, a);
+    finishDef(ctx, fg, instr->dst, reg);
+    return;
 
-static void genCallExpr(TreeNode *tnode) {
-  char const *name = tnode->attr.name;
-  TreeNode *argNode = tnode->child[0];
+  case IR_STORE:
+    a = useOperand(ctx, fg, instr->a, REG_V1);
+    b = useOperand(ctx, fg, instr->b, REG_A1);
+    releaseTemp(fg, instr->a, index);
+    releaseTemp(fg, instr->b, index);
+    emitMemoryOp(ctx, SET_VALUE, b, a);
+    return;
 
-  if(strcmp(name, "input") == 0) {
-    emitInputSyscall();
+  case IR_ARG:
+    a = useOperand(ctx, fg, instr->a, REG_V1);
+    releaseTemp(fg, instr->a, index);
+    emitPushValue(ctx, a);
     return;
-  }
-  else if(strcmp(name, "output") == 0) {
-    genExpression(argNode);
-    emitOutputSyscall();
+
+  case IR_CALL:
+    // the callee is free to use every $t register
+    for(reg = 0; isPoolReg(reg); ++reg) {
+      if(fg->regTemp[reg] >= 0) spillTemp(ctx, fg, reg);
+    }
+    emitCallFunction(ctx, instr->name);
+    emitPopMultiple(ctx, instr->nArgs);
+    defineFrom(ctx, fg, instr->dst, REG_V0);
+    return;
+
+  case IR_INPUT:
+    emitInputSyscall(ctx);
+    defineFrom(ctx, fg, instr->dst, REG_V0);
+    return;
+
+  case IR_OUTPUT:
+    a = useOperand(ctx, fg, instr->a, REG_V1);
+    releaseTemp(fg, instr->a, index);
+    emitOutputSyscall(ctx, a);
+    return;
+
+  default:
+    assert(IR_IS_BINARY(instr->op));
+    if(genByConstant(ctx, fg, instr, index)) return;
+    a = useOperand(ctx, fg, instr->a, REG_V1);
+    if(instr->op == IR_SLL) {
+      assert(instr->b.kind == OPD_CONST);
+      releaseTemp(fg, instr->a, index);
+      reg = defReg(ctx, fg, instr->dst);
+      emitShiftLeft(ctx, reg, a, instr->b.val);
+    }
+    else {
+      b = useOperand(ctx, fg, instr->b, REG_A1);
+      releaseTemp(fg, instr->a, index);
+      releaseTemp(fg, instr->b, index);
+      reg = defReg(ctx, fg, instr->dst);
+      emitBinaryOp(ctx, instr->op, reg, a, b);
+    }
+    finishDef(ctx, fg, instr->dst, reg);
     return;
   }
+}
 
-  int cnt = 0;
-  while(argNode) {
-    genArgExpression(argNode);
-    emitPushValue();
+/* genTerm ends the block at position i of the layout,
+ * falling through to the next block where it can */
+static void genTerm(CompileContext *ctx, struct FunctionGen *fg, int i) {
+  IrFunction *fn = fg->fn;
+  IrBlock *block = fn->blocks[i];
+  IrBlock *next = i + 1 < fn->nBlocks ? fn->blocks[i + 1] : NULL;
+  char label[64];
+  Reg a, b;
+
+  switch(block->term) {
+  case TERM_JUMP:
+    if(block->succ[0] != next) emitUncondBranching(ctx, blockLabel(ctx, block->succ[0], label));
+    break;
+
+  case TERM_BRANCH:
+    a = useOperand(ctx, fg, block->a, REG_V1);
+    b = useOperand(ctx, fg, block->b, REG_A1);
+    releaseTemp(fg, block->a, block->nInstrs);
+    releaseTemp(fg, block->b, block->nInstrs);
+    if(block->succ[0] == next) {
+      emitCompareBranch(ctx, invertCompare(block->cmp), a, b, blockLabel(ctx, block->succ[1], label));
+    }
+    else {
+      emitCompareBranch(ctx, block->cmp, a, b, blockLabel(ctx, block->succ[0], label));
+      if(block->succ[1] != next) emitUncondBranching(ctx, blockLabel(ctx, block->succ[1], label));
+    }
+    break;
 
-    argNode = argNode->sibling;
-    ++cnt;
+  case TERM_RETURN:
+    if(block->a.kind != OPD_NONE) {
+      a = useOperand(ctx, fg, block->a, REG_V0);
+      releaseTemp(fg, block->a, block->nInstrs);
+      emitMove(ctx, REG_V0, a);
+    }
+    if(next != NULL) emitUncondBranching(ctx, ctx->cgen->currentRetLabel);
+    break;
   }
+}
 
-  emitCallFunction(name);
-  emitPopMultiple(cnt);
+/* markLabels flags the blocks genTerm branches to */
+static void markLabels(struct FunctionGen *fg) {
+  IrFunction *fn = fg->fn;
+  int i;
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    IrBlock *next = i + 1 < fn->nBlocks ? fn->blocks[i + 1] : NULL;
+    if(block->term == TERM_JUMP) {
+      if(block->succ[0] != next) fg->labelled[block->succ[0]->id] = TRUE;
+    }
+    else if(block->term == TERM_BRANCH) {
+      if(block->succ[0] == next) fg->labelled[block->succ[1]->id] = TRUE;
+      else {
+        fg->labelled[block->succ[0]->id] = TRUE;
+        if(block->succ[1] != next) fg->labelled[block->succ[1]->id] = TRUE;
+      }
+    }
+  }
 }
 
-void codeGen(TreeNode *syntaxTree, char *codefile) {
-  char header[128] = " Compiled from ";
-  strcat(header, codefile);
-  emitComment(header);
-  fputc('\n', code);
+static void genFunction(CompileContext *ctx, IrFunction *fn) {
+  struct FunctionGen fg;
+  unsigned savedRegs;
+  char label[64];
+  int frameWords;
+  int i, j, v;
+
+  fg.fn = fn;
+  fg.home = irAlloc(ctx, fn->nVars, sizeof(Reg));
+  fg.varOffset = irAlloc(ctx, fn->nVars, sizeof(int));
+  fg.lastUse = irAlloc(ctx, fn->nTemps, sizeof(int));
+  fg.slot = irAlloc(ctx, fn->nTemps, sizeof(int));
+  fg.tempReg = irAlloc(ctx, fn->nTemps, sizeof(Reg));
+  fg.labelled = irAlloc(ctx, fn->nextBlockId, 1);
+  for(i = 0; i < N_TEMP_REGS; ++i) fg.regTemp[i] = -1;
+  for(i = 0; i < fn->nTemps; ++i) fg.tempReg[i] = REG_NONE;
+
+  savedRegs = chooseHomes(ctx, &fg);
+  frameWords = layoutFrame(ctx, &fg);
+  markLabels(&fg);
+
+  sprintf(ctx->cgen->currentRetLabel, "RET_%d", ctx->cgen->labelCounterRET++);
+  emitFunctionEnter(ctx, fn->name, savedRegs, frameWords);
+
+  // parameters arrive on the stack
+  for(v = 0; v < fn->nVars; ++v) {
+    if(fn->vars[v].param && fg.home[v] != REG_NONE && LIVE_TEST(fn->blocks[0]->liveIn, v)) {
+      emitLocalRef(ctx, fg.home[v], fg.varOffset[v], GET_VALUE);
+    }
+  }
 
-  emitInitial();
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    if(fg.labelled[block->id]) emitLabel(ctx, blockLabel(ctx, block, label));
+    for(j = 0; j < block->nInstrs; ++j) genInstr(ctx, &fg, &block->instrs[j], j);
+    genTerm(ctx, &fg, i);
+    for(j = 0; j < N_TEMP_REGS; ++j) assert(fg.regTemp[j] < 0);
+  }
+
+  emitRaw(ctx, "\n");
+  emitLabel(ctx, ctx->cgen->currentRetLabel);
+  emitFunctionExit(ctx);
+  ctx->cgen->labelBase += fn->nextBlockId;
+}
+
+void codeGen(CompileContext *ctx, TreeNode *syntaxTree) {
+  ctx->cgen = arenaCalloc(ctx->arena, 1, sizeof(struct CodeGenState));
+  if(ctx->cgen == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  ctx->cgen->section = NONE_SECTION;
+
+  emitInitial(ctx);
 
   TreeNode *pNode = syntaxTree;
 
@@ -328,25 +613,22 @@ void codeGen(TreeNode *syntaxTree, char *codefile) {
 
     if (pNode->kind.decl == VarDeclK) {
       // array size
-      int size = pNode->child[0]->attr.val;
+      int size = getChild(pNode, 0)->attr.val;
       // symbol name
       char const *name = pNode->attr.name;
       if (size == -1) size = 1;
       assert(size > 0);
 
       /* "memloc" is useless */
-      emitGlobalVariable(name, size * 4);
+      emitGlobalVariable(ctx, name, size * 4);
     } else {
-      char const *name = pNode->attr.name;
-
-      strcpy(currentRetLabel, nextLabel(RET_LABEL));
-
-      emitFunctionEnter(name);
-      genCompdStmt(pNode->child[2]);
-      emitRaw("\n");
-      emitLabel(currentRetLabel);
-      emitFunctionExit();
+      IrFunction *fn = lowerFunction(ctx, pNode);
+      if(TRACING(ctx, DumpIR)) printIrFunction(ctx, fn, "after lowering");
+      optimizeFunction(ctx, fn);
+      genFunction(ctx, fn);
     }
-    pNode = pNode->sibling;
+    pNode = getSibling(pNode);
   }
+
+  if(TRACING(ctx, TracePeephole)) printPeepholeStats(ctx);
 }
@@ -1,6 +1,9 @@
 #ifndef _CGEN_H_
 #define _CGEN_H_
 
-void codeGen(TreeNode *syntaxTree, char *codefile);
+/* procedure codeGen writes the code for a syntax tree to
+ * ctx->code; the header comment is written by emitHeader
+ */
+void codeGen(CompileContext *ctx, TreeNode *syntaxTree);
 
 #endif
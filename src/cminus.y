@@ -6,28 +6,30 @@
   #include "scan.h"
   #include "parse.h"
 
-  static char *savedName;
-  static int savedLineno;
-  static TreeNode *savedTree;
-
-  static int yyerror(char const *message);
-  static int yylex(void);
 %}
 
+%define api.pure full
+%parse-param {CompileContext *ctx}
+%lex-param {CompileContext *ctx}
+
 %union {
   TreeNode *treeNode;
+  NodeList nodeList;
   TokenType tok;
   char *identifier;
   int number;
 }
 
 %type <treeNode>
-  program declaration-list declaration var-declaration fun-declaration
-  params param-list param local-declarations statement-list
+  program declaration var-declaration fun-declaration
+  params param
   statement expression-stmt compound-stmt selection-stmt iteration-stmt return-stmt
-  expression simple-expression additive-expression var term factor call args arg-list
+  expression simple-expression additive-expression var term factor call args
   type-specifier
 
+%type <nodeList>
+  declaration-list param-list local-declarations statement-list arg-list
+
 %type <tok>
   relop addop mulop
 
@@ -40,112 +42,93 @@
 
 %right THEN ELSE
 
+%code {
+  static int yyerror(CompileContext *ctx, char const *message);
+  static int yylex(YYSTYPE *lval, CompileContext *ctx);
+}
+
 %%
-program: { savedTree = NULL; } declaration-list {
-  savedTree = $2;
+program: { ctx->syntaxTree = NULL; } declaration-list {
+  ctx->syntaxTree = $2.head;
 }
 ;
 declaration-list: declaration-list declaration {
-  TreeNode *t = $1;
-  if(t != NULL) {
-    while(t->sibling != NULL) t = t->sibling;
-    t->sibling = $2;
-    $$ = $1;
-  }
-  else $$ = $2;
+  $$ = appendNodeList($1, $2);
 }
 | declaration {
-  $$ = $1;
+  $$ = newNodeList($1);
 }
 ;
 declaration: var-declaration { $$ = $1; } | fun-declaration { $$ = $1; }
 ;
 var-declaration: type-specifier ID SEMI {
-  $$ = newDeclNode(VarDeclK);
-  $$->child[0] = $1;
+  $$ = newDeclNode(ctx, VarDeclK);
+  setChild($$, 0, $1);
   $$->attr.name = $2;
   $$->type = $1->type;
 }
 | type-specifier ID LBRACKET NUM RBRACKET SEMI {
-  $$ = newDeclNode(VarDeclK);
-  $$->child[0] = $1;
-  $$->child[0]->attr.val = $4;
+  $$ = newDeclNode(ctx, VarDeclK);
+  setChild($$, 0, $1);
+  getChild($$, 0)->attr.val = $4;
   $$->attr.name = $2;
   $$->type = $1->type;
 }
 ;
-type-specifier: INT { $$ = newTypeNode(); $$->type = IntK; }
-| VOID { $$ = newTypeNode(); $$->type = VoidK; }
+type-specifier: INT { $$ = newTypeNode(ctx); $$->type = IntK; }
+| VOID { $$ = newTypeNode(ctx); $$->type = VoidK; }
 ;
 fun-declaration: type-specifier ID LPAREN params RPAREN compound-stmt {
-  $$ = newDeclNode(FunDeclK);
-  $$->child[0] = $1;
+  $$ = newDeclNode(ctx, FunDeclK);
+  setChild($$, 0, $1);
   $$->attr.name = $2;
-  $$->child[1] = $4;
-  $$->child[2] = $6;
+  setChild($$, 1, $4);
+  setChild($$, 2, $6);
   $$->type = $1->type;
 }
 ;
 params: param-list {
-  $$ = $1;
+  $$ = $1.head;
 } | VOID {
-  $$ = newParamNode();
+  $$ = newParamNode(ctx);
   $$->nChildren = 0;
 }
 ;
 param-list: param-list COMMA param {
-  TreeNode *t = $1;
-  if(t != NULL) {
-    while(t->sibling != NULL) t = t->sibling;
-    t->sibling = $3;
-    $$ = $1;
-  }
-  else $$ = $3;
+  $$ = appendNodeList($1, $3);
 } | param {
-  $$ = $1;
+  $$ = newNodeList($1);
 }
 ;
 param: type-specifier ID {
-  $$ = newParamNode();
-  $$->child[0] = $1;
+  $$ = newParamNode(ctx);
+  setChild($$, 0, $1);
   $$->attr.name = $2;
   $$->type = $1->type;
 } | type-specifier ID LBRACKET RBRACKET {
-  $$ = newParamNode();
-  $$->child[0] = $1;
-  $$->child[0]->attr.val = 0;
+  $$ = newParamNode(ctx);
+  setChild($$, 0, $1);
+  getChild($$, 0)->attr.val = 0;
   $$->attr.name = $2;
   $$->type = $1->type;
 }
 ;
 compound-stmt: LBRACE local-declarations statement-list RBRACE {
-  $$ = newStmtNode(CompdK);
-  $$->child[0] = $2;
-  $$->child[1] = $3;
+  $$ = newStmtNode(ctx, CompdK);
+  setChild($$, 0, $2.head);
+  setChild($$, 1, $3.head);
 }
 ;
 local-declarations: local-declarations var-declaration {
-  TreeNode *t = $1;
-  if(t != NULL) {
-    while(t->sibling != NULL) t = t->sibling;
-    t->sibling = $2;
-    $$ = $1;
-  }
-  else $$ = $2;
+  $$ = appendNodeList($1, $2);
 } | /* empty */ {
-  $$ = NULL;
+  $$ = newNodeList(NULL);
 }
 ;
 statement-list: statement-list statement {
-  TreeNode *t = $1;
-  if(t != NULL) {
-    while(t->sibling != NULL) t = t->sibling;
-    t->sibling = $2;
-    $$ = $1;
-  }
-  else $$ = $2;
+  $$ = appendNodeList($1, $2);
 } | /* empty */ {
-  $$ = NULL;
+  $$ = newNodeList(NULL);
 };
 statement: expression-stmt { $$ = $1; }
   | compound-stmt { $$ = $1; }
@@ -160,57 +143,57 @@ expression-stmt: expression SEMI {
 }
 ;
 selection-stmt: IF LPAREN expression RPAREN statement {
-  $$ = newStmtNode(SelectK);
-  $$->child[0] = $3;
-  $$->child[1] = $5;
+  $$ = newStmtNode(ctx, SelectK);
+  setChild($$, 0, $3);
+  setChild($$, 1, $5);
   $$->nChildren = 2;
 } %prec THEN | IF LPAREN expression RPAREN statement ELSE statement {
-  $$ = newStmtNode(SelectK);
-  $$->child[0] = $3;
-  $$->child[1] = $5;
-  $$->child[2] = $7;
+  $$ = newStmtNode(ctx, SelectK);
+  setChild($$, 0, $3);
+  setChild($$, 1, $5);
+  setChild($$, 2, $7);
 }
 ;
 iteration-stmt: WHILE LPAREN expression RPAREN statement {
-  $$ = newStmtNode(IterK);
-  $$->child[0] = $3;
-  $$->child[1] = $5;
+  $$ = newStmtNode(ctx, IterK);
+  setChild($$, 0, $3);
+  setChild($$, 1, $5);
 }
 ;
 return-stmt: RETURN SEMI {
-  $$ = newStmtNode(RetK);
+  $$ = newStmtNode(ctx, RetK);
   $$->nChildren = 0;
 } | RETURN expression SEMI {
-  $$ = newStmtNode(RetK);
-  $$->child[0] = $2;
+  $$ = newStmtNode(ctx, RetK);
+  setChild($$, 0, $2);
 }
 ;
 expression: var ASSIGN expression {
-  $$ = newExprNode(OpExprK);
-  $$->child[0] = $1;
-  $$->child[1] = $3;
+  $$ = newExprNode(ctx, OpExprK);
+  setChild($$, 0, $1);
+  setChild($$, 1, $3);
   $$->attr.op = ASSIGN;
 } | simple-expression {
   $$ = $1;
 }
 ;
 var: ID {
-  $$ = newExprNode(VarK);
+  $$ = newExprNode(ctx, VarK);
   $$->nChildren = 0;
   $$->attr.name = $1;
 } | ID LBRACKET expression RBRACKET {
-  $$ = newExprNode(OpExprK);
-  $$->child[0] = newExprNode(VarK);
-  $$->child[0]->nChildren = 0;
-  $$->child[0]->attr.name = $1;
-  $$->child[1] = $3;
+  $$ = newExprNode(ctx, OpExprK);
+  setChild($$, 0, newExprNode(ctx, VarK));
+  getChild($$, 0)->nChildren = 0;
+  getChild($$, 0)->attr.name = $1;
+  setChild($$, 1, $3);
   $$->attr.op = LBRACKET;
 }
 ;
 simple-expression: additive-expression relop additive-expression {
-  $$ = newExprNode(OpExprK);
-  $$->child[0] = $1;
-  $$->child[1] = $3;
+  $$ = newExprNode(ctx, OpExprK);
+  setChild($$, 0, $1);
+  setChild($$, 1, $3);
   $$->attr.op = $2;
 } | additive-expression { $$ = $1; }
 ;
@@ -218,18 +201,18 @@ relop: LE { $$ = LE; } | LT { $$ = LT; } | GT { $$ = GT; } | GE { $$ = GE; }
   | EQ { $$ = EQ; } | NE { $$ = NE; }
 ;
 additive-expression: additive-expression addop term {
-  $$ = newExprNode(OpExprK);
-  $$->child[0] = $1;
-  $$->child[1] = $3;
+  $$ = newExprNode(ctx, OpExprK);
+  setChild($$, 0, $1);
+  setChild($$, 1, $3);
   $$->attr.op = $2;
 } | term { $$ = $1; }
 ;
 addop: PLUS { $$ = PLUS; } | MINUS { $$ = MINUS; }
 ;
 term: term mulop factor {
-  $$ = newExprNode(OpExprK);
-  $$->child[0] = $1;
-  $$->child[1] = $3;
+  $$ = newExprNode(ctx, OpExprK);
+  setChild($$, 0, $1);
+  setChild($$, 1, $3);
   $$->attr.op = $2;
 } | factor { $$ = $1; }
 ;
@@ -238,49 +221,45 @@ mulop: STAR { $$ = STAR; } | SLASH { $$ = SLASH; }
 factor: LPAREN expression RPAREN { $$ = $2; }
   | var { $$ = $1; } | call { $$ = $1; } 
   | NUM {
-    $$ = newExprNode(ConstK);
-    $$->attr.val = atoi(tokenString);
+    $$ = newExprNode(ctx, ConstK);
+    $$->attr.val = $1;
   }
 ;
 call: ID LPAREN args RPAREN {
-  $$ = newExprNode(CallK);
-  $$->child[0] = $3;
+  $$ = newExprNode(ctx, CallK);
+  setChild($$, 0, $3);
   $$->attr.name = $1;
 }
 ;
-args: arg-list { $$ = $1; } | /* empty */ { $$ = NULL; };
+args: arg-list { $$ = $1.head; } | /* empty */ { $$ = NULL; };
 arg-list: arg-list COMMA expression {
-  TreeNode *t = $1;
-  if(t != NULL) {
-    while(t->sibling != NULL) t = t->sibling;
-    t->sibling = $3;
-    $$ = $1;
-  }
-  else $$ = $3;
+  $$ = appendNodeList($1, $3);
 } | expression {
-  $$ = $1;
+  $$ = newNodeList($1);
 }
 ;
 %%
 
-static int yyerror(char const *message) {
-  if(yychar == LEX_ERROR) printf("Syntax error due to Lexical error\n");
+static int yyerror(CompileContext *ctx, char const *message) {
+  TokenType token = ctx->scan->lastToken;
+  if(token == LEX_ERROR) fprintf(ctx->listing, "Syntax error due to Lexical error\n");
   else {
-    fprintf(listing, "Syntax error at line %d: %s\n", lineno, message);
-    fprintf(listing, "Current token: ");
-    printToken(yychar, tokenString);
-    Error = TRUE;
+    fprintf(ctx->listing, "Syntax error at line %d: %s\n", ctx->lineno, message);
+    fprintf(ctx->listing, "Current token: ");
+    printToken(ctx, token, ctx->scan->tokenSlice);
+    ctx->Error = TRUE;
   }
   return 0;
 }
 
-static int yylex(void) {
-  TokenType tok = getToken();
-  if(Error) return LEX_ERROR;
+static int yylex(YYSTYPE *lval, CompileContext *ctx) {
+  TokenType tok = getToken(ctx, lval);
+  if(ctx->Error) tok = LEX_ERROR;
+  ctx->scan->lastToken = tok;
   return tok;
 }
 
-TreeNode *parse(void) {
-  yyparse();
-  return savedTree;
+TreeNode *parse(CompileContext *ctx) {
+  yyparse(ctx);
+  return ctx->syntaxTree;
 }
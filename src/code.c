@@ -1,16 +1,620 @@
 #include "globals.h"
 #include "code.h"
+#include "ir.h"
+
+#include <limits.h>
+
+/* callee saved regs: $ra, $fp and the $s registers in use */
+#define N_CALLEE_SAVED_REGS (2 + ctx->cgen->nSavedRegs)
+
+/* instructions the peephole rules look at, at most */
+#define PEEPHOLE_WINDOW 4
+
+static char const *regNames[] = {
+  "$t0", "$t1", "$t2", "$t3", "$t4",
+  "$t5", "$t6", "$t7", "$t8", "$t9",
+  "$v0", "$v1", "$a0", "$a1", "$zero",
+  "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+  "$sp", "$fp", "$ra"
+};
+
+#define R(reg) (regNames[reg])
+
+/* The code of a function is kept as MipsInstr records
+ * until emitFunctionExit, so the peephole pass can rewrite
+ * it; the form tells how the operands are written.
+ */
+enum MipsForm {
+  FORM_NONE,  /* deleted */
+  FORM_RRR,   /* op r0, r1, r2 */
+  FORM_RRI,   /* op r0, r1, imm */
+  FORM_RI,    /* op r0, imm */
+  FORM_RR,    /* op r0, r1 */
+  FORM_MULT,  /* op r0, r1 into hi and lo: mult */
+  FORM_MFHI,  /* op r0 from hi: mfhi */
+  FORM_MEM,   /* op r0, imm(r1) */
+  FORM_RS,    /* op r0, sym */
+  FORM_RRS,   /* op r0, r1, sym: a branch */
+  FORM_RIS,   /* op r0, imm, sym: a branch */
+  FORM_S,     /* op sym: b or jal */
+  FORM_R,     /* op r0: jr */
+  FORM_OP,    /* op: syscall */
+  FORM_LABEL, /* sym: */
+  FORM_TEXT   /* sym as it is: comments and blank lines */
+};
+
+struct MipsInstr {
+  int form; /* MipsForm */
+  char const *op;
+  Reg r[3];
+  int imm;
+  char const *sym;
+};
+
+typedef struct MipsInstr MipsInstr;
+
+static char *copyText(CompileContext *ctx, char const *text) {
+  char *copy = irAlloc(ctx, strlen(text) + 1, 1);
+  strcpy(copy, text);
+  return copy;
+}
+
+static MipsInstr *append(CompileContext *ctx, int form, char const *op) {
+  struct CodeGenState *cg = ctx->cgen;
+  MipsInstr *instr;
+
+  if(cg->nBuffered == cg->capBuffered) {
+    MipsInstr *grown;
+    cg->capBuffered = cg->capBuffered ? cg->capBuffered * 2 : 256;
+    grown = irAlloc(ctx, cg->capBuffered, sizeof(MipsInstr));
+    if(cg->nBuffered) memcpy(grown, cg->buffered, cg->nBuffered * sizeof(MipsInstr));
+    cg->buffered = grown;
+  }
+  instr = &cg->buffered[cg->nBuffered++];
+  instr->form = form;
+  instr->op = op;
+  instr->r[0] = instr->r[1] = instr->r[2] = REG_NONE;
+  instr->imm = 0;
+  instr->sym = NULL;
+  return instr;
+}
+
+static void putRRR(CompileContext *ctx, char const *op, Reg r0, Reg r1, Reg r2) {
+  MipsInstr *instr = append(ctx, FORM_RRR, op);
+  instr->r[0] = r0;
+  instr->r[1] = r1;
+  instr->r[2] = r2;
+}
+
+static void putRRI(CompileContext *ctx, char const *op, Reg r0, Reg r1, int imm) {
+  MipsInstr *instr = append(ctx, FORM_RRI, op);
+  instr->r[0] = r0;
+  instr->r[1] = r1;
+  instr->imm = imm;
+}
+
+static void putRI(CompileContext *ctx, char const *op, Reg r0, int imm) {
+  MipsInstr *instr = append(ctx, FORM_RI, op);
+  instr->r[0] = r0;
+  instr->imm = imm;
+}
+
+static void putRR(CompileContext *ctx, char const *op, Reg r0, Reg r1) {
+  MipsInstr *instr = append(ctx, FORM_RR, op);
+  instr->r[0] = r0;
+  instr->r[1] = r1;
+}
+
+static void putMem(CompileContext *ctx, char const *op, Reg r0, int offset, Reg base) {
+  MipsInstr *instr = append(ctx, FORM_MEM, op);
+  instr->r[0] = r0;
+  instr->r[1] = base;
+  instr->imm = offset;
+}
+
+/* putSym writes op r0, sym, or op sym without r0 */
+static void putSym(CompileContext *ctx, char const *op, Reg r0, char const *sym) {
+  MipsInstr *instr = append(ctx, r0 == REG_NONE ? FORM_S : FORM_RS, op);
+  instr->r[0] = r0;
+  instr->sym = copyText(ctx, sym);
+}
+
+static void putText(CompileContext *ctx, char const *text) {
+  append(ctx, FORM_TEXT, NULL)->sym = copyText(ctx, text);
+}
+
+static void writeInstr(FILE *code, MipsInstr const *instr) {
+  Reg const *r = instr->r;
+
+  switch(instr->form) {
+  case FORM_NONE:
+    break;
+  case FORM_RRR:
+    fprintf(code, "  %s\t%s,\t%s,\t%s\n", instr->op, R(r[0]), R(r[1]), R(r[2]));
+    break;
+  case FORM_RRS:
+    // comparing with zero, bltz and the like are single instructions
+    if(r[1] == REG_ZERO) fprintf(code, "  %sz\t%s,\t%s\n", instr->op, R(r[0]), instr->sym);
+    else fprintf(code, "  %s\t%s,\t%s,\t%s\n", instr->op, R(r[0]), R(r[1]), instr->sym);
+    break;
+  case FORM_RRI:
+    fprintf(code, "  %s\t%s,\t%s,\t%d\n", instr->op, R(r[0]), R(r[1]), instr->imm);
+    break;
+  case FORM_RI:
+    fprintf(code, "  %s\t%s,\t%d\n", instr->op, R(r[0]), instr->imm);
+    break;
+  case FORM_RR: case FORM_MULT:
+    fprintf(code, "  %s\t%s,\t%s\n", instr->op, R(r[0]), R(r[1]));
+    break;
+  case FORM_MEM:
+    if(instr->imm == 0) fprintf(code, "  %s\t%s,\t(%s)\n", instr->op, R(r[0]), R(r[1]));
+    else fprintf(code, "  %s\t%s,\t%d(%s)\n", instr->op, R(r[0]), instr->imm, R(r[1]));
+    break;
+  case FORM_RS:
+    fprintf(code, "  %s\t%s,\t%s\n", instr->op, R(r[0]), instr->sym);
+    break;
+  case FORM_RIS:
+    fprintf(code, "  %s\t%s,\t%d,\t%s\n", instr->op, R(r[0]), instr->imm, instr->sym);
+    break;
+  case FORM_S:
+    fprintf(code, "  %s\t%s\n", instr->op, instr->sym);
+    break;
+  case FORM_R: case FORM_MFHI:
+    fprintf(code, "  %s\t%s\n", instr->op, R(r[0]));
+    break;
+  case FORM_OP:
+    fprintf(code, "  %s\n", instr->op);
+    break;
+  case FORM_LABEL:
+    fprintf(code, "%s: \n", instr->sym);
+    break;
+  case FORM_TEXT:
+    fputs(instr->sym, code);
+    break;
+  }
+}
+
+/**** peephole pass ****/
+
+static int isOp(MipsInstr const *instr, int form, char const *op) {
+  return instr->form == form && strcmp(instr->op, op) == 0;
+}
+
+static int isStore(MipsInstr const *instr) {
+  return (instr->form == FORM_MEM || instr->form == FORM_RS) && strcmp(instr->op, "sw") == 0;
+}
+
+static int isLoad(MipsInstr const *instr) {
+  return (instr->form == FORM_MEM || instr->form == FORM_RS) && strcmp(instr->op, "lw") == 0;
+}
 
-/* callee saved regs: $ra, $fp */
-#define N_CALLEE_SAVED_REGS 2
+static int isControl(MipsInstr const *instr) {
+  switch(instr->form) {
+  case FORM_RRS: case FORM_RIS: case FORM_S: case FORM_R: case FORM_LABEL:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
 
-static enum memory_section {
-  NONE_SECTION,
-  DATA_SECTION,
-  TEXT_SECTION
-} current_section = NONE_SECTION;
+/* writtenReg returns the register an instruction sets,
+ * or REG_NONE */
+static Reg writtenReg(MipsInstr const *instr) {
+  switch(instr->form) {
+  case FORM_RRR: case FORM_RRI: case FORM_RI: case FORM_RR: case FORM_MFHI:
+    return instr->r[0];
+  case FORM_MEM: case FORM_RS:
+    return isStore(instr) ? REG_NONE : instr->r[0];
+  case FORM_OP:
+    return REG_V0;
+  default:
+    return REG_NONE;
+  }
+}
+
+/* readSlots points reads at the fields holding the
+ * registers an instruction reads and returns their number;
+ * a syscall reads $v0 and $a0 without naming them */
+static int readSlots(MipsInstr *instr, Reg **reads) {
+  switch(instr->form) {
+  case FORM_RRR:
+    reads[0] = &instr->r[1];
+    reads[1] = &instr->r[2];
+    return 2;
+  case FORM_RRI: case FORM_RR:
+    reads[0] = &instr->r[1];
+    return 1;
+  case FORM_MEM:
+    reads[0] = &instr->r[1];
+    if(!isStore(instr)) return 1;
+    reads[1] = &instr->r[0];
+    return 2;
+  case FORM_RS:
+    reads[0] = &instr->r[0];
+    return isStore(instr);
+  case FORM_RRS: case FORM_MULT:
+    reads[0] = &instr->r[0];
+    reads[1] = &instr->r[1];
+    return 2;
+  case FORM_RIS: case FORM_R:
+    reads[0] = &instr->r[0];
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static int readsReg(MipsInstr *instr, Reg reg) {
+  Reg *reads[2];
+  int i, n = readSlots(instr, reads);
+  if(instr->form == FORM_OP) return reg == REG_V0 || reg == REG_A0;
+  for(i = 0; i < n; ++i) {
+    if(*reads[i] == reg) return TRUE;
+  }
+  return FALSE;
+}
+
+/* the code generator keeps nothing in the $t registers
+ * or in its scratch registers from one block to another,
+ * and a call may change them */
+static int isBlockLocal(Reg reg) {
+  return reg <= REG_T9 || reg == REG_V1 || reg == REG_A0 || reg == REG_A1;
+}
+
+/* regDeadAfter tells whether the value reg holds after the
+ * buffered instruction at index i is never read */
+static int regDeadAfter(struct CodeGenState *cg, int i, Reg reg) {
+  for(++i; i < cg->nBuffered; ++i) {
+    MipsInstr *instr = &cg->buffered[i];
+    if(instr->form == FORM_NONE || instr->form == FORM_TEXT) continue;
+    if(readsReg(instr, reg)) return FALSE;
+    if(isOp(instr, FORM_S, "jal")) {
+      if(isBlockLocal(reg) || reg == REG_V0) return TRUE;
+      continue;
+    }
+    if(isControl(instr)) return isBlockLocal(reg);
+    if(writtenReg(instr) == reg) return TRUE;
+  }
+  return isBlockLocal(reg);
+}
 
-void emitInitial(void) {
+static int fitsImmediate(long value) {
+  return value >= -32768 && value <= 32767;
+}
+
+/* sameAddress tells whether two loads or stores access
+ * the same word */
+static int sameAddress(MipsInstr const *x, MipsInstr const *y) {
+  if(x->form != y->form) return FALSE;
+  if(x->form == FORM_RS) return strcmp(x->sym, y->sym) == 0;
+  return x->r[1] == y->r[1] && x->imm == y->imm;
+}
+
+static void makeMove(MipsInstr *instr, Reg dst, Reg src) {
+  if(dst == src) {
+    instr->form = FORM_NONE;
+    return;
+  }
+  instr->form = FORM_RR;
+  instr->op = "move";
+  instr->r[0] = dst;
+  instr->r[1] = src;
+}
+
+/* A rule looks at the window of the n instructions from
+ * the buffered instruction at index w[0] on (their indices
+ * in w, comments left out) and returns whether it
+ * rewrote them.
+ */
+struct PeepholeRule {
+  char const *name;
+  int level; /* lowest optLevel applying the rule */
+  int (*apply)(CompileContext *ctx, int const *w, int n);
+};
+
+#define AT(k) (&ctx->cgen->buffered[w[k]])
+
+/* subu $sp,$sp,4; sw rA,($sp); lw rB,($sp); addu $sp,$sp,4
+ * is move rB,rA */
+static int rulePushPop(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *push = AT(0), *store, *load, *pop;
+  if(n < 4) return FALSE;
+  store = AT(1);
+  load = AT(2);
+  pop = AT(3);
+  if(!isOp(push, FORM_RRI, "subu") || push->r[0] != REG_SP || push->r[1] != REG_SP || push->imm != 4) return FALSE;
+  if(!isOp(store, FORM_MEM, "sw") || store->r[1] != REG_SP || store->imm != 0) return FALSE;
+  if(!isLoad(load) || !sameAddress(store, load)) return FALSE;
+  if(!isOp(pop, FORM_RRI, "addu") || pop->r[0] != REG_SP || pop->r[1] != REG_SP || pop->imm != 4) return FALSE;
+  push->form = store->form = pop->form = FORM_NONE;
+  makeMove(load, load->r[0], store->r[0]);
+  return TRUE;
+}
+
+/* a load of the word just stored is a move */
+static int ruleStoreLoad(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *store = AT(0), *load;
+  if(n < 2 || !isStore(store)) return FALSE;
+  load = AT(1);
+  if(!isLoad(load) || !sameAddress(store, load)) return FALSE;
+  makeMove(load, load->r[0], store->r[0]);
+  return TRUE;
+}
+
+/* so is a load of the word just loaded */
+static int ruleLoadLoad(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *first = AT(0), *second;
+  if(n < 2) return FALSE;
+  second = AT(1);
+  if(!isLoad(first) || !isLoad(second) || !sameAddress(first, second)) return FALSE;
+  if(first->form == FORM_MEM && first->r[0] == first->r[1]) return FALSE;
+  makeMove(second, second->r[0], first->r[0]);
+  return TRUE;
+}
+
+/* a branch to a label right after it goes nowhere */
+static int ruleBranchNext(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *branch = AT(0);
+  int k;
+  if(!isOp(branch, FORM_S, "b") && branch->form != FORM_RRS && branch->form != FORM_RIS) return FALSE;
+  for(k = 1; k < n && AT(k)->form == FORM_LABEL; ++k) {
+    if(strcmp(AT(k)->sym, branch->sym) == 0) {
+      branch->form = FORM_NONE;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static char const *invertBranch(char const *op) {
+  static char const *pairs[][2] = {
+    { "blt", "bge" }, { "bge", "blt" }, { "ble", "bgt" },
+    { "bgt", "ble" }, { "beq", "bne" }, { "bne", "beq" }
+  };
+  int i;
+  for(i = 0; i < (int)(sizeof pairs / sizeof pairs[0]); ++i) {
+    if(strcmp(pairs[i][0], op) == 0) return pairs[i][1];
+  }
+  return NULL;
+}
+
+/* a branch over a jump, bCC L1; b L2; L1:, is the inverse
+ * branch to L2 */
+static int ruleBranchOverJump(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *branch = AT(0), *jump, *label;
+  if(n < 3 || (branch->form != FORM_RRS && branch->form != FORM_RIS)) return FALSE;
+  jump = AT(1);
+  label = AT(2);
+  if(!isOp(jump, FORM_S, "b") || label->form != FORM_LABEL) return FALSE;
+  if(strcmp(label->sym, branch->sym) != 0 || invertBranch(branch->op) == NULL) return FALSE;
+  branch->op = invertBranch(branch->op);
+  branch->sym = jump->sym;
+  jump->form = FORM_NONE;
+  return TRUE;
+}
+
+/* li rX,imm followed by an instruction reading rX as its
+ * last operand, rX being dead then, takes the immediate
+ * instead: add and sub become addi, addu keeps its name,
+ * slt becomes slti, and blt and bge compare with the
+ * immediate */
+static int ruleImmediate(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *li = AT(0), *use;
+  Reg x;
+  long imm;
+
+  if(n < 2 || !isOp(li, FORM_RI, "li")) return FALSE;
+  use = AT(1);
+  x = li->r[0];
+  imm = li->imm;
+  if(use->form == FORM_RRR) {
+    char const *op;
+    Reg other;
+    if(use->r[2] == x && use->r[1] != x) other = use->r[1];
+    else if(use->r[1] == x && use->r[2] != x &&
+            (strcmp(use->op, "add") == 0 || strcmp(use->op, "addu") == 0)) other = use->r[2];
+    else return FALSE;
+    if(strcmp(use->op, "add") == 0) op = "addi";
+    else if(strcmp(use->op, "addu") == 0) op = "addu";
+    else if(strcmp(use->op, "sub") == 0) {
+      op = "addi";
+      imm = -imm;
+    }
+    else if(strcmp(use->op, "slt") == 0) op = "slti";
+    else return FALSE;
+    if(!fitsImmediate(imm) || (use->r[0] != x && !regDeadAfter(ctx->cgen, w[1], x))) return FALSE;
+    use->form = FORM_RRI;
+    use->op = op;
+    use->r[1] = other;
+    use->imm = (int)imm;
+  }
+  else if(use->form == FORM_RRS) {
+    if(strcmp(use->op, "blt") != 0 && strcmp(use->op, "bge") != 0) return FALSE;
+    if(use->r[0] == x || use->r[1] != x || !fitsImmediate(imm)) return FALSE;
+    if(!regDeadAfter(ctx->cgen, w[1], x)) return FALSE;
+    use->form = FORM_RIS;
+    use->imm = (int)imm;
+  }
+  else return FALSE;
+  li->form = FORM_NONE;
+  return TRUE;
+}
+
+/* an instruction setting a register moved right away to
+ * another one sets that one instead */
+static int ruleCopyInto(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *def = AT(0), *move;
+  Reg d;
+  if(n < 2 || def->form == FORM_OP) return FALSE;
+  d = writtenReg(def);
+  move = AT(1);
+  if(d == REG_NONE || d == REG_ZERO || !isOp(move, FORM_RR, "move") || move->r[1] != d) return FALSE;
+  if(move->r[0] == d || !regDeadAfter(ctx->cgen, w[1], d)) return FALSE;
+  def->r[0] = move->r[0];
+  move->form = FORM_NONE;
+  return TRUE;
+}
+
+/* move rD,rS followed by an instruction reading rD, rD
+ * being dead then, reads rS there instead, as long as
+ * neither changes in between */
+static int ruleForwardCopy(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *move = AT(0), *use = NULL;
+  Reg *reads[2];
+  Reg d, s;
+  int i, k, nReads;
+
+  if(!isOp(move, FORM_RR, "move")) return FALSE;
+  d = move->r[0];
+  s = move->r[1];
+  for(k = 1; k < n; ++k) {
+    use = AT(k);
+    if(readsReg(use, d)) break;
+    if(isControl(use) || writtenReg(use) == d || writtenReg(use) == s) return FALSE;
+  }
+  if(k == n || use->form == FORM_OP || use->form == FORM_R) return FALSE;
+  if(writtenReg(use) != d && !regDeadAfter(ctx->cgen, w[k], d)) return FALSE;
+  nReads = readSlots(use, reads);
+  for(i = 0; i < nReads; ++i) {
+    if(*reads[i] == d) *reads[i] = s;
+  }
+  move->form = FORM_NONE;
+  return TRUE;
+}
+
+/* addu rA,rB,k then addi or addu rA,rA,j is addu rA,rB,k+j,
+ * the first being address arithmetic */
+static int ruleAddOffsets(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *first = AT(0), *second;
+  if(n < 2 || !isOp(first, FORM_RRI, "addu")) return FALSE;
+  second = AT(1);
+  if(!isOp(second, FORM_RRI, "addi") && !isOp(second, FORM_RRI, "addu")) return FALSE;
+  if(second->r[0] != first->r[0] || second->r[1] != first->r[0]) return FALSE;
+  if(!fitsImmediate((long)first->imm + second->imm)) return FALSE;
+  first->imm += second->imm;
+  second->form = FORM_NONE;
+  return TRUE;
+}
+
+/* addu rA,rB,k followed by a load or store at j(rA), rA
+ * being dead then, accesses k+j(rB) */
+static int ruleAddressOffset(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *add = AT(0), *access;
+  Reg a;
+  if(n < 2 || add->form != FORM_RRI) return FALSE;
+  if(strcmp(add->op, "addu") != 0 && strcmp(add->op, "addi") != 0) return FALSE;
+  a = add->r[0];
+  access = AT(1);
+  if(access->form != FORM_MEM || access->r[1] != a) return FALSE;
+  if(isStore(access) && access->r[0] == a) return FALSE;
+  if(!fitsImmediate((long)add->imm + access->imm)) return FALSE;
+  if(access->r[0] != a && !regDeadAfter(ctx->cgen, w[1], a)) return FALSE;
+  access->r[1] = add->r[1];
+  access->imm += add->imm;
+  add->form = FORM_NONE;
+  return TRUE;
+}
+
+/* la rA,sym followed by a load or store at j(rA), rA being
+ * dead then, accesses sym+j */
+static int ruleGlobalOffset(CompileContext *ctx, int const *w, int n) {
+  MipsInstr *la = AT(0), *access;
+  char *sym;
+  Reg a;
+  if(n < 2 || !isOp(la, FORM_RS, "la")) return FALSE;
+  a = la->r[0];
+  access = AT(1);
+  if(access->form != FORM_MEM || access->r[1] != a || access->imm < 0) return FALSE;
+  if(isStore(access) && access->r[0] == a) return FALSE;
+  if(access->r[0] != a && !regDeadAfter(ctx->cgen, w[1], a)) return FALSE;
+  // room for the name, a plus sign and the offset
+  sym = irAlloc(ctx, strlen(la->sym) + 16, 1);
+  if(access->imm == 0) strcpy(sym, la->sym);
+  else sprintf(sym, "%s+%d", la->sym, access->imm);
+  access->form = FORM_RS;
+  access->sym = sym;
+  la->form = FORM_NONE;
+  return TRUE;
+}
+
+#undef AT
+
+static struct PeepholeRule const rules[] = {
+  { "push-pop", 1, rulePushPop },
+  { "store-load", 1, ruleStoreLoad },
+  { "load-load", 1, ruleLoadLoad },
+  { "branch-next", 1, ruleBranchNext },
+  { "branch-over-jump", 1, ruleBranchOverJump },
+  { "immediate", 1, ruleImmediate },
+  { "copy-into", 1, ruleCopyInto },
+  { "forward-copy", 1, ruleForwardCopy },
+  { "add-offsets", 1, ruleAddOffsets },
+  { "address-offset", 1, ruleAddressOffset },
+  { "global-offset", 1, ruleGlobalOffset }
+};
+
+#define N_RULES ((int)(sizeof rules / sizeof rules[0]))
+
+/* window fills w with the indices of the instructions from
+ * index i on, comments left out, and returns their number */
+static int window(struct CodeGenState *cg, int i, int *w) {
+  int n = 0;
+  for(; i < cg->nBuffered && n < PEEPHOLE_WINDOW; ++i) {
+    int form = cg->buffered[i].form;
+    if(form != FORM_NONE && form != FORM_TEXT) w[n++] = i;
+  }
+  return n;
+}
+
+/* The peephole pass slides the window over the buffered
+ * function, applying the rules at every instruction until
+ * none applies, and goes over it again until nothing
+ * changes, as a rewrite may let a rule apply earlier on.
+ */
+static void runPeephole(CompileContext *ctx) {
+  struct CodeGenState *cg = ctx->cgen;
+  int w[PEEPHOLE_WINDOW];
+  int changed = TRUE;
+  int i, r, n;
+
+  if(cg->peepholeHits == NULL) cg->peepholeHits = irAlloc(ctx, N_RULES, sizeof(int));
+
+  while(changed) {
+    changed = FALSE;
+    for(i = 0; i < cg->nBuffered; ++i) {
+      int form = cg->buffered[i].form;
+      if(form == FORM_NONE || form == FORM_TEXT) continue;
+      n = window(cg, i, w);
+      for(r = 0; r < N_RULES; ++r) {
+        if(ctx->optLevel < rules[r].level || !rules[r].apply(ctx, w, n)) continue;
+        ++cg->peepholeHits[r];
+        changed = TRUE;
+        if(cg->buffered[i].form == FORM_NONE) break;
+        n = window(cg, i, w);
+        r = -1;
+      }
+    }
+  }
+}
+
+void printPeepholeStats(CompileContext *ctx) {
+  int r;
+  fprintf(ctx->listing, "\nPeephole rule hits:\n");
+  for(r = 0; r < N_RULES; ++r) {
+    int hits = ctx->cgen->peepholeHits ? ctx->cgen->peepholeHits[r] : 0;
+    fprintf(ctx->listing, "  %-18s%d\n", rules[r].name, hits);
+  }
+}
+
+/**** emitters ****/
+
+void emitHeader(CompileContext *ctx, char const *codefile) {
+  fprintf(ctx->code, "#  Compiled from %s\n", codefile);
+  fputc('\n', ctx->code);
+}
+
+void emitInitial(CompileContext *ctx) {
+  FILE *code = ctx->code;
   fputs(".globl\tmain\n", code);
   fprintf(code, ".align 4\n");
   fprintf(code, ".data\n");
@@ -20,111 +624,148 @@ void emitInitial(void) {
   fprintf(code, "\n");
 }
 
-void emitComment(char const *text) {
-  fprintf(code, "# %s\n", text);
+void emitComment(CompileContext *ctx, char const *text) {
+  char *line = irAlloc(ctx, strlen(text) + 4, 1);
+  sprintf(line, "# %s\n", text);
+  append(ctx, FORM_TEXT, NULL)->sym = line;
 }
 
-void emitRaw(char const *raw) {
-  fputs(raw, code);
+void emitRaw(CompileContext *ctx, char const *raw) {
+  putText(ctx, raw);
 }
 
-void emitGlobalVariable(char const *name, int size) {
-  if(current_section != DATA_SECTION) {
-    if(current_section != NONE_SECTION) fputc('\n', code);
+void emitGlobalVariable(CompileContext *ctx, char const *name, int size) {
+  FILE *code = ctx->code;
+  assert(ctx->cgen->nBuffered == 0);
+  if(ctx->cgen->section != DATA_SECTION) {
+    if(ctx->cgen->section != NONE_SECTION) fputc('\n', code);
 
     fprintf(code, ".data\n");
     fprintf(code, ".align 4\n");
-    current_section = DATA_SECTION;
+    ctx->cgen->section = DATA_SECTION;
   }
 
   fprintf(code, "  _%s: .space %d\n", name, size);
 }
 
-void emitFunctionEnter(char const *name) {
-  if(current_section != TEXT_SECTION) {
-    if(current_section != NONE_SECTION) fputc('\n', code);
+void emitFunctionEnter(CompileContext *ctx, char const *name, unsigned savedRegs, int frameWords) {
+  FILE *code = ctx->code;
+  assert(ctx->cgen->nBuffered == 0);
+  if(ctx->cgen->section != TEXT_SECTION) {
+    if(ctx->cgen->section != NONE_SECTION) fputc('\n', code);
 
     fprintf(code, ".text\n");
     fprintf(code, ".align 4\n");
-    current_section = TEXT_SECTION;
+    ctx->cgen->section = TEXT_SECTION;
   }
 
   int upperLimit = 0;
+  int i, n = 0;
+
+  ctx->cgen->savedRegs = savedRegs;
+  ctx->cgen->nSavedRegs = 0;
+  for(i = 0; i < N_SAVED_REGS; ++i) {
+    if(savedRegs & 1u << i) ++ctx->cgen->nSavedRegs;
+  }
 
-  emitComment("function enter");
-  fprintf(code, "%s:\n", name);
-  fprintf(code, "  subu\t$sp,\t$sp,\t%d\n", N_CALLEE_SAVED_REGS * 4);
+  emitComment(ctx, "function enter");
+  emitLabel(ctx, name);
+  putRRI(ctx, "subu", REG_SP, REG_SP, N_CALLEE_SAVED_REGS * 4);
   upperLimit += N_CALLEE_SAVED_REGS * 4;
 
-  fprintf(code, "  sw\t$ra,\t%d($sp)\n", upperLimit - 4*1);
-  fprintf(code, "  sw\t$fp,\t%d($sp)\n", upperLimit - 4*2);
+  putMem(ctx, "sw", REG_RA, upperLimit - 4*1, REG_SP);
+  putMem(ctx, "sw", REG_FP, upperLimit - 4*2, REG_SP);
 
-  /* push registers here */
+  for(i = 0; i < N_SAVED_REGS; ++i) {
+    if(!(savedRegs & 1u << i)) continue;
+    putMem(ctx, "sw", REG_S0 + i, upperLimit - 4*(3 + n++), REG_SP);
+  }
 
-  fprintf(code, "  addu\t$fp,\t$sp,\t%d\n", upperLimit - 4*1);
+  putRRI(ctx, "addu", REG_FP, REG_SP, upperLimit - 4*1);
+  if(frameWords > 0) putRRI(ctx, "subu", REG_SP, REG_SP, frameWords * 4);
 
-  fputc('\n', code);
+  putText(ctx, "\n");
 }
 
-void emitFunctionExit(void) {
-  emitComment("function exit");
-  fprintf(code, "  subu\t$sp,\t$fp,\t%d\n", N_CALLEE_SAVED_REGS * 4 - 4);
+void emitFunctionExit(CompileContext *ctx) {
+  struct CodeGenState *cg = ctx->cgen;
+  int i;
 
-  /* pop registers here */
+  emitComment(ctx, "function exit");
+  putRRI(ctx, "subu", REG_SP, REG_FP, N_CALLEE_SAVED_REGS * 4 - 4);
 
-  fprintf(code, "  lw\t$fp,\t($sp)\n");
-  fprintf(code, "  addu\t$sp\t$sp,\t4\n");
-  fprintf(code, "  lw\t$ra,\t($sp)\n");
-  fprintf(code, "  addu\t$sp\t$sp,\t4\n");
+  int upperLimit = N_CALLEE_SAVED_REGS * 4;
+  int n = 0;
+  for(i = 0; i < N_SAVED_REGS; ++i) {
+    if(!(cg->savedRegs & 1u << i)) continue;
+    putMem(ctx, "lw", REG_S0 + i, upperLimit - 4*(3 + n++), REG_SP);
+  }
 
-  fprintf(code, "  jr\t$ra\n");
+  putMem(ctx, "lw", REG_FP, upperLimit - 4*2, REG_SP);
+  putMem(ctx, "lw", REG_RA, upperLimit - 4*1, REG_SP);
+  putRRI(ctx, "addu", REG_SP, REG_SP, upperLimit);
 
-  fputc('\n', code);
-}
+  append(ctx, FORM_R, "jr")->r[0] = REG_RA;
 
-void emitBlockEnter(int size) {
-  if(size == 0) return;
-  fprintf(code, "  subu\t$sp,\t$sp,\t%d\n", size);
-}
-void emitBlockExit(int size) {
-  if(size == 0) return;
-  fprintf(code, "  addu\t$sp,\t$sp,\t%d\n", size);
-}
+  putText(ctx, "\n");
 
-void emitBranching(char const *label, int cond) {
-  if(cond) fprintf(code, "  bne\t$v0,\t$zero,\t%s\n", label);
-  else fprintf(code, "  beq\t$v0,\t$zero,\t%s\n", label);
+  runPeephole(ctx);
+  for(i = 0; i < cg->nBuffered; ++i) writeInstr(ctx->code, &cg->buffered[i]);
+  cg->nBuffered = 0;
 }
 
-void emitUncondBranching(char const *label) {
-  fprintf(code, "  b\t%s\n", label);
+void emitCompareBranch(CompileContext *ctx, int cmp, Reg lhs, Reg rhs, char const *label) {
+  MipsInstr *instr;
+  char const *mnemonic;
+  switch(cmp) {
+  case IR_SLT: mnemonic = "blt"; break;
+  case IR_SLE: mnemonic = "ble"; break;
+  case IR_SGT: mnemonic = "bgt"; break;
+  case IR_SGE: mnemonic = "bge"; break;
+  case IR_SEQ: mnemonic = "beq"; break;
+  case IR_SNE: mnemonic = "bne"; break;
+  default:
+    assert(!"unreachable code");
+    return;
+  }
+  instr = append(ctx, FORM_RRS, mnemonic);
+  instr->r[0] = lhs;
+  instr->r[1] = rhs;
+  instr->sym = copyText(ctx, label);
 }
 
-void emitLabel(char const *label) {
-  fprintf(code, "%s: \n", label);
+void emitUncondBranching(CompileContext *ctx, char const *label) {
+  putSym(ctx, "b", REG_NONE, label);
 }
 
-void emitPushValue(void) {
-  fprintf(code, "  subu\t$sp,\t$sp,\t4\n");
-  fprintf(code, "  sw\t$v0,\t($sp)\n");
+void emitLabel(CompileContext *ctx, char const *label) {
+  append(ctx, FORM_LABEL, NULL)->sym = copyText(ctx, label);
 }
 
-void emitPopLHS(void) {
-  fprintf(code, "  lw\t$t0,\t($sp)\n");
-  fprintf(code, "  addu\t$sp,\t$sp,\t4\n");
+void emitPushValue(CompileContext *ctx, Reg reg) {
+  putRRI(ctx, "subu", REG_SP, REG_SP, 4);
+  putMem(ctx, "sw", reg, 0, REG_SP);
 }
 
-void emitPopMultiple(int cnt) {
+void emitPopMultiple(CompileContext *ctx, int cnt) {
   if(cnt == 0) return;
-  fprintf(code, "  addu\t$sp,\t$sp,\t%d\n", cnt * 4);
+  putRRI(ctx, "addu", REG_SP, REG_SP, cnt * 4);
+}
+
+void emitMove(CompileContext *ctx, Reg dst, Reg src) {
+  if(dst == src) return;
+  putRR(ctx, "move", dst, src);
 }
 
-void emitGlobalRef(char const *name, enum addressing_mode mode) {
-  if(mode == GET_VALUE) fprintf(code, "  lw\t$v0,\t_%s\n", name);
-  else fprintf(code, "  la\t$v0,\t_%s\n", name);
+void emitGlobalRef(CompileContext *ctx, Reg reg, char const *name, enum addressing_mode mode) {
+  char *sym = irAlloc(ctx, strlen(name) + 2, 1);
+  sprintf(sym, "_%s", name);
+  if(mode == GET_VALUE) putSym(ctx, "lw", reg, sym);
+  else if(mode == SET_VALUE) putSym(ctx, "sw", reg, sym);
+  else putSym(ctx, "la", reg, sym);
 }
 
-void emitLocalRef(int relativeOffset, enum addressing_mode mode) {
+void emitLocalRef(CompileContext *ctx, Reg reg, int relativeOffset, enum addressing_mode mode) {
   int offset;
   if(relativeOffset >= 1) {
     offset = relativeOffset * 4;
@@ -132,116 +773,224 @@ void emitLocalRef(int relativeOffset, enum addressing_mode mode) {
   else {
     offset = - (N_CALLEE_SAVED_REGS * 4 - 4) + (relativeOffset + 1) * 4;
   }
-    
+
   if(mode == GET_VALUE) {
-    fprintf(code, "  lw\t$v0,\t%d($fp)\n", offset);
+    putMem(ctx, "lw", reg, offset, REG_FP);
+  }
+  else if(mode == SET_VALUE) {
+    putMem(ctx, "sw", reg, offset, REG_FP);
   }
   else {
-    fprintf(code, "  addu\t$v0,\t$fp,\t%d\n", offset);
+    putRRI(ctx, "addu", reg, REG_FP, offset);
   }
 }
 
-void emitConstExpr(int value) {
-  fprintf(code, "  li\t$v0,\t%d\n", value);
+void emitConstExpr(CompileContext *ctx, Reg reg, int value) {
+  putRI(ctx, "li", reg, value);
 }
 
-void emitCallFunction(char const *funcName) {
-  fprintf(code, "  jal\t%s\n", funcName);
+void emitCallFunction(CompileContext *ctx, char const *funcName) {
+  putSym(ctx, "jal", REG_NONE, funcName);
 }
 
-void emitBinaryOp(int op) {
+void emitBinaryOp(CompileContext *ctx, int op, Reg dst, Reg lhs, Reg rhs) {
+  char const *mnemonic;
   switch(op) {
-  case ASSIGN:
-    fprintf(code, "  sw\t$v0,\t($t0)\n");
-    break;
-  case LE:
-    fprintf(code, "  sle\t$v0,\t$t0,\t$v0\n");
-    break;
-  case LT:
-    fprintf(code, "  slt\t$v0,\t$t0,\t$v0\n");
-    break;
-  case GE:
-    fprintf(code, "  sge\t$v0,\t$t0,\t$v0\n");
-    break;
-  case GT:
-    fprintf(code, "  sgt\t$v0,\t$t0,\t$v0\n");
-    break;
-  case EQ:
-    fprintf(code, "  seq\t$v0,\t$t0,\t$v0\n");
-    break;
-  case NE:
-    fprintf(code, "  sne\t$v0,\t$t0,\t$v0\n");
-    break;
-  case PLUS:
-    fprintf(code, "  add\t$v0,\t$t0,\t$v0\n");
-    break;
-  case MINUS:
-    fprintf(code, "  sub\t$v0,\t$t0,\t$v0\n");
-    break;
-  case STAR:
-    fprintf(code, "  mul\t$v0,\t$t0,\t$v0\n");
-    break;
-  case SLASH:
-    fprintf(code, "  div\t$v0,\t$t0,\t$v0\n");
-    break;
+  case IR_SLE: mnemonic = "sle"; break;
+  case IR_SLT: mnemonic = "slt"; break;
+  case IR_SGE: mnemonic = "sge"; break;
+  case IR_SGT: mnemonic = "sgt"; break;
+  case IR_SEQ: mnemonic = "seq"; break;
+  case IR_SNE: mnemonic = "sne"; break;
+  case IR_ADD: mnemonic = "add"; break;
+  case IR_ADDU: mnemonic = "addu"; break;
+  case IR_SUB: mnemonic = "sub"; break;
+  case IR_MUL: mnemonic = "mul"; break;
+  case IR_DIV: mnemonic = "div"; break;
   default:
     assert(!"unreachable code");
-    break;
+    return;
   }
+  putRRR(ctx, mnemonic, dst, lhs, rhs);
 }
 
-void emitArrayOp(enum addressing_mode mode) {
-  fprintf(code, "  li\t$t1,\t4\n");
-  fprintf(code, "  mul\t$v0,\t$v0,\t$t1\n");
-  fprintf(code, "  add\t$v0,\t$t0,\t$v0\n"); 
-  if(mode == GET_VALUE) {
-    fprintf(code, "  lw $v0, ($v0)\n");
+void emitShiftLeft(CompileContext *ctx, Reg dst, Reg src, int amount) {
+  putRRI(ctx, "sll", dst, src, amount);
+}
+
+/* A multiplier is cheap when its magnitude is a power of
+ * two, or the sum or the difference of two: a shift, or
+ * two shifts and an add, then a negation for a negative
+ * one.  The adds wrap around as mul does.
+ */
+static int log2Exact(unsigned x) {
+  int k = 0;
+  if(x == 0 || (x & (x - 1)) != 0) return -1;
+  while(x >>= 1) ++k;
+  return k;
+}
+
+/* splitMultiplier finds m = 2^*high + *sign 2^*low, or
+ * fails */
+static int splitMultiplier(unsigned m, int *high, int *sign, int *low) {
+  unsigned lowBit = m & -m;
+
+  *low = log2Exact(lowBit);
+  *high = log2Exact(m - lowBit);
+  *sign = 1;
+  if(*high >= 0) return TRUE;
+  *high = log2Exact(m + lowBit);
+  *sign = -1;
+  return *high >= 0;
+}
+
+int isCheapMultiplier(int c) {
+  int high, sign, low;
+  if(c == INT_MIN) return FALSE;
+  return log2Exact(c < 0 ? -c : c) >= 0 || splitMultiplier(c < 0 ? -c : c, &high, &sign, &low);
+}
+
+void emitMultiplyConst(CompileContext *ctx, Reg dst, Reg src, int c) {
+  unsigned m = c < 0 ? -(unsigned)c : (unsigned)c;
+  int high, sign, low;
+
+  assert(isCheapMultiplier(c) && src != REG_A1 && dst != REG_A1);
+  if(log2Exact(m) >= 0) {
+    if(m == 1) emitMove(ctx, dst, src);
+    else putRRI(ctx, "sll", dst, src, log2Exact(m));
+  }
+  else {
+    splitMultiplier(m, &high, &sign, &low);
+    putRRI(ctx, "sll", REG_A1, src, high);
+    if(low > 0) {
+      putRRI(ctx, "sll", dst, src, low);
+      src = dst;
+    }
+    if(sign > 0) putRRR(ctx, "addu", dst, REG_A1, src);
+    else putRRR(ctx, "subu", dst, REG_A1, src);
+  }
+  if(c < 0) putRRR(ctx, "subu", dst, REG_ZERO, dst);
+}
+
+/* A signed division by a power of two adds 2^k - 1 to a
+ * negative dividend before the arithmetic shift, so the
+ * quotient is rounded towards zero as div does.  A division
+ * by any other constant takes the high word of the product
+ * with its magic number (Hacker's Delight, 10-1), shifted,
+ * and adds one for a negative dividend.  A negative
+ * divisor negates the quotient; the most negative one is
+ * left to div.
+ */
+int isCheapDivisor(int c) {
+  return c != INT_MIN && (c >= 2 || c <= -2);
+}
+
+/* magicNumber computes the multiplier and the shift
+ * dividing by d, d >= 2 */
+static void magicNumber(unsigned d, int *magic, int *shift) {
+  unsigned const two31 = 0x80000000u;
+  unsigned anc = two31 - 1 - two31 % d;
+  unsigned q1 = two31 / anc, r1 = two31 - q1 * anc;
+  unsigned q2 = two31 / d, r2 = two31 - q2 * d;
+  unsigned delta;
+  int p = 31;
+
+  do {
+    ++p;
+    q1 *= 2;
+    r1 *= 2;
+    if(r1 >= anc) {
+      ++q1;
+      r1 -= anc;
+    }
+    q2 *= 2;
+    r2 *= 2;
+    if(r2 >= d) {
+      ++q2;
+      r2 -= d;
+    }
+    delta = d - r2;
+  } while(q1 < delta || (q1 == delta && r1 == 0));
+  *magic = (int)(q2 + 1);
+  *shift = p - 32;
+}
+
+void emitDivideConst(CompileContext *ctx, Reg dst, Reg src, int c) {
+  unsigned d = c < 0 ? -(unsigned)c : (unsigned)c;
+  int k = log2Exact(d), magic, shift;
+
+  assert(isCheapDivisor(c) && src != REG_A0 && src != REG_A1 && dst != REG_A0 && dst != REG_A1);
+  if(k == 1) {
+    putRRI(ctx, "srl", REG_A1, src, 31);
+    putRRR(ctx, "addu", REG_A1, src, REG_A1);
+    putRRI(ctx, "sra", dst, REG_A1, 1);
+  }
+  else if(k > 1) {
+    putRRI(ctx, "sra", REG_A1, src, 31);
+    putRRI(ctx, "srl", REG_A1, REG_A1, 32 - k);
+    putRRR(ctx, "addu", REG_A1, src, REG_A1);
+    putRRI(ctx, "sra", dst, REG_A1, k);
   }
+  else {
+    MipsInstr *mult;
+    magicNumber(d, &magic, &shift);
+    putRI(ctx, "li", REG_A1, magic);
+    mult = append(ctx, FORM_MULT, "mult");
+    mult->r[0] = src;
+    mult->r[1] = REG_A1;
+    append(ctx, FORM_MFHI, "mfhi")->r[0] = REG_A1;
+    if(magic < 0) putRRR(ctx, "addu", REG_A1, REG_A1, src);
+    if(shift > 0) putRRI(ctx, "sra", REG_A1, REG_A1, shift);
+    putRRI(ctx, "srl", REG_A0, src, 31);
+    putRRR(ctx, "addu", dst, REG_A1, REG_A0);
+  }
+  if(c < 0) putRRR(ctx, "subu", dst, REG_ZERO, dst);
 }
 
-void emitInputSyscall(void) {
-  emitComment("\n");
-  emitComment("**** Input Syscall ****");
-  emitComment("\n");
+void emitMemoryOp(CompileContext *ctx, enum addressing_mode mode, Reg reg, Reg addr) {
+  putMem(ctx, mode == GET_VALUE ? "lw" : "sw", reg, 0, addr);
+}
+
+void emitInputSyscall(CompileContext *ctx) {
+  emitComment(ctx, "\n");
+  emitComment(ctx, "**** Input Syscall ****");
+  emitComment(ctx, "\n");
 
   /* print text */
-  fprintf(code, "  li\t$v0,\t4\n");
-  fprintf(code, "  la\t$a0,\tinput_text\n");
-  fprintf(code, "  syscall\n");
+  putRI(ctx, "li", REG_V0, 4);
+  putSym(ctx, "la", REG_A0, "input_text");
+  append(ctx, FORM_OP, "syscall");
 
   /* get value */
-  fprintf(code, "  li\t$v0,\t5\n");
-  fprintf(code, "  syscall\n");
+  putRI(ctx, "li", REG_V0, 5);
+  append(ctx, FORM_OP, "syscall");
 
-  emitComment("\n");
-  emitComment("***********************");
-  emitComment("\n");
+  emitComment(ctx, "\n");
+  emitComment(ctx, "***********************");
+  emitComment(ctx, "\n");
 }
 
-void emitOutputSyscall(void) {
-  emitComment("\n");
-  emitComment("**** Output Syscall ****");
-  emitComment("\n");
-
-  /* store value*/
-  fprintf(code, "  move\t$t0,\t$v0\n");
+void emitOutputSyscall(CompileContext *ctx, Reg value) {
+  emitComment(ctx, "\n");
+  emitComment(ctx, "**** Output Syscall ****");
+  emitComment(ctx, "\n");
 
   /* print text */
-  fprintf(code, "  li\t$v0,\t4\n");
-  fprintf(code, "  la\t$a0,\toutput_text\n");
-  fprintf(code, "  syscall\n");
+  putRI(ctx, "li", REG_V0, 4);
+  putSym(ctx, "la", REG_A0, "output_text");
+  append(ctx, FORM_OP, "syscall");
 
   /* print int */
-  fprintf(code, "  move\t$a0,\t$t0\n");
-  fprintf(code, "  li\t$v0,\t1\n");
-  fprintf(code, "  syscall\n");
+  emitMove(ctx, REG_A0, value);
+  putRI(ctx, "li", REG_V0, 1);
+  append(ctx, FORM_OP, "syscall");
 
   /* newline */
-  fprintf(code, "  li\t$v0,\t4\n");
-  fprintf(code, "  la\t$a0,\tnewline\n");
-  fprintf(code, "  syscall\n");
+  putRI(ctx, "li", REG_V0, 4);
+  putSym(ctx, "la", REG_A0, "newline");
+  append(ctx, FORM_OP, "syscall");
 
-  emitComment("\n");
-  emitComment("**********************");
-  emitComment("\n");
+  emitComment(ctx, "\n");
+  emitComment(ctx, "**********************");
+  emitComment(ctx, "\n");
 }
@@ -3,45 +3,129 @@
 
 enum addressing_mode {
   GET_VALUE,
-  GET_ADDRESS
+  GET_ADDRESS,
+  SET_VALUE
 };
 
-void emitInitial(void);
+/* Registers the emitters work with; the $t registers
+ * hold the temporaries of cgen.c, the $s registers hold
+ * variables and $v1 and $a1 are scratch.  $sp, $fp and
+ * $ra are only used by code.c itself.
+ */
+typedef enum {
+  REG_T0, REG_T1, REG_T2, REG_T3, REG_T4,
+  REG_T5, REG_T6, REG_T7, REG_T8, REG_T9,
+  REG_V0, REG_V1, REG_A0, REG_A1, REG_ZERO,
+  REG_S0, REG_S1, REG_S2, REG_S3, REG_S4, REG_S5, REG_S6, REG_S7,
+  REG_SP, REG_FP, REG_RA,
+  REG_NONE
+} Reg;
+
+#define N_TEMP_REGS 10
+#define N_SAVED_REGS 8
+
+enum memory_section {
+  NONE_SECTION,
+  DATA_SECTION,
+  TEXT_SECTION
+};
+
+/* CodeGenState is the code generator part of a CompileContext */
+struct CodeGenState {
+  enum memory_section section;
+
+  /* block labels are numbered from labelBase on in the
+     current function */
+  int labelBase;
+  int labelCounterRET;
+
+  char currentRetLabel[64];
+
+  /* $s registers saved by the current function, one bit
+     per register from $s0, and their number */
+  unsigned savedRegs;
+  int nSavedRegs;
+
+  /* the instructions of the current function, held back
+     for the peephole pass until emitFunctionExit */
+  struct MipsInstr *buffered;
+  int nBuffered, capBuffered;
 
-void emitComment(char const *text);
-void emitRaw(char const *raw);
+  /* by peephole rule, the times it was applied */
+  int *peepholeHits;
+};
+
+/* emitHeader writes the comment naming the code file */
+void emitHeader(CompileContext *ctx, char const *codefile);
+
+void emitInitial(CompileContext *ctx);
 
-void emitGlobalVariable(char const *name, int size);
-void emitFunctionEnter(char const *name);
-void emitFunctionExit(void);
+void emitComment(CompileContext *ctx, char const *text);
+void emitRaw(CompileContext *ctx, char const *raw);
+
+void emitGlobalVariable(CompileContext *ctx, char const *name, int size);
+/* the frame of a function saves $ra, $fp and the $s
+ * registers in savedRegs, one bit per register from $s0,
+ * and has frameWords words below them for the locals and
+ * the spilled temporaries
+ */
+void emitFunctionEnter(CompileContext *ctx, char const *name, unsigned savedRegs, int frameWords);
+/* emitFunctionExit also runs the peephole pass over the
+ * code of the function and writes it out */
+void emitFunctionExit(CompileContext *ctx);
 
-void emitBlockEnter(int size);
-void emitBlockExit(int size);
+/* printPeepholeStats lists the peephole rules with the
+ * times each one was applied */
+void printPeepholeStats(CompileContext *ctx);
 
-void emitBranching(char const *label, int cond);
-void emitUncondBranching(char const *label);
-void emitLabel(char const *label);
+/* branch to label if lhs cmp rhs, cmp being a comparison
+ * IrOpcode */
+void emitCompareBranch(CompileContext *ctx, int cmp, Reg lhs, Reg rhs, char const *label);
+void emitUncondBranching(CompileContext *ctx, char const *label);
+void emitLabel(CompileContext *ctx, char const *label);
 
-void emitPushValue(void);
-void emitPopLHS(void);
-void emitPopMultiple(int cnt);
-void emitGlobalRef(char const *name, enum addressing_mode mode);
+void emitPushValue(CompileContext *ctx, Reg reg);
+void emitPopMultiple(CompileContext *ctx, int cnt);
+void emitMove(CompileContext *ctx, Reg dst, Reg src);
+
+/* the references load the value or the address of a
+ * variable into reg, or store reg into it (SET_VALUE)
+ */
+void emitGlobalRef(CompileContext *ctx, Reg reg, char const *name, enum addressing_mode mode);
 
 /* 
  * relativeOffset
  *    params: 1, 2, 3, ... (left to right)
  *    locals: -2, -3, -4, ... (top to bottom)
+ *            then the variables made up by the
+ *            lowering and the spill slots below them
  *    saved $ra:   0
  *    saved $fp:   1
  */
-void emitLocalRef(int relativeOffset, enum addressing_mode mode);
-void emitConstExpr(int value);
-void emitCallFunction(char const *funcName);
+void emitLocalRef(CompileContext *ctx, Reg reg, int relativeOffset, enum addressing_mode mode);
+void emitConstExpr(CompileContext *ctx, Reg reg, int value);
+void emitCallFunction(CompileContext *ctx, char const *funcName);
+
+/* dst = lhs op rhs, op being a binary IrOpcode other
+ * than IR_SLL */
+void emitBinaryOp(CompileContext *ctx, int op, Reg dst, Reg lhs, Reg rhs);
+void emitShiftLeft(CompileContext *ctx, Reg dst, Reg src, int amount);
+
+/* dst = src * c or src / c without mul or div, using $a0
+ * and $a1; isCheapMultiplier and isCheapDivisor tell the
+ * constants this is done for */
+int isCheapMultiplier(int c);
+int isCheapDivisor(int c);
+void emitMultiplyConst(CompileContext *ctx, Reg dst, Reg src, int c);
+void emitDivideConst(CompileContext *ctx, Reg dst, Reg src, int c);
 
-void emitBinaryOp(int op);
-void emitArrayOp(enum addressing_mode mode);
+/* load reg from the address in addr (GET_VALUE) or
+ * store it there (SET_VALUE) */
+void emitMemoryOp(CompileContext *ctx, enum addressing_mode mode, Reg reg, Reg addr);
 
-void emitInputSyscall(void);
-void emitOutputSyscall(void);
+void emitInputSyscall(CompileContext *ctx);
+/* the input syscall leaves the value read in $v0; the
+ * output syscall prints value, which may not be $v0 or $a0 */
+void emitOutputSyscall(CompileContext *ctx, Reg value);
 
 #endif
@@ -0,0 +1,292 @@
+#include "globals.h"
+
+/* set NO_PARSE to TRUE to get scanner-only compiler */
+#define NO_PARSE FALSE
+
+/* set NO_ANALYZE to TRUE to get parser-only compiler */
+#define NO_ANALYZE FALSE
+
+/* set NO_CODE to TRUE to get a compiler that does not generate code */
+#define NO_CODE FALSE
+
+#include "compile.h"
+#include "util.h"
+#include "scan.h"
+#include "atom.h"
+#include "arena.h"
+#include "cache.h"
+#include "code.h"
+#if !NO_PARSE
+#include "parse.h"
+#if !NO_ANALYZE
+#include "analyze.h"
+#if !NO_CODE
+#include "cgen.h"
+#endif
+#endif
+#endif
+
+int initCompileContext(CompileContext *ctx, FILE *listing) {
+  memset(ctx, 0, sizeof(CompileContext));
+  ctx->listing = listing;
+
+  /* tracing flags */
+  ctx->EchoSource = TRUE;
+  ctx->TraceCode = FALSE;
+  setTraceLevel(ctx, TRACE_SYMTAB);
+
+  ctx->Error = FALSE;
+  ctx->analyzeThreads = 1;
+  ctx->optLevel = DEFAULT_OPT_LEVEL;
+
+  ctx->sessionArena = constructArena();
+  ctx->arena = constructArena();
+  if (ctx->sessionArena == NULL || ctx->arena == NULL) {
+    destroyArena(ctx->sessionArena);
+    destroyArena(ctx->arena);
+    return -1;
+  }
+  initAtoms(ctx);
+#if !NO_PARSE && !NO_ANALYZE
+  initBuiltins(ctx);
+#endif
+  ctx->nodes.mark = ctx->nodes.next;
+  return 0;
+}
+
+void setTraceLevel(CompileContext *ctx, TraceLevel level) {
+  ctx->TraceAnalyze = level >= TRACE_SYMTAB;
+  ctx->TraceParse = level >= TRACE_TREE;
+  ctx->TraceScan = level >= TRACE_TOKENS;
+}
+
+static void resetUnitArenas(CompileContext *ctx) {
+  int i;
+  if (ctx->unitArenas == NULL) return;
+  for (i = 0; i < ctx->analyzeThreads; ++i) {
+    if (ctx->unitArenas[i] != NULL) resetArena(ctx->unitArenas[i]);
+  }
+}
+
+void applyCompileOptions(CompileContext *ctx, CompileOptions const *options) {
+  if (options == NULL) return;
+  ctx->cache = options->cache;
+  setTraceLevel(ctx, options->traceLevel);
+  if (options->analyzeThreads > 0) ctx->analyzeThreads = options->analyzeThreads;
+  ctx->optLevel = options->optLevel;
+  ctx->DumpIR = options->dumpIR;
+  ctx->TracePeephole = options->peepholeStats;
+}
+
+void resetCompileContext(CompileContext *ctx, FILE *listing) {
+  closeScanner(ctx);
+  resetArena(ctx->arena);
+  resetUnitArenas(ctx);
+  rewindNodePool(ctx);
+
+  ctx->listing = listing;
+  ctx->code = NULL;
+  ctx->lineno = 0;
+  ctx->Error = FALSE;
+  ctx->syntaxTree = NULL;
+  ctx->analyze = NULL;
+  ctx->cgen = NULL;
+}
+
+/* Function runPhases runs the compiler proper, writing
+ * the code without its header comment to ctx->code
+ */
+static CompileStatus runPhases(CompileContext *ctx, SourceText *text) {
+  FILE *listing = ctx->listing;
+  TreeNode *syntaxTree;
+
+  /* abortCompile returns here */
+  if (setjmp(ctx->failure) != 0) return COMPILE_SEMANTIC_ERROR;
+
+  ++ctx->lineno;
+  scanSourceText(ctx, text);
+
+  if(TRACING(ctx, TraceScan)) {
+    fprintf(listing, "line number\t\t");
+    fprintf(listing, "token\t\t");
+    fprintf(listing, "lexeme\n");
+    fprintf(listing, "-----------------------------------------------------\n");
+  }
+
+#if NO_PARSE
+  YYSTYPE lval;
+  while(getToken(ctx, &lval) != ENDFILE) { /* NOOP */ }
+#else
+  syntaxTree = parse(ctx);
+  if(TRACING(ctx, TraceParse)) {
+    fprintf(listing, "\nSyntax tree %s:\n", ctx->Error ? "(constructed sofar)" : "");
+    printTree(ctx, syntaxTree);
+  }
+#if !NO_ANALYZE
+  if(!ctx->Error) {
+    if(TRACING(ctx, TraceAnalyze)) fprintf(listing, "\nBuilding Symbol Table...\n");
+    buildSymtab(ctx, syntaxTree);
+    if(TRACING(ctx, TraceAnalyze)) fprintf(listing, "\nChecking Types...\n");
+    reportTypeError(ctx);
+    if(TRACING(ctx, TraceAnalyze)) fprintf(listing, "\nType Checking Finished\n");
+  }
+#if !NO_CODE
+  if (!ctx->Error) {
+    codeGen(ctx, syntaxTree);
+  }
+#endif
+#endif
+#endif
+  return ctx->Error ? COMPILE_SYNTAX_ERROR : COMPILE_OK;
+}
+
+/* Function writeCode writes the code file named codefile,
+ * or to ctx->code if the caller has set it
+ */
+static CompileStatus writeCode(CompileContext *ctx, char const *codefile,
+                               char const *body, size_t bodySize) {
+  /* the caller may have supplied a stream for the code */
+  FILE *code = ctx->code;
+  if (NO_CODE) return COMPILE_OK;
+  if (code == NULL) {
+    ctx->code = fopen(codefile, "w");
+    if(ctx->code == NULL) {
+      fprintf(ctx->listing, "Unable to open %s\n", codefile);
+      return COMPILE_IO_ERROR;
+    }
+  }
+  emitHeader(ctx, codefile);
+  fwrite(body, 1, bodySize, ctx->code);
+  if (code == NULL) {
+    fclose(ctx->code);
+    ctx->code = NULL;
+  }
+  return COMPILE_OK;
+}
+
+CompileStatus compile(CompileContext *ctx, SourceText *text, char const *codefile) {
+  FILE *listing = ctx->listing, *code = ctx->code;
+  CompileCache *cache = ctx->cache;
+  unsigned char key[SHA256_DIGEST_SIZE];
+  char *captured = NULL, *body = NULL;
+  size_t capturedSize = 0, bodySize = 0;
+  CompileStatus status;
+
+  if (cache != NULL) {
+    cacheKey(cache, ctx, text->base, text->size, key);
+    int stored;
+    if (lookupCache(cache, key, &stored, &captured, &capturedSize, &body, &bodySize)) {
+      fwrite(captured, 1, capturedSize, listing);
+      status = (CompileStatus)stored;
+      if (status == COMPILE_OK) status = writeCode(ctx, codefile, body, bodySize);
+      free(captured);
+      free(body);
+      return status;
+    }
+    /* capture the listing to store it with the code */
+    ctx->listing = open_memstream(&captured, &capturedSize);
+  }
+  /* the code is buffered so that no file is written on errors */
+  ctx->code = open_memstream(&body, &bodySize);
+  if (ctx->listing == NULL || ctx->code == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+
+  status = runPhases(ctx, text);
+
+  fclose(ctx->code);
+  ctx->code = code;
+  if (cache != NULL) {
+    fclose(ctx->listing);
+    ctx->listing = listing;
+    fwrite(captured, 1, capturedSize, listing);
+    /* a failed compilation is as repeatable as a successful one */
+    storeCache(cache, key, status, captured, capturedSize,
+               body, status == COMPILE_OK ? bodySize : 0);
+  }
+  if (status == COMPILE_OK) status = writeCode(ctx, codefile, body, bodySize);
+
+  free(captured);
+  free(body);
+  return status;
+}
+
+void destroyCompileContext(CompileContext *ctx) {
+  /* teardown syntax tree, atoms and symbol tables in one go */
+  closeScanner(ctx);
+  clearAtoms(ctx);
+  resetNodePool(ctx);
+  if (ctx->unitArenas != NULL) {
+    int i;
+    for (i = 0; i < ctx->analyzeThreads; ++i) destroyArena(ctx->unitArenas[i]);
+    free(ctx->unitArenas);
+    ctx->unitArenas = NULL;
+  }
+  destroyArena(ctx->arena);
+  destroyArena(ctx->sessionArena);
+  ctx->arena = NULL;
+  ctx->sessionArena = NULL;
+}
+
+CompileStatus compileSource(CompileContext *ctx, char const *path, FILE *errors) {
+  SourceText text;
+  FILE *source;
+  CompileStatus status;
+  size_t len = strlen(path);
+  char const *base = strrchr(path, '/');
+  char *pgm, *codefile, *ext;
+
+  base = base != NULL ? base + 1 : path;
+  pgm = malloc(len + 4);
+  codefile = malloc(len + 4);
+  if (pgm == NULL || codefile == NULL) {
+    fprintf(errors, "Out of memory\n");
+    free(pgm);
+    free(codefile);
+    return COMPILE_IO_ERROR;
+  }
+  strcpy(pgm, path);
+  if (strchr(base, '.') == NULL) {
+    strcat(pgm, ".cm");
+  }
+
+  /* the code file replaces the extension of the source */
+  strcpy(codefile, pgm);
+  ext = strrchr(codefile + (base - path), '.');
+  strcpy(ext, ".tm");
+
+  status = COMPILE_IO_ERROR;
+  source = fopen(pgm, "r");
+  if (source == NULL) {
+    fprintf(errors, "File %s not found\n", pgm);
+  }
+  else if (openSourceText(source, &text) != 0) {
+    fprintf(errors, "Unable to read %s\n", pgm);
+    fclose(source);
+  }
+  else {
+    status = compile(ctx, &text, codefile);
+    closeScanner(ctx);
+    closeSourceText(&text);
+    fclose(source);
+  }
+
+  free(pgm);
+  free(codefile);
+  return status;
+}
+
+CompileStatus compileFile(char const *path, FILE *listing, CompileOptions const *options) {
+  CompileContext ctx;
+  CompileStatus status;
+
+  if (initCompileContext(&ctx, listing) != 0) {
+    fprintf(stderr, "Out of memory\n");
+    return COMPILE_IO_ERROR;
+  }
+  applyCompileOptions(&ctx, options);
+  status = compileSource(&ctx, path, stderr);
+  destroyCompileContext(&ctx);
+  return status;
+}
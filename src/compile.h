@@ -0,0 +1,96 @@
+#ifndef _COMPILE_H_
+#define _COMPILE_H_
+
+#include "source.h"
+
+/* CompileStatus is the outcome of one compilation */
+typedef enum {
+  COMPILE_OK = 0,
+  COMPILE_SYNTAX_ERROR = 1, /* lexical or syntax error reported */
+  COMPILE_SEMANTIC_ERROR = -1, /* analysis stopped at an error */
+  COMPILE_IO_ERROR = 2 /* source or code file unusable */
+} CompileStatus;
+
+/* TraceLevel selects what the listing shows besides the
+ * errors; every level adds to the one below
+ */
+typedef enum {
+  TRACE_ERRORS = 0, /* errors only */
+  TRACE_SYMTAB = 1, /* phase banners and symbol tables */
+  TRACE_TREE = 2, /* syntax tree */
+  TRACE_TOKENS = 3 /* every token scanned */
+} TraceLevel;
+
+/* optimization level of a context unless set otherwise */
+#define DEFAULT_OPT_LEVEL 2
+
+/* CompileOptions are the settings a driver applies to
+ * every compilation it runs
+ */
+typedef struct CompileOptions {
+  struct CompileCache *cache; /* shared, NULL when not caching */
+  int analyzeThreads; /* threads analyzing function bodies, 1 for none */
+  TraceLevel traceLevel;
+  int optLevel; /* 0 to 2, see opt.c */
+  int dumpIR; /* print the IR to the listing */
+  int peepholeStats; /* print the peephole rule hits to the listing */
+} CompileOptions;
+
+/* procedure initCompileContext prepares ctx for one
+ * compilation writing its listing to the given file;
+ * the tracing flags get their default values and may
+ * be changed before calling compile, one by one or
+ * with setTraceLevel.
+ * Returns 0 on success, -1 when out of memory.
+ */
+int initCompileContext(CompileContext *ctx, FILE *listing);
+
+/* procedure setTraceLevel sets the tracing flags of ctx
+ * for the given level; initCompileContext starts out at
+ * TRACE_SYMTAB
+ */
+void setTraceLevel(CompileContext *ctx, TraceLevel level);
+
+/* procedure applyCompileOptions applies options (unless
+ * NULL) to ctx before its first compilation
+ */
+void applyCompileOptions(CompileContext *ctx, CompileOptions const *options);
+
+/* procedure resetCompileContext prepares ctx for the next
+ * compilation, dropping everything of the last one except
+ * the session state: atoms, built-ins and allocator chunks
+ */
+void resetCompileContext(CompileContext *ctx, FILE *listing);
+
+/* Function compile scans, parses and analyzes the
+ * given text and writes the generated code to codefile,
+ * or to ctx->code if the caller has set it.  With a cache
+ * in ctx->cache, a hit replays the stored listing and code
+ * without compiling.
+ */
+CompileStatus compile(CompileContext *ctx, SourceText *text, char const *codefile);
+
+/* procedure destroyCompileContext releases everything
+ * the context allocated: syntax tree, atoms,
+ * symbol tables and scanner
+ */
+void destroyCompileContext(CompileContext *ctx);
+
+/* Function compileSource compiles the source file at path
+ * (".cm" is appended when it has no extension).  Unless
+ * ctx->code is set, the code goes to a ".tm" file next to
+ * the source.  Problems reading the source are reported
+ * to errors.
+ */
+CompileStatus compileSource(CompileContext *ctx, char const *path, FILE *errors);
+
+/* Function compileFile compiles the source file at path
+ * (".cm" is appended when it has no extension) into a
+ * ".tm" file next to it, writing the listing to listing.
+ * options may be NULL for the defaults.  It keeps no state
+ * between calls, so different files may be compiled on
+ * different threads at once.
+ */
+CompileStatus compileFile(char const *path, FILE *listing, CompileOptions const *options);
+
+#endif
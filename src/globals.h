@@ -6,6 +6,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <assert.h>
+#include <setjmp.h>
 
 #ifndef FALSE
 #define FALSE 0
@@ -23,12 +24,6 @@
 #define BLKCOMMENT 2
 typedef int TokenType;
 
-extern FILE *source; /* source code text file */
-extern FILE *listing; /* listing output text file */
-extern FILE *code; /* code text file for TM simulator */
-
-extern int lineno; /* source line number for listing */
-
 /**** Syntax tree for parsing ****/
 
 typedef enum { DeclK, ParamK, StmtK, ExprK, TypeK } NodeKind;
@@ -39,62 +34,194 @@ typedef enum { VarK, OpExprK, CallK, ConstK } ExprKind;
 /* ExpType is used for type checking */
 typedef enum { VoidK, IntK } TypeKind;
 
-#define MAXCHILDREN 7
+/* MAXCHILDREN = the largest number of children of any node */
+#define MAXCHILDREN 3
+
+/* Nodes refer to each other by 32-bit indices into the node
+ * pool (see util.c); index NULL_NODE stands for no node
+ */
+typedef unsigned int NodeIndex;
+#define NULL_NODE 0
 
 typedef struct treeNode {
-    int nChildren;
-    struct treeNode *child[MAXCHILDREN];
-    struct treeNode *sibling;
+    /* hot fields packed into the first word */
+    unsigned char nodekind; /* NodeKind */
+    union {
+        unsigned char decl; /* DeclKind */
+        unsigned char stmt; /* StmtKind */
+        unsigned char expr; /* ExprKind */
+    } kind;
+    unsigned char type; /* TypeKind */
+    unsigned char nChildren;
+    NodeIndex child[MAXCHILDREN];
+    NodeIndex sibling;
+    NodeIndex index; /* index of this node in the pool */
     int lineno;
-    NodeKind nodekind;
-    union { DeclKind decl; StmtKind stmt; ExprKind expr; } kind;
+    int loc;
     union {
         TokenType op;
         int val;
-        char *name;
+        char *name; /* interned, compare by pointer (see atom.h) */
     } attr;
-    void *scope_ref;
+    int scope; /* ScopeIndex, see analyze.h */
+    /* expressions only, see labelExpr in lower.c */
+    unsigned short regs;
+    unsigned short effects;
     void *sym_ref;
-    int loc;
-    TypeKind type;
 } TreeNode;
 
-#ifndef YYPARSER
-#include "cminus.tab.h"
-#endif
+/* The node pool is a table of fixed-size chunks, so nodes
+ * never move while the pool grows.  Slot 0 of every chunk
+ * is not a node but points back to the pool, so a node
+ * can find its neighbours without any global state.
+ */
+#define NODE_CHUNK_BITS 12
+#define NODE_CHUNK_MASK ((1u << NODE_CHUNK_BITS) - 1)
+
+struct NodePool {
+    TreeNode **chunks;
+    unsigned nChunks;
+    unsigned capChunks;
+    NodeIndex next;
+    NodeIndex mark; /* nodes below mark outlive a compilation */
+};
+
+/* nodeAt returns the node named by an index in the pool
+ * that holds node from, NULL for NULL_NODE
+ */
+static inline TreeNode *nodeAt(TreeNode const *from, NodeIndex i) {
+    if (i == NULL_NODE) return NULL;
+    TreeNode const *chunk = from - (from->index & NODE_CHUNK_MASK);
+    struct NodePool *pool = *(struct NodePool * const *)chunk;
+    return &pool->chunks[i >> NODE_CHUNK_BITS][i & NODE_CHUNK_MASK];
+}
+
+static inline TreeNode *getChild(TreeNode const *t, int i) {
+    return nodeAt(t, t->child[i]);
+}
+
+static inline TreeNode *getSibling(TreeNode const *t) {
+    return nodeAt(t, t->sibling);
+}
+
+static inline void setChild(TreeNode *t, int i, TreeNode *c) {
+    t->child[i] = c != NULL ? c->index : NULL_NODE;
+}
+
+static inline void setSibling(TreeNode *t, TreeNode *s) {
+    t->sibling = s != NULL ? s->index : NULL_NODE;
+}
+
+/* NodeList tracks both ends of a sibling chain
+ * so that list productions append in O(1)
+ */
+typedef struct {
+    TreeNode *head;
+    TreeNode *tail;
+} NodeList;
 
 /**************************************************/
-/***********   Flags for tracing       ************/
+/***********   Compilation context     ************/
 /**************************************************/
 
-/* EchoSource = TRUE causes the source program to
- * be echoed to the listing file with line numbers
- * during parsing
- */
-extern int EchoSource;
-
-/* TraceScan = TRUE causes token information to be
- * printed to the listing file as each token is
- * recognized by the scanner
+/* set NO_TRACE to TRUE (make TRACE=0) to compile the tracing
+ * out of the compiler; the trace flags are then ignored
  */
-extern int TraceScan;
+#ifndef NO_TRACE
+#define NO_TRACE FALSE
+#endif
 
-/* TraceParse = TRUE causes the syntax tree to be
- * printed to the listing file in linearized form
- * (using indents for children)
- */
-extern int TraceParse;
+/* TRACING tests one of the trace flags of a context */
+#define TRACING(ctx, flag) (!NO_TRACE && (ctx)->flag)
 
-/* TraceAnalyze = TRUE causes symbol table inserts
- * and lookups to be reported to the listing file
+/* CompileContext holds all state of one compilation.
+ * Every phase takes the context as its first argument,
+ * so independent compilations may run concurrently
+ * on separate threads.  A context may compile several
+ * programs in turn (see resetCompileContext), keeping
+ * its session state warm in between.
  */
-extern int TraceAnalyze;
+typedef struct compileContext {
+    FILE *listing; /* listing output text file */
+    FILE *code; /* code text file for TM simulator */
+
+    int lineno; /* source line number for listing */
+
+    /* EchoSource = TRUE causes the source program to
+     * be echoed to the listing file with line numbers
+     * during parsing
+     */
+    int EchoSource;
+
+    /* TraceScan = TRUE causes token information to be
+     * printed to the listing file as each token is
+     * recognized by the scanner
+     */
+    int TraceScan;
+
+    /* TraceParse = TRUE causes the syntax tree to be
+     * printed to the listing file in linearized form
+     * (using indents for children)
+     */
+    int TraceParse;
+
+    /* TraceAnalyze = TRUE causes symbol table inserts
+     * and lookups to be reported to the listing file
+     */
+    int TraceAnalyze;
+
+    /* TraceCode = TRUE causes comments to be written
+     * to the TM code file as code is generated
+     */
+    int TraceCode;
+
+    /* DumpIR = TRUE causes the IR of every function to be
+     * printed to the listing file after lowering and after
+     * each optimization pass
+     */
+    int DumpIR;
+
+    /* TracePeephole = TRUE causes the times every peephole
+     * rule was applied to be printed to the listing file
+     * once the code is generated
+     */
+    int TracePeephole;
+
+    /* optLevel selects the optimization passes, 0 to 2 */
+    int optLevel;
+
+    /* Error = TRUE prevents further passes if an error occurs */
+    int Error;
+
+    /* abortCompile jumps here after a fatal semantic error */
+    jmp_buf failure;
+
+    /* sessionArena owns the atoms, the node pool chunks and
+     * the built-in declarations, which are kept between
+     * compilations; arena owns everything else
+     */
+    struct ArenaRec *sessionArena;
+    struct ArenaRec *arena;
+    struct NodePool nodes;
+    struct AtomTable *atoms;
+    TreeNode *builtins; /* declarations of input and output */
+    struct ScanState *scan;
+    TreeNode *syntaxTree;
+    struct AnalyzeState *analyze;
+    struct CodeGenState *cgen;
+
+    struct CompileCache *cache; /* shared, NULL when not caching */
+
+    /* analyzeThreads > 1 analyzes function bodies on that
+     * many threads, each allocating from its unitArenas
+     * entry (made on first use, kept like arena)
+     */
+    int analyzeThreads;
+    struct ArenaRec **unitArenas;
+} CompileContext;
 
-/* TraceCode = TRUE causes comments to be written
- * to the TM code file as code is generated
- */
-extern int TraceCode;
+#ifndef YYPARSER
+#include "cminus.tab.h"
+#endif
 
-/* Error = TRUE prevents further passes if an error occurs */
-extern int Error; 
-#endif 
+#endif
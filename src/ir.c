@@ -0,0 +1,347 @@
+#include "globals.h"
+#include "ir.h"
+#include "arena.h"
+
+void *irAlloc(CompileContext *ctx, size_t n, size_t size) {
+  void *p = arenaCalloc(ctx->arena, n ? n : 1, size);
+  if(p == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+/* growArray makes room for one more element of an array
+ * living in the arena */
+static void *growArray(CompileContext *ctx, void *arr, int n, int *cap, size_t size) {
+  void *grown;
+  if(n < *cap) return arr;
+  *cap = *cap ? *cap * 2 : 8;
+  grown = irAlloc(ctx, *cap, size);
+  if(n) memcpy(grown, arr, n * size);
+  return grown;
+}
+
+Operand tempOperand(int temp) {
+  Operand opd = { OPD_TEMP, temp };
+  return opd;
+}
+
+Operand varOperand(int var) {
+  Operand opd = { OPD_VAR, var };
+  return opd;
+}
+
+Operand constOperand(int val) {
+  Operand opd = { OPD_CONST, val };
+  return opd;
+}
+
+Operand noOperand(void) {
+  Operand opd = { OPD_NONE, 0 };
+  return opd;
+}
+
+int sameOperand(Operand x, Operand y) {
+  return x.kind == y.kind && x.val == y.val;
+}
+
+IrFunction *newIrFunction(CompileContext *ctx, TreeNode *funNode) {
+  IrFunction *fn = irAlloc(ctx, 1, sizeof(IrFunction));
+  fn->name = funNode->attr.name;
+  fn->decl = funNode;
+  return fn;
+}
+
+IrBlock *newIrBlock(CompileContext *ctx, IrFunction *fn) {
+  IrBlock *block = irAlloc(ctx, 1, sizeof(IrBlock));
+  block->id = fn->nextBlockId++;
+  block->term = TERM_JUMP;
+  return block;
+}
+
+void placeIrBlock(CompileContext *ctx, IrFunction *fn, IrBlock *block) {
+  fn->blocks = growArray(ctx, fn->blocks, fn->nBlocks, &fn->capBlocks, sizeof(IrBlock *));
+  fn->blocks[fn->nBlocks++] = block;
+}
+
+IrInstr *appendInstr(CompileContext *ctx, IrBlock *block, int op,
+                     Operand dst, Operand a, Operand b) {
+  IrInstr *instr;
+  block->instrs = growArray(ctx, block->instrs, block->nInstrs, &block->capInstrs, sizeof(IrInstr));
+  instr = &block->instrs[block->nInstrs++];
+  instr->op = op;
+  instr->dst = dst;
+  instr->a = a;
+  instr->b = b;
+  instr->name = NULL;
+  instr->nArgs = 0;
+  return instr;
+}
+
+int newTemp(IrFunction *fn) {
+  return fn->nTemps++;
+}
+
+int newVar(CompileContext *ctx, IrFunction *fn, TreeNode *decl, char const *name) {
+  IrVar *var;
+  fn->vars = growArray(ctx, fn->vars, fn->nVars, &fn->capVars, sizeof(IrVar));
+  var = &fn->vars[fn->nVars];
+  memset(var, 0, sizeof *var);
+  var->decl = decl;
+  var->name = name;
+  return fn->nVars++;
+}
+
+int instrHasEffects(IrInstr const *instr) {
+  switch(instr->op) {
+  case IR_STORE:
+  case IR_ARG:
+  case IR_CALL:
+  case IR_INPUT:
+  case IR_OUTPUT:
+    return TRUE;
+  case IR_DIV:
+    // dividing by zero traps, so the division is kept
+    // unless its divisor is known to be non-zero
+    return instr->b.kind != OPD_CONST || instr->b.val == 0;
+  default:
+    return FALSE;
+  }
+}
+
+/* the variable of IR_ADDR is named, not read */
+void instrUses(IrInstr *instr, void (*use)(Operand *, void *), void *arg) {
+  if(instr->op == IR_ADDR) return;
+  if(instr->a.kind != OPD_NONE) use(&instr->a, arg);
+  if(instr->b.kind != OPD_NONE) use(&instr->b, arg);
+}
+
+void termUses(IrBlock *block, void (*use)(Operand *, void *), void *arg) {
+  if(block->term == TERM_JUMP) return;
+  if(block->a.kind != OPD_NONE) use(&block->a, arg);
+  if(block->term == TERM_BRANCH && block->b.kind != OPD_NONE) use(&block->b, arg);
+}
+
+int invertCompare(int cmp) {
+  switch(cmp) {
+  case IR_SLT: return IR_SGE;
+  case IR_SLE: return IR_SGT;
+  case IR_SGT: return IR_SLE;
+  case IR_SGE: return IR_SLT;
+  case IR_SEQ: return IR_SNE;
+  default: return IR_SEQ;
+  }
+}
+
+int swapCompare(int cmp) {
+  switch(cmp) {
+  case IR_SLT: return IR_SGT;
+  case IR_SLE: return IR_SGE;
+  case IR_SGT: return IR_SLT;
+  case IR_SGE: return IR_SLE;
+  default: return cmp;
+  }
+}
+
+void countPreds(IrFunction *fn, int *preds) {
+  int i;
+  memset(preds, 0, fn->nextBlockId * sizeof(int));
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    if(block->term == TERM_JUMP) ++preds[block->succ[0]->id];
+    else if(block->term == TERM_BRANCH) {
+      ++preds[block->succ[0]->id];
+      ++preds[block->succ[1]->id];
+    }
+  }
+}
+
+/* Liveness of the variables is solved backwards over the
+ * blocks until nothing changes.  The globals are live
+ * where the function returns and wherever it calls, since
+ * the caller and the callee may read them.
+ */
+struct LiveScan {
+  IrFunction *fn;
+  unsigned *live;
+};
+
+static void markLive(Operand *opd, void *arg) {
+  struct LiveScan *scan = arg;
+  if(opd->kind == OPD_VAR) LIVE_SET(scan->live, opd->val);
+}
+
+static void markGlobalsLive(IrFunction *fn, unsigned *live) {
+  int v;
+  for(v = 0; v < fn->nVars; ++v) {
+    if(fn->vars[v].global) LIVE_SET(live, v);
+  }
+}
+
+/* liveBefore turns live, the set after the block, into
+ * the set on its entry */
+static void liveBefore(IrFunction *fn, IrBlock *block, unsigned *live) {
+  struct LiveScan scan = { fn, live };
+  int i;
+
+  if(block->term == TERM_RETURN) markGlobalsLive(fn, live);
+  termUses(block, markLive, &scan);
+  for(i = block->nInstrs; i-- > 0; ) {
+    IrInstr *instr = &block->instrs[i];
+    if(instr->dst.kind == OPD_VAR) LIVE_CLEAR(live, instr->dst.val);
+    if(instr->op == IR_CALL) markGlobalsLive(fn, live);
+    instrUses(instr, markLive, &scan);
+  }
+}
+
+void computeLiveness(CompileContext *ctx, IrFunction *fn) {
+  int words = LIVE_WORDS(fn);
+  unsigned *live = irAlloc(ctx, words, sizeof(unsigned));
+  int changed = TRUE;
+  int i, w;
+
+  for(i = 0; i < fn->nBlocks; ++i) {
+    fn->blocks[i]->liveIn = irAlloc(ctx, words, sizeof(unsigned));
+    fn->blocks[i]->liveOut = irAlloc(ctx, words, sizeof(unsigned));
+  }
+
+  while(changed) {
+    changed = FALSE;
+    for(i = fn->nBlocks; i-- > 0; ) {
+      IrBlock *block = fn->blocks[i];
+      int s, nSucc = block->term == TERM_BRANCH ? 2 : block->term == TERM_JUMP;
+
+      for(s = 0; s < nSucc; ++s) {
+        for(w = 0; w < words; ++w) block->liveOut[w] |= block->succ[s]->liveIn[w];
+      }
+      memcpy(live, block->liveOut, words * sizeof(unsigned));
+      liveBefore(fn, block, live);
+      for(w = 0; w < words; ++w) {
+        if(live[w] & ~block->liveIn[w]) {
+          block->liveIn[w] |= live[w];
+          changed = TRUE;
+        }
+      }
+    }
+  }
+}
+
+static char const *opNames[] = {
+  "+", "-", "*", "/", "<<", "+u", "<", "<=", ">", ">=", "==", "!="
+};
+
+static void printOperand(CompileContext *ctx, IrFunction *fn, Operand opd) {
+  FILE *listing = ctx->listing;
+  int v, same = 0;
+
+  switch(opd.kind) {
+  case OPD_TEMP:
+    fprintf(listing, "t%d", opd.val);
+    break;
+  case OPD_CONST:
+    fprintf(listing, "%d", opd.val);
+    break;
+  case OPD_VAR:
+    if(fn->vars[opd.val].name == NULL) {
+      fprintf(listing, "%%v%d", opd.val);
+      break;
+    }
+    // a name shadowed in an inner block gets a suffix
+    for(v = 0; v < opd.val; ++v) {
+      if(fn->vars[v].name == fn->vars[opd.val].name) ++same;
+    }
+    if(same) fprintf(listing, "%s.%d", fn->vars[opd.val].name, same);
+    else fprintf(listing, "%s", fn->vars[opd.val].name);
+    break;
+  default:
+    fprintf(listing, "?");
+    break;
+  }
+}
+
+static void printInstr(CompileContext *ctx, IrFunction *fn, IrInstr *instr) {
+  FILE *listing = ctx->listing;
+
+  fprintf(listing, "    ");
+  if(instr->dst.kind != OPD_NONE) {
+    printOperand(ctx, fn, instr->dst);
+    fprintf(listing, " = ");
+  }
+  switch(instr->op) {
+  case IR_MOVE:
+    printOperand(ctx, fn, instr->a);
+    break;
+  case IR_ADDR:
+    fprintf(listing, "&");
+    printOperand(ctx, fn, instr->a);
+    break;
+  case IR_LOAD:
+    fprintf(listing, "*");
+    printOperand(ctx, fn, instr->a);
+    break;
+  case IR_STORE:
+    fprintf(listing, "*");
+    printOperand(ctx, fn, instr->a);
+    fprintf(listing, " = ");
+    printOperand(ctx, fn, instr->b);
+    break;
+  case IR_ARG:
+    fprintf(listing, "arg ");
+    printOperand(ctx, fn, instr->a);
+    break;
+  case IR_CALL:
+    fprintf(listing, "call %s, %d", instr->name, instr->nArgs);
+    break;
+  case IR_INPUT:
+    fprintf(listing, "input");
+    break;
+  case IR_OUTPUT:
+    fprintf(listing, "output ");
+    printOperand(ctx, fn, instr->a);
+    break;
+  default:
+    assert(IR_IS_BINARY(instr->op));
+    printOperand(ctx, fn, instr->a);
+    fprintf(listing, " %s ", opNames[instr->op]);
+    printOperand(ctx, fn, instr->b);
+    break;
+  }
+  fputc('\n', listing);
+}
+
+void printIrFunction(CompileContext *ctx, IrFunction *fn, char const *title) {
+  FILE *listing = ctx->listing;
+  int i, j;
+
+  fprintf(listing, "\nIR of %s %s:\n", fn->name, title);
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    fprintf(listing, "  L%d:", block->id);
+    if(block->loopDepth > 0) fprintf(listing, "\t\t; loop depth %d", block->loopDepth);
+    fputc('\n', listing);
+
+    for(j = 0; j < block->nInstrs; ++j) printInstr(ctx, fn, &block->instrs[j]);
+
+    switch(block->term) {
+    case TERM_JUMP:
+      fprintf(listing, "    goto L%d\n", block->succ[0]->id);
+      break;
+    case TERM_BRANCH:
+      fprintf(listing, "    if ");
+      printOperand(ctx, fn, block->a);
+      fprintf(listing, " %s ", opNames[block->cmp]);
+      printOperand(ctx, fn, block->b);
+      fprintf(listing, " goto L%d else L%d\n", block->succ[0]->id, block->succ[1]->id);
+      break;
+    case TERM_RETURN:
+      fprintf(listing, "    return");
+      if(block->a.kind != OPD_NONE) {
+        fputc(' ', listing);
+        printOperand(ctx, fn, block->a);
+      }
+      fputc('\n', listing);
+      break;
+    }
+  }
+}
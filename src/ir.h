@@ -0,0 +1,173 @@
+#ifndef _IR_H_
+#define _IR_H_
+
+/* The intermediate representation sits between the
+ * analyzed syntax tree and the MIPS code.  Every function
+ * is lowered (lower.c) to three-address instructions in
+ * basic blocks joined by an explicit control flow graph,
+ * the optimization passes (opt.c) rewrite it in place
+ * and cgen.c emits the code for it.
+ *
+ * An operand is a temporary, a variable or a constant.
+ * Temporaries are defined once and used only within the
+ * block defining them; a value crossing blocks lives in a
+ * variable.  Variables are the locals, parameters and
+ * globals the function refers to, and those a pass makes
+ * up, which have no declaration.
+ */
+
+typedef enum {
+  OPD_NONE,
+  OPD_TEMP,
+  OPD_VAR,
+  OPD_CONST
+} OperandKind;
+
+typedef struct {
+  int kind; /* OperandKind */
+  int val;  /* temporary, variable number or constant */
+} Operand;
+
+typedef enum {
+  /* dst = a op b; the comparisons give 1 or 0 */
+  IR_ADD, IR_SUB, IR_MUL, IR_DIV,
+  IR_SLL, /* b is a constant */
+  IR_ADDU, /* an address: wraps around instead of trapping */
+  IR_SLT, IR_SLE, IR_SGT, IR_SGE, IR_SEQ, IR_SNE,
+
+  IR_MOVE,   /* dst = a */
+  IR_ADDR,   /* dst = address of the array variable a */
+  IR_LOAD,   /* dst = word at address a */
+  IR_STORE,  /* word at address a = b */
+  IR_ARG,    /* push a as the next argument */
+  IR_CALL,   /* dst = call name, popping nArgs arguments */
+  IR_INPUT,  /* dst = input() */
+  IR_OUTPUT  /* output(a) */
+} IrOpcode;
+
+#define IR_IS_BINARY(op) ((op) <= IR_SNE)
+#define IR_IS_COMPARE(op) ((op) >= IR_SLT && (op) <= IR_SNE)
+
+typedef struct {
+  int op; /* IrOpcode */
+  Operand dst, a, b;
+  char const *name; /* IR_CALL */
+  int nArgs;        /* IR_CALL */
+} IrInstr;
+
+typedef enum {
+  TERM_JUMP,   /* goto succ[0] */
+  TERM_BRANCH, /* if a cmp b goto succ[0] else succ[1] */
+  TERM_RETURN  /* return a, if any */
+} TermKind;
+
+typedef struct IrBlock {
+  int id;
+  IrInstr *instrs;
+  int nInstrs, capInstrs;
+
+  int term; /* TermKind */
+  int cmp;  /* TERM_BRANCH: a comparison IrOpcode */
+  Operand a, b;
+  struct IrBlock *succ[2];
+
+  int loopDepth; /* number of loops around the block */
+
+  /* variables live on entry and on exit, one bit per
+     variable, filled in by computeLiveness */
+  unsigned *liveIn, *liveOut;
+} IrBlock;
+
+typedef struct {
+  TreeNode *decl; /* NULL for a variable made up by a pass */
+  char const *name;
+  int global;
+  int param;
+  int array; /* an array or an array parameter */
+  int loc;   /* memory location, as in TreeNode */
+} IrVar;
+
+typedef struct {
+  char const *name;
+  TreeNode *decl;
+
+  /* in layout order, the entry first */
+  IrBlock **blocks;
+  int nBlocks, capBlocks;
+  int nextBlockId;
+
+  IrVar *vars;
+  int nVars, capVars;
+
+  int nTemps;
+} IrFunction;
+
+#define LIVE_WORDS(fn) (((fn)->nVars + 31) / 32)
+#define LIVE_TEST(set, v) ((set)[(v) / 32] >> ((v) % 32) & 1u)
+#define LIVE_SET(set, v) ((set)[(v) / 32] |= 1u << ((v) % 32))
+#define LIVE_CLEAR(set, v) ((set)[(v) / 32] &= ~(1u << ((v) % 32)))
+
+/* Function irAlloc returns zeroed memory for n elements
+ * from ctx->arena, ending the compiler when out of memory
+ */
+void *irAlloc(CompileContext *ctx, size_t n, size_t size);
+
+Operand tempOperand(int temp);
+Operand varOperand(int var);
+Operand constOperand(int val);
+Operand noOperand(void);
+int sameOperand(Operand x, Operand y);
+
+IrFunction *newIrFunction(CompileContext *ctx, TreeNode *funNode);
+
+/* newIrBlock makes a block that is not in the layout yet */
+IrBlock *newIrBlock(CompileContext *ctx, IrFunction *fn);
+
+/* procedure placeIrBlock appends a block to the layout */
+void placeIrBlock(CompileContext *ctx, IrFunction *fn, IrBlock *block);
+
+/* Function appendInstr appends an instruction to a block
+ * and returns it, valid until the next append
+ */
+IrInstr *appendInstr(CompileContext *ctx, IrBlock *block, int op,
+                     Operand dst, Operand a, Operand b);
+
+int newTemp(IrFunction *fn);
+int newVar(CompileContext *ctx, IrFunction *fn, TreeNode *decl, char const *name);
+
+/* Function instrHasEffects tells whether an instruction
+ * does more than define its dst
+ */
+int instrHasEffects(IrInstr const *instr);
+
+/* Function instrUses calls use for every operand the
+ * instruction reads; termUses does so for a terminator
+ */
+void instrUses(IrInstr *instr, void (*use)(Operand *, void *), void *arg);
+void termUses(IrBlock *block, void (*use)(Operand *, void *), void *arg);
+
+/* invertCompare returns the comparison true where cmp
+ * is false; swapCompare the one comparing its operands
+ * the other way around */
+int invertCompare(int cmp);
+int swapCompare(int cmp);
+
+/* Function countPreds fills preds[id] with the number of
+ * edges into every block, by block id
+ */
+void countPreds(IrFunction *fn, int *preds);
+
+/* procedure computeLiveness fills in liveIn and liveOut
+ * of every block
+ */
+void computeLiveness(CompileContext *ctx, IrFunction *fn);
+
+/* procedure printIrFunction dumps a function to the listing */
+void printIrFunction(CompileContext *ctx, IrFunction *fn, char const *title);
+
+/* Function lowerFunction lowers an analyzed function
+ * declaration to the IR (see lower.c)
+ */
+IrFunction *lowerFunction(CompileContext *ctx, TreeNode *funNode);
+
+#endif
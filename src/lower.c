@@ -0,0 +1,381 @@
+#include "globals.h"
+#include "analyze.h"
+#include "ir.h"
+
+/* Lowering walks the body of a function once, appending
+ * three-address instructions to the current block.
+ * Expressions are evaluated into fresh temporaries, or
+ * straight into the variable they are assigned to.
+ */
+struct LowerState {
+  CompileContext *ctx;
+  IrFunction *fn;
+  IrBlock *block; /* instructions go here */
+  int loopDepth;
+
+  /* declaration -> variable number, open addressing */
+  TreeNode **declKeys;
+  int *declVars;
+  unsigned capDecls, nDecls;
+};
+
+static void lowerStmt(struct LowerState *ls, TreeNode *tnode);
+static Operand lowerExpr(struct LowerState *ls, TreeNode *tnode, Operand const *into);
+
+static int isArrayDecl(TreeNode *decl) {
+  return getChild(decl, 0)->attr.val >= 0;
+}
+
+static unsigned hashDecl(TreeNode const *decl, unsigned cap) {
+  return (unsigned)(((size_t)decl >> 4) * 2654435761u) & (cap - 1);
+}
+
+/* varOf returns the variable a VarK node refers to */
+static int varOf(struct LowerState *ls, TreeNode *varNode) {
+  TreeNode *decl = getTreeNode(varNode->sym_ref);
+  unsigned h;
+  int v;
+
+  if(2 * (ls->nDecls + 1) > ls->capDecls) {
+    TreeNode **oldKeys = ls->declKeys;
+    int *oldVars = ls->declVars;
+    unsigned i, oldCap = ls->capDecls;
+
+    ls->capDecls = oldCap ? oldCap * 2 : 64;
+    ls->declKeys = irAlloc(ls->ctx, ls->capDecls, sizeof(TreeNode *));
+    ls->declVars = irAlloc(ls->ctx, ls->capDecls, sizeof(int));
+    for(i = 0; i < oldCap; ++i) {
+      if(oldKeys[i] == NULL) continue;
+      h = hashDecl(oldKeys[i], ls->capDecls);
+      while(ls->declKeys[h] != NULL) h = (h + 1) & (ls->capDecls - 1);
+      ls->declKeys[h] = oldKeys[i];
+      ls->declVars[h] = oldVars[i];
+    }
+  }
+
+  h = hashDecl(decl, ls->capDecls);
+  while(ls->declKeys[h] != NULL) {
+    if(ls->declKeys[h] == decl) return ls->declVars[h];
+    h = (h + 1) & (ls->capDecls - 1);
+  }
+
+  v = newVar(ls->ctx, ls->fn, decl, decl->attr.name);
+  ls->fn->vars[v].global = scopeAt(ls->ctx, varNode->scope)->scopeId == 0;
+  ls->fn->vars[v].param = decl->nodekind == ParamK;
+  ls->fn->vars[v].array = isArrayDecl(decl);
+  ls->fn->vars[v].loc = varNode->loc;
+  ls->declKeys[h] = decl;
+  ls->declVars[h] = v;
+  ++ls->nDecls;
+  return v;
+}
+
+/* The operands of a binary operator are lowered in the
+ * order that needs the fewer temporaries (Sethi-Ullman):
+ * labelExpr numbers every subtree with the temporaries it
+ * ties up, and of two operands the one needing more goes
+ * first.  Operands with side effects keep their
+ * left-to-right order.  Variables and constants are used
+ * in place and need none.
+ */
+static void labelExpr(TreeNode *tnode) {
+  TreeNode *lhs, *rhs;
+
+  switch(tnode->kind.expr) {
+  case VarK:
+    // an array is used by its address
+    tnode->regs = isArrayDecl(getTreeNode(tnode->sym_ref));
+    tnode->effects = FALSE;
+    return;
+
+  case ConstK:
+    tnode->regs = 0;
+    tnode->effects = FALSE;
+    return;
+
+  case CallK: {
+    TreeNode *argNode;
+    for(argNode = getChild(tnode, 0); argNode != NULL; argNode = getSibling(argNode)) {
+      labelExpr(argNode);
+    }
+    tnode->regs = 1;
+    tnode->effects = TRUE;
+    return;
+  }
+
+  default:
+    break;
+  }
+
+  lhs = getChild(tnode, 0);
+  rhs = getChild(tnode, 1);
+  labelExpr(lhs);
+  labelExpr(rhs);
+  tnode->effects = lhs->effects || rhs->effects || tnode->attr.op == ASSIGN;
+
+  // a variable assigned to is stored to without a temporary
+  if(tnode->attr.op == ASSIGN && lhs->kind.expr == VarK) tnode->regs = rhs->regs;
+  else if(lhs->regs == rhs->regs) tnode->regs = lhs->regs + 1;
+  else tnode->regs = lhs->regs > rhs->regs ? lhs->regs : rhs->regs;
+}
+
+/* emitValue appends an instruction computing a value into
+ * *into, or into a new temporary when into is NULL */
+static Operand emitValue(struct LowerState *ls, int op, Operand const *into,
+                         Operand a, Operand b) {
+  Operand dst = into != NULL ? *into : tempOperand(newTemp(ls->fn));
+  appendInstr(ls->ctx, ls->block, op, dst, a, b);
+  return dst;
+}
+
+/* lowerAddress lowers an array variable to its address and
+ * an element to the address of the element */
+static Operand lowerAddress(struct LowerState *ls, TreeNode *tnode) {
+  if(tnode->kind.expr == VarK) {
+    return emitValue(ls, IR_ADDR, NULL, varOperand(varOf(ls, tnode)), noOperand());
+  }
+  assert(tnode->kind.expr == OpExprK && tnode->attr.op == LBRACKET);
+
+  TreeNode *arr = getChild(tnode, 0), *idx = getChild(tnode, 1);
+  Operand base, index, offset;
+  if(arr->regs >= idx->regs || idx->effects) {
+    base = lowerAddress(ls, arr);
+    index = lowerExpr(ls, idx, NULL);
+  }
+  else {
+    index = lowerExpr(ls, idx, NULL);
+    base = lowerAddress(ls, arr);
+  }
+  offset = emitValue(ls, IR_SLL, NULL, index, constOperand(2));
+  return emitValue(ls, IR_ADD, NULL, base, offset);
+}
+
+static Operand lowerOperand(struct LowerState *ls, TreeNode *tnode, int address) {
+  return address ? lowerAddress(ls, tnode) : lowerExpr(ls, tnode, NULL);
+}
+
+/* lowerOperands lowers lhs (its address if lhsAddress)
+ * and rhs into *l and *r */
+static void lowerOperands(struct LowerState *ls, TreeNode *lhs, int lhsAddress,
+                          TreeNode *rhs, Operand *l, Operand *r) {
+  if(lhs->effects || rhs->effects || lhs->regs >= rhs->regs) {
+    *l = lowerOperand(ls, lhs, lhsAddress);
+    if(l->kind == OPD_VAR && rhs->effects) {
+      // rhs may assign to the variable
+      *l = emitValue(ls, IR_MOVE, NULL, *l, noOperand());
+    }
+    *r = lowerExpr(ls, rhs, NULL);
+  }
+  else {
+    *r = lowerExpr(ls, rhs, NULL);
+    *l = lowerOperand(ls, lhs, lhsAddress);
+  }
+}
+
+static int binaryOpcode(TokenType op) {
+  switch(op) {
+  case PLUS: return IR_ADD;
+  case MINUS: return IR_SUB;
+  case STAR: return IR_MUL;
+  case SLASH: return IR_DIV;
+  case LT: return IR_SLT;
+  case LE: return IR_SLE;
+  case GT: return IR_SGT;
+  case GE: return IR_SGE;
+  case EQ: return IR_SEQ;
+  case NE: return IR_SNE;
+  default:
+    assert(!"unreachable code");
+    return IR_ADD;
+  }
+}
+
+static Operand lowerCall(struct LowerState *ls, TreeNode *tnode, Operand const *into) {
+  char const *name = tnode->attr.name;
+  TreeNode *argNode = getChild(tnode, 0);
+  IrInstr *call;
+  int nArgs = 0;
+
+  if(strcmp(name, "input") == 0) {
+    return emitValue(ls, IR_INPUT, into, noOperand(), noOperand());
+  }
+  if(strcmp(name, "output") == 0) {
+    Operand value = lowerExpr(ls, argNode, NULL);
+    appendInstr(ls->ctx, ls->block, IR_OUTPUT, noOperand(), value, noOperand());
+    return noOperand();
+  }
+
+  for(; argNode != NULL; argNode = getSibling(argNode), ++nArgs) {
+    Operand arg;
+    if(argNode->kind.expr == VarK && isArrayDecl(getTreeNode(argNode->sym_ref))) {
+      arg = lowerAddress(ls, argNode);
+    }
+    else arg = lowerExpr(ls, argNode, NULL);
+    appendInstr(ls->ctx, ls->block, IR_ARG, noOperand(), arg, noOperand());
+  }
+
+  if(getTreeNode(tnode->sym_ref)->type == VoidK) {
+    call = appendInstr(ls->ctx, ls->block, IR_CALL, noOperand(), noOperand(), noOperand());
+  }
+  else {
+    Operand dst = into != NULL ? *into : tempOperand(newTemp(ls->fn));
+    call = appendInstr(ls->ctx, ls->block, IR_CALL, dst, noOperand(), noOperand());
+  }
+  call->name = name;
+  call->nArgs = nArgs;
+  return call->dst;
+}
+
+/* lowerExpr lowers an expression and returns the operand
+ * holding its value, which is *into when into is given
+ * and the value could be computed there */
+static Operand lowerExpr(struct LowerState *ls, TreeNode *tnode, Operand const *into) {
+  TreeNode *lhs, *rhs;
+  Operand l, r;
+
+  assert(tnode->nodekind == ExprK);
+  switch(tnode->kind.expr) {
+  case ConstK:
+    return constOperand(tnode->attr.val);
+  case VarK:
+    return varOperand(varOf(ls, tnode));
+  case CallK:
+    return lowerCall(ls, tnode, into);
+  default:
+    break;
+  }
+
+  lhs = getChild(tnode, 0);
+  rhs = getChild(tnode, 1);
+  switch(tnode->attr.op) {
+  case ASSIGN:
+    if(lhs->kind.expr == VarK) {
+      Operand var = varOperand(varOf(ls, lhs));
+      Operand value = lowerExpr(ls, rhs, &var);
+      if(!sameOperand(value, var)) emitValue(ls, IR_MOVE, &var, value, noOperand());
+      return var;
+    }
+    lowerOperands(ls, lhs, TRUE, rhs, &l, &r);
+    appendInstr(ls->ctx, ls->block, IR_STORE, noOperand(), l, r);
+    return r;
+
+  case LBRACKET:
+    l = lowerAddress(ls, tnode);
+    return emitValue(ls, IR_LOAD, into, l, noOperand());
+
+  default:
+    lowerOperands(ls, lhs, FALSE, rhs, &l, &r);
+    return emitValue(ls, binaryOpcode(tnode->attr.op), into, l, r);
+  }
+}
+
+/* startBlock places a block and makes it current */
+static void startBlock(struct LowerState *ls, IrBlock *block) {
+  block->loopDepth = ls->loopDepth;
+  placeIrBlock(ls->ctx, ls->fn, block);
+  ls->block = block;
+}
+
+static void jumpTo(struct LowerState *ls, IrBlock *target) {
+  ls->block->term = TERM_JUMP;
+  ls->block->succ[0] = target;
+}
+
+/* lowerCondition ends the current block with a branch
+ * to ifTrue or ifFalse */
+static void lowerCondition(struct LowerState *ls, TreeNode *cond,
+                           IrBlock *ifTrue, IrBlock *ifFalse) {
+  Operand value;
+
+  labelExpr(cond);
+  value = lowerExpr(ls, cond, NULL);
+  ls->block->term = TERM_BRANCH;
+  ls->block->cmp = IR_SNE;
+  ls->block->a = value;
+  ls->block->b = constOperand(0);
+  ls->block->succ[0] = ifTrue;
+  ls->block->succ[1] = ifFalse;
+}
+
+static void lowerStmt(struct LowerState *ls, TreeNode *tnode) {
+  IrFunction *fn = ls->fn;
+
+  if(tnode->nodekind == ExprK) {
+    labelExpr(tnode);
+    lowerExpr(ls, tnode, NULL);
+    return;
+  }
+
+  switch(tnode->kind.stmt) {
+  case CompdK: {
+    TreeNode *stmtNode;
+    for(stmtNode = getChild(tnode, 1); stmtNode != NULL; stmtNode = getSibling(stmtNode)) {
+      lowerStmt(ls, stmtNode);
+    }
+    break;
+  }
+
+  case SelectK: {
+    IrBlock *thenBlock = newIrBlock(ls->ctx, fn);
+    IrBlock *join = newIrBlock(ls->ctx, fn);
+    IrBlock *elseBlock = tnode->nChildren == 3 ? newIrBlock(ls->ctx, fn) : join;
+
+    lowerCondition(ls, getChild(tnode, 0), thenBlock, elseBlock);
+    startBlock(ls, thenBlock);
+    lowerStmt(ls, getChild(tnode, 1));
+    jumpTo(ls, join);
+    if(elseBlock != join) {
+      startBlock(ls, elseBlock);
+      lowerStmt(ls, getChild(tnode, 2));
+      jumpTo(ls, join);
+    }
+    startBlock(ls, join);
+    break;
+  }
+
+  case IterK: {
+    IrBlock *head = newIrBlock(ls->ctx, fn);
+    IrBlock *body = newIrBlock(ls->ctx, fn);
+    IrBlock *exit = newIrBlock(ls->ctx, fn);
+
+    jumpTo(ls, head);
+    ++ls->loopDepth;
+    startBlock(ls, head);
+    lowerCondition(ls, getChild(tnode, 0), body, exit);
+    startBlock(ls, body);
+    lowerStmt(ls, getChild(tnode, 1));
+    jumpTo(ls, head);
+    --ls->loopDepth;
+    startBlock(ls, exit);
+    break;
+  }
+
+  case RetK:
+    ls->block->term = TERM_RETURN;
+    ls->block->a = noOperand();
+    if(tnode->nChildren == 1) {
+      TreeNode *value = getChild(tnode, 0);
+      labelExpr(value);
+      ls->block->a = lowerExpr(ls, value, NULL);
+    }
+    // whatever follows is unreachable
+    startBlock(ls, newIrBlock(ls->ctx, fn));
+    break;
+
+  default:
+    assert(!"unreachable");
+  }
+}
+
+IrFunction *lowerFunction(CompileContext *ctx, TreeNode *funNode) {
+  struct LowerState ls;
+
+  memset(&ls, 0, sizeof ls);
+  ls.ctx = ctx;
+  ls.fn = newIrFunction(ctx, funNode);
+  startBlock(&ls, newIrBlock(ctx, ls.fn));
+  lowerStmt(&ls, getChild(funNode, 2));
+  ls.block->term = TERM_RETURN;
+  ls.block->a = noOperand();
+  return ls.fn;
+}
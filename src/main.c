@@ -1,108 +1,167 @@
 #include "globals.h"
+#include "compile.h"
+#include "batch.h"
+#include "server.h"
+#include "cache.h"
 
-/* set NO_PARSE to TRUE to get scanner-only compiler */
-#define NO_PARSE FALSE
+#include <unistd.h>
 
-/* set NO_ANALYZE to TRUE to get parser-only compiler */
-#define NO_ANALYZE FALSE
+/* default size cap of the compile cache, in megabytes */
+#define DEFAULT_CACHE_MB 256
 
-/* set NO_CODE to TRUE to get a compiler that does not generate code */
-#define NO_CODE FALSE
+/* buffer size of stdout when it is not a terminal */
+#define LISTING_BUFFER_SIZE (1 << 20)
 
-#include "util.h"
-#if NO_PARSE
-#include "scan.h"
-#else
-#include "parse.h"
-#if !NO_ANALYZE
-#include "analyze.h"
-#if !NO_CODE
-#include "cgen.h"
-#endif
-#endif
-#endif
+/* input file names collected from the command line */
+static char **inputs;
+static int nInputs, capInputs;
 
-/* allocate global variables */
-int lineno = 0;
-FILE *source;
-FILE *listing;
-FILE *code;
+static void addInput(char const *name) {
+  if (nInputs == capInputs) {
+    capInputs = capInputs ? capInputs * 2 : 16;
+    inputs = realloc(inputs, capInputs * sizeof(char *));
+    if (inputs == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+  }
+  inputs[nInputs] = strdup(name);
+  if (inputs[nInputs] == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  ++nInputs;
+}
 
-/* allocate and set tracing flags */
-int EchoSource = TRUE;
-int TraceScan = FALSE;
-int TraceParse = FALSE;
-int TraceAnalyze = TRUE;
-int TraceCode = FALSE;
+/* procedure readResponseFile adds the file names listed
+ * one per line in a response file; blank lines and lines
+ * starting with '#' are skipped
+ */
+static void readResponseFile(char const *name) {
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t len;
+  FILE *fp = fopen(name, "r");
+  if (fp == NULL) {
+    fprintf(stderr, "File %s not found\n", name);
+    exit(1);
+  }
+  while ((len = getline(&line, &cap, fp)) >= 0) {
+    while (len > 0 && isspace((unsigned char)line[len-1])) line[--len] = '\0';
+    if (len == 0 || line[0] == '#') continue;
+    addInput(line);
+  }
+  free(line);
+  fclose(fp);
+}
 
-int Error = FALSE;
+static void usage(char const *prog) {
+  fprintf(stderr, "usage: %s [options] [-j threads] <filename>... | @<response file>\n", prog);
+  fprintf(stderr, "       %s [options] --server | --socket <path>\n", prog);
+  fprintf(stderr, "options: --cache <dir> [--cache-size <MB>] --analyze-threads <threads>\n");
+  fprintf(stderr, "         --trace <level>: 0 errors only, 1 symbol tables (default,\n");
+  fprintf(stderr, "         0 for -j and response files), 2 syntax tree, 3 tokens\n");
+  fprintf(stderr, "         -O0, -O1, -O2 (default): optimization level\n");
+  fprintf(stderr, "         --dump-ir: print the IR after lowering and after every pass\n");
+  fprintf(stderr, "         --peephole-stats: print how often every peephole rule applied\n");
+  exit(1);
+}
 
 int main(int argc, char *argv[]) {
-  TreeNode *syntaxTree;
-  char pgm[120]; /* source code file name */
-  if (argc != 2) {
-    fprintf(stderr, "usage: %s <filename>\n", argv[0]);
-    exit(1);
-  }
-  strcpy(pgm, argv[1]);
-  if (strchr(pgm, '.') == NULL) {
-    strcat(pgm, ".cm");
+  int batch = FALSE;
+  int server = FALSE;
+  char const *socketPath = NULL;
+  char const *cacheDir = NULL;
+  long cacheMB = DEFAULT_CACHE_MB;
+  CompileOptions options = { NULL, 1, TRACE_SYMTAB, DEFAULT_OPT_LEVEL, FALSE, FALSE };
+  int traceLevel = -1;
+  int nThreads = 0;
+  int status;
+  int i;
+
+  for (i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--cache") == 0) {
+      if (++i == argc) usage(argv[0]);
+      cacheDir = argv[i];
+    }
+    else if (strcmp(argv[i], "--cache-size") == 0) {
+      if (++i == argc) usage(argv[0]);
+      cacheMB = atol(argv[i]);
+      if (cacheMB <= 0) usage(argv[0]);
+    }
+    else if (strcmp(argv[i], "--analyze-threads") == 0) {
+      if (++i == argc) usage(argv[0]);
+      options.analyzeThreads = atoi(argv[i]);
+      if (options.analyzeThreads <= 0) usage(argv[0]);
+    }
+    else if (strcmp(argv[i], "--trace") == 0) {
+      if (++i == argc) usage(argv[0]);
+      traceLevel = atoi(argv[i]);
+      if (traceLevel < TRACE_ERRORS || traceLevel > TRACE_TOKENS) usage(argv[0]);
+    }
+    else if (strcmp(argv[i], "-O0") == 0) options.optLevel = 0;
+    else if (strcmp(argv[i], "-O1") == 0) options.optLevel = 1;
+    else if (strcmp(argv[i], "-O2") == 0) options.optLevel = 2;
+    else if (strcmp(argv[i], "--dump-ir") == 0) options.dumpIR = TRUE;
+    else if (strcmp(argv[i], "--peephole-stats") == 0) options.peepholeStats = TRUE;
+    else if (strcmp(argv[i], "--server") == 0) server = TRUE;
+    else if (strcmp(argv[i], "--socket") == 0) {
+      if (++i == argc) usage(argv[0]);
+      socketPath = argv[i];
+    }
+    else if (strcmp(argv[i], "-j") == 0) {
+      if (++i == argc) usage(argv[0]);
+      nThreads = atoi(argv[i]);
+      batch = TRUE;
+    }
+    else if (argv[i][0] == '@') {
+      readResponseFile(argv[i] + 1);
+      batch = TRUE;
+    }
+    else addInput(argv[i]);
   }
-  source = fopen(pgm, "r");
-  if (source == NULL) {
-    fprintf(stderr, "File %s not found\n", pgm);
-    exit(1);
+  if (server || socketPath != NULL) {
+    if (nInputs > 0 || batch || (server && socketPath != NULL)) usage(argv[0]);
   }
+  else if (nInputs == 0) usage(argv[0]);
 
-  listing = stdout; /* send listing to screen */
+  /* nobody reads the listings of the files a batch compiles */
+  if (traceLevel >= 0) options.traceLevel = traceLevel;
+  else if (nInputs > 1 || batch) options.traceLevel = TRACE_ERRORS;
 
-  extern FILE *yyin, *yyout;
-  ++lineno;
-  yyin = source;
-  yyout = listing;
+  /* the server flushes every reply itself */
+  if (!server && !isatty(fileno(stdout))) {
+    setvbuf(stdout, NULL, _IOFBF, LISTING_BUFFER_SIZE);
+  }
 
-  if(TraceScan) {
-    fprintf(listing, "line number\t\t");
-    fprintf(listing, "token\t\t");
-    fprintf(listing, "lexeme\n");
-    fprintf(listing, "-----------------------------------------------------\n");
+  if (cacheDir != NULL) {
+    options.cache = openCache(cacheDir, (size_t)cacheMB << 20);
+    if (options.cache == NULL) {
+      fprintf(stderr, "Unable to use cache directory %s\n", cacheDir);
+      exit(1);
+    }
   }
 
-#if NO_PARSE
-  while(getToken() != ENDFILE) { /* NOOP */ }
-#else
-  syntaxTree = parse();
-  if(TraceParse) {
-    fprintf(listing, "\nSyntax tree %s:\n", Error ? "(constructed sofar)" : "");
-    printTree(syntaxTree);
+  if (server) {
+    status = serveStream(stdin, stdout, &options) == 0 ? 0 : 1;
   }
-#if !NO_ANALYZE
-  if(!Error) {
-    fprintf(listing, "\nBuilding Symbol Table...\n");
-    buildSymtab(syntaxTree);
-    fprintf(listing, "\nChecking Types...\n");
-    typeCheck(syntaxTree);
-    fprintf(listing, "\nType Checking Finished\n");
+  else if (socketPath != NULL) {
+    status = serveSocket(socketPath, &options) == 0 ? 0 : 1;
   }
-#if !NO_CODE
-  if (!Error) {
-    char *codefile;
-    int fnlen = strcspn(pgm, ".");
-    codefile = (char *)calloc(fnlen+4, sizeof(char));
-    strncpy(codefile, pgm, fnlen);
-    strcat(codefile, ".tm");
-    code = fopen(codefile, "w");
-    if(code == NULL) {
-      printf("Unable to open %s\n", codefile);
-      exit(1);
-    }
-    codeGen(syntaxTree, codefile);
-    fclose(code);
+  else if (nInputs > 1 || batch) {
+    status = compileBatch(inputs, nInputs, nThreads, &options) > 0 ? 1 : 0;
   }
-#endif
-#endif
-#endif
-  /* TODO: teardown syntax tree*/
-  fclose(source);
-  return 0;
+  else {
+    /* send listing to screen */
+    status = compileFile(inputs[0], stdout, &options);
+    if (status == COMPILE_IO_ERROR) exit(1);
+    /* a semantic error ends the compiler with status -1 */
+    status = status == COMPILE_SEMANTIC_ERROR ? -1 : 0;
+  }
+
+  if (options.cache != NULL) closeCache(options.cache);
+
+  for (i = 0; i < nInputs; ++i) free(inputs[i]);
+  free(inputs);
+  return status;
 }
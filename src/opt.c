@@ -0,0 +1,887 @@
+#include "globals.h"
+#include "ir.h"
+#include "opt.h"
+
+#include <limits.h>
+
+/* An optimization pass rewrites one function in place.
+ * The passes run in the order of the table below, each
+ * from its optimization level on.
+ */
+struct IrPass {
+  char const *name;
+  int level; /* lowest optLevel running the pass */
+  void (*run)(CompileContext *ctx, IrFunction *fn);
+};
+
+/* removeBlocks drops the blocks flagged in gone (by id)
+ * from the layout */
+static void removeBlocks(IrFunction *fn, char const *gone) {
+  int i, n = 0;
+  for(i = 0; i < fn->nBlocks; ++i) {
+    if(!gone[fn->blocks[i]->id]) fn->blocks[n++] = fn->blocks[i];
+  }
+  fn->nBlocks = n;
+}
+
+/* skipEmpty follows a chain of blocks doing nothing but
+ * jumping on */
+static IrBlock *skipEmpty(IrFunction *fn, IrBlock *block) {
+  int steps;
+  for(steps = 0; steps < fn->nBlocks; ++steps) {
+    if(block->nInstrs > 0 || block->term != TERM_JUMP || block->succ[0] == block) break;
+    block = block->succ[0];
+  }
+  return block;
+}
+
+/* markReachable flags every block reachable from the
+ * entry, using stack for the blocks yet to visit */
+static void markReachable(IrFunction *fn, char *reached, IrBlock **stack) {
+  int n = 0;
+  stack[n++] = fn->blocks[0];
+  reached[fn->blocks[0]->id] = TRUE;
+  while(n > 0) {
+    IrBlock *block = stack[--n];
+    int s, nSucc = block->term == TERM_BRANCH ? 2 : block->term == TERM_JUMP;
+    for(s = 0; s < nSucc; ++s) {
+      if(reached[block->succ[s]->id]) continue;
+      reached[block->succ[s]->id] = TRUE;
+      stack[n++] = block->succ[s];
+    }
+  }
+}
+
+/* simplifyCfg threads jumps through empty blocks, drops
+ * unreachable blocks and merges a block into its only
+ * predecessor when that one jumps to it
+ */
+static void simplifyCfg(CompileContext *ctx, IrFunction *fn) {
+  int *preds = irAlloc(ctx, fn->nextBlockId, sizeof(int));
+  char *flags = irAlloc(ctx, fn->nextBlockId, sizeof(char));
+  IrBlock **stack = irAlloc(ctx, fn->nextBlockId, sizeof(IrBlock *));
+  int changed = TRUE;
+  int i, s;
+
+  while(changed) {
+    changed = FALSE;
+
+    for(i = 0; i < fn->nBlocks; ++i) {
+      IrBlock *block = fn->blocks[i];
+      int nSucc = block->term == TERM_BRANCH ? 2 : block->term == TERM_JUMP;
+      for(s = 0; s < nSucc; ++s) block->succ[s] = skipEmpty(fn, block->succ[s]);
+      if(block->term == TERM_BRANCH && block->succ[0] == block->succ[1]) {
+        block->term = TERM_JUMP;
+      }
+    }
+
+    memset(flags, 0, fn->nextBlockId);
+    markReachable(fn, flags, stack);
+    for(i = 0; i < fn->nBlocks; ++i) {
+      // flags now tell the blocks to drop
+      flags[fn->blocks[i]->id] = !flags[fn->blocks[i]->id];
+      if(flags[fn->blocks[i]->id]) changed = TRUE;
+    }
+    removeBlocks(fn, flags);
+
+    countPreds(fn, preds);
+    memset(flags, 0, fn->nextBlockId);
+    for(i = 0; i < fn->nBlocks; ++i) {
+      IrBlock *block = fn->blocks[i], *next;
+      if(flags[block->id]) continue;
+      while(block->term == TERM_JUMP) {
+        int j;
+        next = block->succ[0];
+        if(next == block || next == fn->blocks[0] || preds[next->id] != 1) break;
+
+        for(j = 0; j < next->nInstrs; ++j) {
+          IrInstr *instr = &next->instrs[j];
+          *appendInstr(ctx, block, instr->op, instr->dst, instr->a, instr->b) = *instr;
+        }
+        block->term = next->term;
+        block->cmp = next->cmp;
+        block->a = next->a;
+        block->b = next->b;
+        block->succ[0] = next->succ[0];
+        block->succ[1] = next->succ[1];
+        flags[next->id] = TRUE;
+        changed = TRUE;
+      }
+    }
+    removeBlocks(fn, flags);
+  }
+}
+
+/* Dead code elimination drops the instructions without
+ * effects whose result is never used, walking every block
+ * backwards with the variables live after it; a call, an
+ * input or a division that may trap whose result is
+ * unused loses its dst.  It goes on until nothing more is
+ * dropped, as a dropped use in one block may leave a
+ * definition in another one dead.
+ */
+struct DeadScan {
+  unsigned *live;
+  char *usedTemps;
+};
+
+static void markUsed(Operand *opd, void *arg) {
+  struct DeadScan *scan = arg;
+  if(opd->kind == OPD_VAR) LIVE_SET(scan->live, opd->val);
+  else if(opd->kind == OPD_TEMP) scan->usedTemps[opd->val] = TRUE;
+}
+
+static int isDead(IrInstr const *instr, struct DeadScan *scan) {
+  if(instr->dst.kind == OPD_TEMP) return !scan->usedTemps[instr->dst.val];
+  if(instr->dst.kind == OPD_VAR) return !LIVE_TEST(scan->live, instr->dst.val);
+  return FALSE;
+}
+
+static void removeDeadCode(CompileContext *ctx, IrFunction *fn) {
+  struct DeadScan scan;
+  int changed = TRUE;
+  int i, j, v;
+
+  scan.live = irAlloc(ctx, LIVE_WORDS(fn), sizeof(unsigned));
+  scan.usedTemps = irAlloc(ctx, fn->nTemps, sizeof(char));
+
+  while(changed) {
+    changed = FALSE;
+    computeLiveness(ctx, fn);
+    memset(scan.usedTemps, 0, fn->nTemps);
+
+    for(i = 0; i < fn->nBlocks; ++i) {
+      IrBlock *block = fn->blocks[i];
+      int n = block->nInstrs;
+
+      memcpy(scan.live, block->liveOut, LIVE_WORDS(fn) * sizeof(unsigned));
+      if(block->term == TERM_RETURN) {
+        for(v = 0; v < fn->nVars; ++v) {
+          if(fn->vars[v].global) LIVE_SET(scan.live, v);
+        }
+      }
+      termUses(block, markUsed, &scan);
+
+      for(j = block->nInstrs; j-- > 0; ) {
+        IrInstr *instr = &block->instrs[j];
+        if(isDead(instr, &scan)) {
+          if(!instrHasEffects(instr)) {
+            instr->op = -1;
+            --n;
+            changed = TRUE;
+            continue;
+          }
+          instr->dst = noOperand();
+        }
+        if(instr->dst.kind == OPD_VAR) LIVE_CLEAR(scan.live, instr->dst.val);
+        if(instr->op == IR_CALL) {
+          for(v = 0; v < fn->nVars; ++v) {
+            if(fn->vars[v].global) LIVE_SET(scan.live, v);
+          }
+        }
+        instrUses(instr, markUsed, &scan);
+      }
+
+      if(n < block->nInstrs) {
+        for(j = n = 0; j < block->nInstrs; ++j) {
+          if(block->instrs[j].op >= 0) block->instrs[n++] = block->instrs[j];
+        }
+        block->nInstrs = n;
+      }
+    }
+  }
+}
+
+/* Constant and copy propagation follows the values of the
+ * variables and temporaries through every block, replacing
+ * each use by the constant or the variable it is known to
+ * hold and folding the operations, and the branches, whose
+ * operands all turn out constant.  A copy is only used
+ * while the variable copied keeps its value, which the
+ * versions bumped at every definition tell.  The constants
+ * held on entry to the blocks are first solved over the
+ * graph, following only the edges of the branches that do
+ * not fold; the copies are not followed across blocks.
+ */
+struct Known {
+  Operand opd;  /* OPD_NONE when nothing is known */
+  int version;  /* of the variable opd, if it is one */
+};
+
+struct PropState {
+  IrFunction *fn;
+  struct Known *vars, *temps;
+  int *versions; /* by variable */
+};
+
+static void substitute(Operand *opd, void *arg) {
+  struct PropState *st = arg;
+  struct Known *known;
+
+  if(opd->kind == OPD_VAR) known = &st->vars[opd->val];
+  else if(opd->kind == OPD_TEMP) known = &st->temps[opd->val];
+  else return;
+  if(known->opd.kind == OPD_NONE) return;
+  if(known->opd.kind == OPD_VAR && st->versions[known->opd.val] != known->version) return;
+  *opd = known->opd;
+}
+
+/* define records what dst holds from now on; a variable
+ * is not known to hold a temporary, which would outlive
+ * its block */
+static void define(struct PropState *st, Operand dst, Operand value) {
+  struct Known *known;
+
+  if(dst.kind == OPD_VAR) {
+    ++st->versions[dst.val];
+    known = &st->vars[dst.val];
+    if(value.kind == OPD_TEMP || sameOperand(value, dst)) value = noOperand();
+  }
+  else if(dst.kind == OPD_TEMP) known = &st->temps[dst.val];
+  else return;
+  known->opd = value;
+  if(value.kind == OPD_VAR) known->version = st->versions[value.val];
+}
+
+/* foldBinary computes x op y as the code would, failing
+ * where the code would trap */
+static int foldBinary(int op, int x, int y, int *result) {
+  unsigned ux = (unsigned)x, uy = (unsigned)y;
+
+  switch(op) {
+  case IR_ADD: case IR_ADDU: *result = (int)(ux + uy); break;
+  case IR_SUB: *result = (int)(ux - uy); break;
+  case IR_MUL: *result = (int)(ux * uy); break;
+  case IR_DIV:
+    if(y == 0 || (x == INT_MIN && y == -1)) return FALSE;
+    *result = x / y;
+    break;
+  case IR_SLL: *result = (int)(ux << (y & 31)); break;
+  case IR_SLT: *result = x < y; break;
+  case IR_SLE: *result = x <= y; break;
+  case IR_SGT: *result = x > y; break;
+  case IR_SGE: *result = x >= y; break;
+  case IR_SEQ: *result = x == y; break;
+  case IR_SNE: *result = x != y; break;
+  default: return FALSE;
+  }
+  return TRUE;
+}
+
+/* isIdentity tells whether opd is a constant leaving the
+ * other operand of op as it is */
+static int isIdentity(int op, Operand opd) {
+  if(opd.kind != OPD_CONST) return FALSE;
+  switch(op) {
+  case IR_ADD: case IR_SUB: case IR_SLL: case IR_ADDU: return opd.val == 0;
+  case IR_MUL: case IR_DIV: return opd.val == 1;
+  default: return FALSE;
+  }
+}
+
+/* simplifyBinary turns a binary instruction into a move
+ * when its operands are constant, one of them is the
+ * identity of the operator or a factor is zero */
+static void simplifyBinary(IrInstr *instr) {
+  Operand a = instr->a, b = instr->b;
+  int op = instr->op, value;
+
+  if(a.kind == OPD_CONST && b.kind == OPD_CONST && foldBinary(op, a.val, b.val, &value)) {
+    a = constOperand(value);
+  }
+  else if(op == IR_MUL && (sameOperand(a, constOperand(0)) || sameOperand(b, constOperand(0)))) {
+    a = constOperand(0);
+  }
+  else if((op == IR_ADD || op == IR_ADDU || op == IR_MUL) && isIdentity(op, a)) a = b;
+  else if(!isIdentity(op, b)) return;
+  instr->op = IR_MOVE;
+  instr->a = a;
+  instr->b = noOperand();
+}
+
+static void propagateInstr(struct PropState *st, IrInstr *instr) {
+  int v;
+
+  instrUses(instr, substitute, st);
+  if(IR_IS_BINARY(instr->op)) simplifyBinary(instr);
+
+  if(instr->op == IR_CALL) {
+    // the callee may set any global
+    for(v = 0; v < st->fn->nVars; ++v) {
+      if(!st->fn->vars[v].global) continue;
+      ++st->versions[v];
+      st->vars[v].opd = noOperand();
+    }
+  }
+  define(st, instr->dst, instr->op == IR_MOVE ? instr->a : noOperand());
+}
+
+/* propagateBlock runs the block from the constants in on
+ * entry, rewriting it if asked; it returns the successor
+ * its branch always takes, or -1 */
+static int propagateBlock(struct PropState *st, IrBlock *block, Operand const *in, int rewrite) {
+  Operand a = block->a, b = block->b;
+  int i, taken;
+
+  for(i = 0; i < st->fn->nVars; ++i) st->vars[i].opd = in[i];
+  for(i = 0; i < block->nInstrs; ++i) {
+    IrInstr instr = block->instrs[i];
+    propagateInstr(st, &instr);
+    if(rewrite) block->instrs[i] = instr;
+  }
+
+  if(block->term != TERM_BRANCH) {
+    if(rewrite) termUses(block, substitute, st);
+    return block->term == TERM_JUMP ? 0 : -1;
+  }
+  substitute(&a, st);
+  substitute(&b, st);
+  if(a.kind != OPD_CONST || b.kind != OPD_CONST || !foldBinary(block->cmp, a.val, b.val, &taken)) {
+    taken = -1;
+  }
+  else taken = !taken;
+  if(rewrite) {
+    block->a = a;
+    block->b = b;
+    if(taken >= 0) {
+      block->term = TERM_JUMP;
+      block->succ[0] = block->succ[taken];
+      block->a = block->b = noOperand();
+    }
+  }
+  return taken;
+}
+
+/* mergeInto meets the constants on exit of a block with
+ * those on entry of a successor */
+static int mergeInto(struct PropState *st, Operand *in, char *reached) {
+  int v, changed = FALSE;
+
+  for(v = 0; v < st->fn->nVars; ++v) {
+    Operand out = st->vars[v].opd.kind == OPD_CONST ? st->vars[v].opd : noOperand();
+    if(!*reached) in[v] = out;
+    else if(in[v].kind == OPD_CONST && !sameOperand(in[v], out)) {
+      in[v] = noOperand();
+      changed = TRUE;
+    }
+  }
+  if(!*reached) changed = TRUE;
+  *reached = TRUE;
+  return changed;
+}
+
+static void propagateConstants(CompileContext *ctx, IrFunction *fn) {
+  struct PropState st;
+  Operand **in = irAlloc(ctx, fn->nextBlockId, sizeof(Operand *));
+  char *reached = irAlloc(ctx, fn->nextBlockId, sizeof(char));
+  int changed = TRUE;
+  int i, s;
+
+  st.fn = fn;
+  st.vars = irAlloc(ctx, fn->nVars, sizeof(struct Known));
+  st.temps = irAlloc(ctx, fn->nTemps, sizeof(struct Known));
+  st.versions = irAlloc(ctx, fn->nVars, sizeof(int));
+  for(i = 0; i < fn->nBlocks; ++i) {
+    in[fn->blocks[i]->id] = irAlloc(ctx, fn->nVars, sizeof(Operand));
+  }
+  reached[fn->blocks[0]->id] = TRUE;
+
+  while(changed) {
+    changed = FALSE;
+    for(i = 0; i < fn->nBlocks; ++i) {
+      IrBlock *block = fn->blocks[i];
+      int taken;
+      if(!reached[block->id]) continue;
+      taken = propagateBlock(&st, block, in[block->id], FALSE);
+      for(s = 0; s < 2; ++s) {
+        int nSucc = block->term == TERM_BRANCH ? 2 : block->term == TERM_JUMP;
+        if(s >= nSucc || (taken >= 0 && s != taken)) continue;
+        if(mergeInto(&st, in[block->succ[s]->id], &reached[block->succ[s]->id])) changed = TRUE;
+      }
+    }
+  }
+
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    if(reached[block->id]) propagateBlock(&st, block, in[block->id], TRUE);
+  }
+}
+
+/* Branch fusion turns a branch on t != 0 or t == 0, t
+ * being a comparison computed in the block, into a branch
+ * on that comparison, which the code does with a single
+ * compare-and-branch instead of setting a register and
+ * testing it.  The operands of the comparison must still
+ * hold their values at the end of the block; the
+ * comparison itself is left to dead code elimination.  A
+ * constant left operand is moved to the right.
+ */
+static int keepsOperands(IrFunction *fn, IrBlock *block, int k) {
+  IrInstr *cmp = &block->instrs[k];
+  int j;
+  for(j = k + 1; j < block->nInstrs; ++j) {
+    IrInstr *instr = &block->instrs[j];
+    if(instr->dst.kind == OPD_VAR &&
+       (sameOperand(instr->dst, cmp->a) || sameOperand(instr->dst, cmp->b))) return FALSE;
+    if(instr->op == IR_CALL &&
+       ((cmp->a.kind == OPD_VAR && fn->vars[cmp->a.val].global) ||
+        (cmp->b.kind == OPD_VAR && fn->vars[cmp->b.val].global))) return FALSE;
+  }
+  return TRUE;
+}
+
+static void fuseBranches(CompileContext *ctx, IrFunction *fn) {
+  int i, k;
+
+  (void)ctx; // the pass allocates nothing
+
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    if(block->term != TERM_BRANCH) continue;
+
+    if(block->a.kind == OPD_TEMP && sameOperand(block->b, constOperand(0)) &&
+       (block->cmp == IR_SNE || block->cmp == IR_SEQ)) {
+      for(k = block->nInstrs; k-- > 0; ) {
+        if(sameOperand(block->instrs[k].dst, block->a)) break;
+      }
+      if(k >= 0 && IR_IS_COMPARE(block->instrs[k].op) && keepsOperands(fn, block, k)) {
+        IrInstr *cmp = &block->instrs[k];
+        block->cmp = block->cmp == IR_SNE ? cmp->op : invertCompare(cmp->op);
+        block->a = cmp->a;
+        block->b = cmp->b;
+      }
+    }
+
+    if(block->a.kind == OPD_CONST && block->b.kind != OPD_CONST) {
+      Operand a = block->a;
+      block->a = block->b;
+      block->b = a;
+      block->cmp = swapCompare(block->cmp);
+    }
+  }
+}
+
+/* Loop rotation copies the test of a loop into the block
+ * jumping back to the head, so that block branches back
+ * to the body itself while the loop goes on, and the head
+ * is left as a guard run once on entry: one branch per
+ * iteration instead of a jump back and a test.  Only heads
+ * of at most ROTATE_MAX_INSTRS instructions ending in a
+ * branch are copied; the temporaries of the copy are
+ * renamed, as each is defined once.
+ */
+#define ROTATE_MAX_INSTRS 8
+
+struct Rename {
+  int *temps; /* by temporary of the head, its copy */
+};
+
+static void renameTemp(Operand *opd, void *arg) {
+  struct Rename *rename = arg;
+  if(opd->kind == OPD_TEMP) {
+    assert(rename->temps[opd->val] >= 0);
+    opd->val = rename->temps[opd->val];
+  }
+}
+
+static void rotateLoops(CompileContext *ctx, IrFunction *fn) {
+  struct Rename rename;
+  int *pos = irAlloc(ctx, fn->nextBlockId, sizeof(int));
+  int nTemps = fn->nTemps;
+  int i, j;
+
+  rename.temps = irAlloc(ctx, nTemps, sizeof(int));
+  for(i = 0; i < fn->nBlocks; ++i) pos[fn->blocks[i]->id] = i;
+
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *latch = fn->blocks[i], *head;
+    if(latch->term != TERM_JUMP) continue;
+    head = latch->succ[0];
+    // a jump backwards closes a loop
+    if(pos[head->id] >= i || head->term != TERM_BRANCH) continue;
+    if(head->nInstrs > ROTATE_MAX_INSTRS) continue;
+
+    for(j = 0; j < nTemps; ++j) rename.temps[j] = -1;
+    for(j = 0; j < head->nInstrs; ++j) {
+      IrInstr copy = head->instrs[j];
+      instrUses(&copy, renameTemp, &rename);
+      if(copy.dst.kind == OPD_TEMP) {
+        rename.temps[copy.dst.val] = newTemp(fn);
+        copy.dst.val = rename.temps[copy.dst.val];
+      }
+      *appendInstr(ctx, latch, copy.op, copy.dst, copy.a, copy.b) = copy;
+    }
+    latch->term = TERM_BRANCH;
+    latch->cmp = head->cmp;
+    latch->a = head->a;
+    latch->b = head->b;
+    termUses(latch, renameTemp, &rename);
+    latch->succ[0] = head->succ[0];
+    latch->succ[1] = head->succ[1];
+    // the head now runs once per entry into the loop
+    if(head->loopDepth > 0) --head->loopDepth;
+  }
+}
+
+/* Strength reduction keeps the address of the element
+ * of an array indexed by a variable in a pointer variable
+ * all through a loop, so an access in the loop is a single
+ * load or store instead of taking the address of the
+ * array, shifting the index and adding.  The index may
+ * only be stepped by constants in the loop, the pointer
+ * then stepping along with it, or not be set at all; an
+ * index plus or minus a constant is reached from the
+ * pointer by a displacement.  A loop is the blocks from a
+ * block branched back to up to the block branching back,
+ * which are only entered at the top; the pointers are set
+ * in a block made in front of them.  Outer loops come
+ * first, so an index stepped in an inner loop too gets a
+ * single pointer, stepped there as well.  The pointers
+ * are set and stepped by IR_ADDU, as one may well point
+ * past the array on the iterations not accessing it.  At
+ * most REDUCE_MAX_POINTERS pointers are made for a loop,
+ * as each wants a register of its own.
+ */
+#define REDUCE_MAX_POINTERS 4
+#define REDUCE_MAX_STEP (1 << 20)
+
+struct Pointer {
+  int array, index; /* variables */
+  int var;
+};
+
+struct Reduction {
+  IrFunction *fn;
+  int start, end;  /* positions of the loop */
+  char *indexes;   /* by variable: 0 not set in the loop,
+                      1 stepped by constants, 2 set otherwise */
+  struct Pointer pointers[REDUCE_MAX_POINTERS];
+  int nPointers;
+};
+
+/* addsConstant tells whether instr computes var plus or
+ * minus a constant, putting what it adds in *step */
+static int addsConstant(IrInstr const *instr, Operand var, int *step) {
+  Operand c;
+
+  if(instr->op == IR_ADD && sameOperand(instr->a, var)) c = instr->b;
+  else if(instr->op == IR_ADD && sameOperand(instr->b, var)) c = instr->a;
+  else if(instr->op == IR_SUB && sameOperand(instr->a, var)) c = instr->b;
+  else return FALSE;
+  if(c.kind != OPD_CONST || c.val <= -REDUCE_MAX_STEP || c.val >= REDUCE_MAX_STEP) return FALSE;
+  *step = instr->op == IR_SUB ? -c.val : c.val;
+  return TRUE;
+}
+
+/* definition returns the position of the instruction
+ * before position k defining the temporary opd, or -1 */
+static int definition(IrBlock *block, int k, Operand opd) {
+  if(opd.kind != OPD_TEMP) return -1;
+  while(k-- > 0) {
+    if(sameOperand(block->instrs[k].dst, opd)) return k;
+  }
+  return -1;
+}
+
+/* matchElement tells whether the instruction at position
+ * k adds the address of an array to an index shifted to
+ * words, filling in the array, the index variable and the
+ * constant added to it */
+static int matchElement(struct Reduction *red, IrBlock *block, int k,
+                        int *array, int *index, int *offset) {
+  IrInstr *instr = &block->instrs[k];
+  IrInstr *base, *shift, *sum;
+  int j, from;
+
+  if(instr->op != IR_ADD) return FALSE;
+  j = definition(block, k, instr->a);
+  if(j < 0 || block->instrs[j].op != IR_ADDR) return FALSE;
+  base = &block->instrs[j];
+  j = definition(block, k, instr->b);
+  if(j < 0 || block->instrs[j].op != IR_SLL || !sameOperand(block->instrs[j].b, constOperand(2))) {
+    return FALSE;
+  }
+  shift = &block->instrs[j];
+  from = j;
+
+  *offset = 0;
+  if(shift->a.kind == OPD_TEMP) {
+    from = definition(block, j, shift->a);
+    if(from < 0) return FALSE;
+    sum = &block->instrs[from];
+    *index = sum->a.kind == OPD_VAR ? sum->a.val : sum->b.val;
+    if(!addsConstant(sum, varOperand(*index), offset)) return FALSE;
+  }
+  else if(shift->a.kind == OPD_VAR) *index = shift->a.val;
+  else return FALSE;
+
+  *array = base->a.val;
+  if(red->indexes[*array] != 0 || red->indexes[*index] == 2) return FALSE;
+  if(red->fn->vars[*index].global || red->fn->vars[*index].array) return FALSE;
+  // the index must hold the same value where it is shifted
+  for(j = from + 1; j < k; ++j) {
+    if(sameOperand(block->instrs[j].dst, varOperand(*index))) return FALSE;
+  }
+  return TRUE;
+}
+
+/* pointerFor returns the pointer to the elements of array
+ * indexed by index, making it if there is room, or -1 */
+static int pointerFor(CompileContext *ctx, struct Reduction *red, int array, int index) {
+  struct Pointer *ptr;
+  int p;
+
+  for(p = 0; p < red->nPointers; ++p) {
+    ptr = &red->pointers[p];
+    if(ptr->array == array && ptr->index == index) return ptr->var;
+  }
+  if(red->nPointers == REDUCE_MAX_POINTERS) return -1;
+  ptr = &red->pointers[red->nPointers++];
+  ptr->array = array;
+  ptr->index = index;
+  ptr->var = newVar(ctx, red->fn, NULL, NULL);
+  return ptr->var;
+}
+
+/* insertInstr puts an instruction at position k of a block */
+static void insertInstr(CompileContext *ctx, IrBlock *block, int k, int op,
+                        Operand dst, Operand a, Operand b) {
+  IrInstr instr = *appendInstr(ctx, block, op, dst, a, b);
+  memmove(&block->instrs[k + 1], &block->instrs[k], (block->nInstrs - 1 - k) * sizeof(IrInstr));
+  block->instrs[k] = instr;
+}
+
+/* enteredAtTop tells whether the blocks of the loop are
+ * only entered at its first block, and from outside too */
+static int enteredAtTop(IrFunction *fn, int start, int end) {
+  IrBlock *head = fn->blocks[start];
+  int i, j, s, entered = FALSE;
+
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    int nSucc = block->term == TERM_BRANCH ? 2 : block->term == TERM_JUMP;
+    if(i >= start && i <= end) continue;
+    for(s = 0; s < nSucc; ++s) {
+      if(block->succ[s] == head) entered = TRUE;
+      for(j = start + 1; j <= end; ++j) {
+        if(block->succ[s] == fn->blocks[j]) return FALSE;
+      }
+    }
+  }
+  return entered;
+}
+
+/* reduceLoop reduces the loop of red, returning whether
+ * it made a block in front of it */
+static int reduceLoop(CompileContext *ctx, struct Reduction *red) {
+  IrFunction *fn = red->fn;
+  IrBlock *head = fn->blocks[red->start], *pre;
+  int i, j, p, step, array, index, offset, var;
+
+  red->indexes = irAlloc(ctx, fn->nVars, sizeof(char));
+  red->nPointers = 0;
+  for(i = red->start; i <= red->end; ++i) {
+    IrBlock *block = fn->blocks[i];
+    for(j = 0; j < block->nInstrs; ++j) {
+      IrInstr *instr = &block->instrs[j];
+      if(instr->dst.kind != OPD_VAR) continue;
+      if(red->indexes[instr->dst.val] < 2 && addsConstant(instr, instr->dst, &step)) {
+        red->indexes[instr->dst.val] = 1;
+      }
+      else red->indexes[instr->dst.val] = 2;
+    }
+  }
+
+  for(i = red->start; i <= red->end; ++i) {
+    IrBlock *block = fn->blocks[i];
+    for(j = 0; j < block->nInstrs; ++j) {
+      IrInstr *instr = &block->instrs[j];
+      if(!matchElement(red, block, j, &array, &index, &offset)) continue;
+      var = pointerFor(ctx, red, array, index);
+      if(var < 0) continue;
+      // the address and the shift are left to dead code elimination
+      if(offset == 0) {
+        instr->op = IR_MOVE;
+        instr->a = varOperand(var);
+        instr->b = noOperand();
+      }
+      else {
+        instr->op = IR_ADDU;
+        instr->a = varOperand(var);
+        instr->b = constOperand(offset * 4);
+      }
+    }
+  }
+  if(red->nPointers == 0) return FALSE;
+
+  // every step of an index steps its pointers
+  for(i = red->start; i <= red->end; ++i) {
+    IrBlock *block = fn->blocks[i];
+    for(j = 0; j < block->nInstrs; ++j) {
+      IrInstr *instr = &block->instrs[j];
+      if(instr->dst.kind != OPD_VAR || red->indexes[instr->dst.val] != 1) continue;
+      index = instr->dst.val;
+      addsConstant(instr, instr->dst, &step);
+      for(p = 0; p < red->nPointers; ++p) {
+        if(red->pointers[p].index != index) continue;
+        var = red->pointers[p].var;
+        insertInstr(ctx, block, ++j, IR_ADDU, varOperand(var), varOperand(var), constOperand(step * 4));
+      }
+    }
+  }
+
+  pre = newIrBlock(ctx, fn);
+  pre->loopDepth = head->loopDepth > 0 ? head->loopDepth - 1 : 0;
+  pre->succ[0] = head;
+  for(p = 0; p < red->nPointers; ++p) {
+    struct Pointer *ptr = &red->pointers[p];
+    Operand base = tempOperand(newTemp(fn)), shift = tempOperand(newTemp(fn));
+    appendInstr(ctx, pre, IR_ADDR, base, varOperand(ptr->array), noOperand());
+    appendInstr(ctx, pre, IR_SLL, shift, varOperand(ptr->index), constOperand(2));
+    appendInstr(ctx, pre, IR_ADDU, varOperand(ptr->var), base, shift);
+  }
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i];
+    int s, nSucc = block->term == TERM_BRANCH ? 2 : block->term == TERM_JUMP;
+    if(i >= red->start && i <= red->end) continue;
+    for(s = 0; s < nSucc; ++s) {
+      if(block->succ[s] == head) block->succ[s] = pre;
+    }
+  }
+  placeIrBlock(ctx, fn, pre);
+  memmove(&fn->blocks[red->start + 1], &fn->blocks[red->start],
+          (fn->nBlocks - 1 - red->start) * sizeof(IrBlock *));
+  fn->blocks[red->start] = pre;
+  return TRUE;
+}
+
+static void reduceStrength(CompileContext *ctx, IrFunction *fn) {
+  struct Reduction red;
+  int *pos = irAlloc(ctx, fn->nextBlockId, sizeof(int));
+  int i, k, s;
+
+  red.fn = fn;
+  for(i = 0; i < fn->nBlocks; ++i) pos[fn->blocks[i]->id] = i;
+
+  for(i = fn->nBlocks; i-- > 0; ) {
+    IrBlock *latch = fn->blocks[i];
+    int nSucc = latch->term == TERM_BRANCH ? 2 : latch->term == TERM_JUMP;
+    for(s = 0; s < nSucc; ++s) {
+      red.start = pos[latch->succ[s]->id];
+      red.end = i;
+      // a branch backwards closes a loop
+      if(red.start > i || red.start == 0 || !enteredAtTop(fn, red.start, i)) continue;
+      if(!reduceLoop(ctx, &red)) continue;
+
+      // the loops inside moved down by the block made in front
+      pos = irAlloc(ctx, fn->nextBlockId, sizeof(int));
+      for(k = 0; k < fn->nBlocks; ++k) pos[fn->blocks[k]->id] = k;
+      ++i;
+      break;
+    }
+  }
+}
+
+/* Block layout moves the arms of the branches predicted
+ * not to be taken to the end of the function, so the likely
+ * path falls through.  An arm is a successor with no other
+ * predecessor, along with the blocks after it entered only
+ * from the arm.  The predictions are the usual static ones:
+ * a branch rather skips a block returning from the
+ * function when its other successor does not, and an
+ * equality or a negative value is rarely what is tested
+ * for.  An arm is not moved behind a block returning from
+ * the function, which would need a jump to the exit then,
+ * unless the branch is in a deeper loop.
+ */
+static int coldSuccessor(IrBlock *block) {
+  int returns0 = block->succ[0]->term == TERM_RETURN;
+  int returns1 = block->succ[1]->term == TERM_RETURN;
+
+  if(returns0 != returns1) return returns0 ? 0 : 1;
+  switch(block->cmp) {
+  case IR_SEQ: return 0;
+  case IR_SNE: return 1;
+  case IR_SLT: return sameOperand(block->b, constOperand(0)) ? 0 : -1;
+  case IR_SGE: return sameOperand(block->b, constOperand(0)) ? 1 : -1;
+  default: return -1;
+  }
+}
+
+/* armEnd returns the position after the arm starting at
+ * position start */
+static int armEnd(IrFunction *fn, int start, int const *preds, int *inside) {
+  int end, k, s;
+
+  for(end = start + 1; end < fn->nBlocks; ++end) {
+    IrBlock *next = fn->blocks[end];
+    int edges = 0;
+    for(k = start; k < end; ++k) {
+      IrBlock *block = fn->blocks[k];
+      int nSucc = block->term == TERM_BRANCH ? 2 : block->term == TERM_JUMP;
+      for(s = 0; s < nSucc; ++s) {
+        if(block->succ[s] == next) ++edges;
+      }
+    }
+    if(edges < preds[next->id]) break;
+  }
+  *inside = end - start;
+  return end;
+}
+
+static void layoutBlocks(CompileContext *ctx, IrFunction *fn) {
+  int *preds = irAlloc(ctx, fn->nextBlockId, sizeof(int));
+  char *moved = irAlloc(ctx, fn->nextBlockId, sizeof(char));
+  IrBlock **arm = irAlloc(ctx, fn->nBlocks, sizeof(IrBlock *));
+  int i, k, start, end, n;
+
+  countPreds(fn, preds);
+  for(i = 0; i < fn->nBlocks; ++i) {
+    IrBlock *block = fn->blocks[i], *cold, *last;
+    int s;
+    if(block->term != TERM_BRANCH || moved[block->id]) continue;
+    s = coldSuccessor(block);
+    if(s < 0) continue;
+    cold = block->succ[s];
+    if(cold == block->succ[!s] || preds[cold->id] != 1 || moved[cold->id]) continue;
+    // the block returning last would then need a jump to the exit
+    last = fn->blocks[fn->nBlocks - 1];
+    if(last->term == TERM_RETURN && block->loopDepth <= last->loopDepth) continue;
+
+    for(start = i + 1; start < fn->nBlocks && fn->blocks[start] != cold; ++start) ;
+    if(start == fn->nBlocks) continue;
+    end = armEnd(fn, start, preds, &n);
+    if(end == fn->nBlocks) continue;
+
+    memcpy(arm, &fn->blocks[start], n * sizeof(IrBlock *));
+    memmove(&fn->blocks[start], &fn->blocks[end], (fn->nBlocks - end) * sizeof(IrBlock *));
+    memcpy(&fn->blocks[fn->nBlocks - n], arm, n * sizeof(IrBlock *));
+    for(k = 0; k < n; ++k) moved[arm[k]->id] = TRUE;
+  }
+}
+
+static struct IrPass const passes[] = {
+  { "rotate-loops", 2, rotateLoops },
+  { "simplify-cfg", 1, simplifyCfg },
+  { "propagate-constants", 1, propagateConstants },
+  { "simplify-cfg", 1, simplifyCfg },
+  { "reduce-strength", 2, reduceStrength },
+  { "propagate-constants", 2, propagateConstants },
+  { "fuse-branches", 1, fuseBranches },
+  { "dead-code", 1, removeDeadCode },
+  { "layout-blocks", 2, layoutBlocks }
+};
+
+void optimizeFunction(CompileContext *ctx, IrFunction *fn) {
+  int i;
+  char title[64];
+
+  for(i = 0; i < (int)(sizeof passes / sizeof passes[0]); ++i) {
+    if(ctx->optLevel < passes[i].level) continue;
+    passes[i].run(ctx, fn);
+    if(TRACING(ctx, DumpIR)) {
+      snprintf(title, sizeof title, "after %s", passes[i].name);
+      printIrFunction(ctx, fn, title);
+    }
+  }
+}
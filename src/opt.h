@@ -0,0 +1,12 @@
+#ifndef _OPT_H_
+#define _OPT_H_
+
+#include "ir.h"
+
+/* procedure optimizeFunction runs the passes enabled at
+ * ctx->optLevel over a function, in order; with DumpIR
+ * the function is printed after every pass that ran
+ */
+void optimizeFunction(CompileContext *ctx, IrFunction *fn);
+
+#endif
@@ -1,6 +1,6 @@
 #ifndef _PARSE_H_
 #define _PARSE_H_
 
-TreeNode *parse(void);
+TreeNode *parse(CompileContext *ctx);
 
 #endif
\ No newline at end of file
@@ -1,16 +1,52 @@
 #ifndef _SCAN_H_
 #define _SCAN_H_
 
-/* MAXTOKENLEN is the maximum size of a token */
-#define MAXTOKENLEN 40
+#include "source.h"
 
-/* tokenString array stores the lexeme of each token */
-extern char tokenString[MAXTOKENLEN+1];
+/* TokenSlice locates the lexeme of a token inside
+ * the scanned source text instead of copying it
+ */
+typedef struct {
+  long offset;
+  int length;
+} TokenSlice;
+
+/* ScanState is the scanner part of a CompileContext */
+struct ScanState {
+  void *scanner; /* the reentrant flex scanner */
+  void *buffer; /* flex buffer over the source text */
+
+  /* sourceText points at the text being scanned */
+  char const *sourceText;
+
+  /* tokenSlice locates the lexeme of the current token */
+  TokenSlice tokenSlice;
+
+  /* lastToken is the token most recently handed to the parser */
+  TokenType lastToken;
+
+  int errorType;
+};
+
+/* SLICE_TEXT yields the first character of a lexeme;
+ * the lexeme is not NUL-terminated, print it with "%.*s"
+ */
+#define SLICE_TEXT(ctx, s) ((ctx)->scan->sourceText + (s).offset)
+
+/* procedure scanSourceText makes the scanner
+ * read the given text in place
+ */
+void scanSourceText(CompileContext *ctx, SourceText *text);
+
+/* procedure closeScanner releases the scanner buffers */
+void closeScanner(CompileContext *ctx);
+
+union YYSTYPE;
 
 /* function getToken returns the 
  * next token in source file
  */
-TokenType getToken(void);
+TokenType getToken(CompileContext *ctx, union YYSTYPE *lval);
 char const *getTokenName(TokenType type);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,181 @@
+#include "globals.h"
+#include "server.h"
+#include "compile.h"
+#include "atom.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+/* a session starts over once it has interned this many atoms */
+#define MAX_SESSION_ATOMS (1u << 18)
+
+/* name used for the code of a SOURCE request */
+#define BUFFER_CODEFILE "buffer.tm"
+
+/* readPayload reads exactly size bytes followed by two NUL
+ * bytes of padding, as the scanner expects
+ */
+static char *readPayload(FILE *in, size_t size) {
+  char *buf = malloc(size + 2);
+  if (buf == NULL) return NULL;
+  if (fread(buf, 1, size, in) != size) {
+    free(buf);
+    return NULL;
+  }
+  buf[size] = buf[size + 1] = '\0';
+  return buf;
+}
+
+static void writeReply(FILE *out, CompileStatus status,
+                       char const *code, size_t codeSize,
+                       char const *listing, size_t listingSize) {
+  fprintf(out, "RESULT %d %zu %zu\n", status, codeSize, listingSize);
+  fwrite(code, 1, codeSize, out);
+  fwrite(listing, 1, listingSize, out);
+  fflush(out);
+}
+
+int serveStream(FILE *in, FILE *out, CompileOptions const *options) {
+  CompileContext ctx;
+  char *line = NULL;
+  size_t lineCap = 0;
+  int result = 0;
+
+  if (initCompileContext(&ctx, NULL) != 0) return -1;
+  applyCompileOptions(&ctx, options);
+
+  while (getline(&line, &lineCap, in) >= 0) {
+    char kind[16];
+    size_t size;
+    char *payload;
+    char *code = NULL, *listing = NULL;
+    size_t codeSize = 0, listingSize = 0;
+    FILE *codeStream, *listingStream;
+    CompileStatus status;
+
+    if (strcmp(line, "QUIT\n") == 0) break;
+    if (sscanf(line, "%15s %zu", kind, &size) != 2 ||
+        (strcmp(kind, "PATH") != 0 && strcmp(kind, "SOURCE") != 0) ||
+        (payload = readPayload(in, size)) == NULL) {
+      result = -1;
+      break;
+    }
+
+    if (atomCount(&ctx) > MAX_SESSION_ATOMS) {
+      destroyCompileContext(&ctx);
+      if (initCompileContext(&ctx, NULL) != 0) {
+        free(payload);
+        result = -1;
+        break;
+      }
+      applyCompileOptions(&ctx, options);
+    }
+
+    codeStream = open_memstream(&code, &codeSize);
+    listingStream = open_memstream(&listing, &listingSize);
+    if (codeStream == NULL || listingStream == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+    resetCompileContext(&ctx, listingStream);
+    ctx.code = codeStream;
+
+    if (strcmp(kind, "PATH") == 0) {
+      status = compileSource(&ctx, payload, listingStream);
+    }
+    else {
+      SourceText text;
+      text.base = payload;
+      text.size = size;
+      text.mapSize = 0;
+      status = compile(&ctx, &text, BUFFER_CODEFILE);
+    }
+    /* the source text goes away with the payload */
+    resetCompileContext(&ctx, NULL);
+    free(payload);
+
+    fclose(codeStream);
+    fclose(listingStream);
+    writeReply(out, status, code, status == COMPILE_OK ? codeSize : 0,
+               listing, listingSize);
+    free(code);
+    free(listing);
+  }
+
+  free(line);
+  destroyCompileContext(&ctx);
+  return result;
+}
+
+/* the options of every connection of serveSocket */
+static CompileOptions const *socketOptions;
+
+static void *serveConnection(void *arg) {
+  int fd = (int)(long)arg;
+  FILE *in = fdopen(fd, "r");
+  FILE *out = fdopen(dup(fd), "w");
+
+  if (in != NULL && out != NULL) serveStream(in, out, socketOptions);
+  if (in != NULL) fclose(in);
+  else close(fd);
+  if (out != NULL) fclose(out);
+  return NULL;
+}
+
+int serveSocket(char const *path, CompileOptions const *options) {
+  struct sockaddr_un addr;
+  struct stat st;
+  int fd;
+
+  socketOptions = options;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path %s is too long\n", path);
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  /* a socket left by an earlier server is replaced, anything
+     else at the path is left alone */
+  if (lstat(path, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      fprintf(stderr, "%s exists and is not a socket\n", path);
+      return -1;
+    }
+    if (unlink(path) != 0) {
+      perror(path);
+      return -1;
+    }
+  }
+
+  /* a client that goes away must not take the server down */
+  signal(SIGPIPE, SIG_IGN);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket");
+    return -1;
+  }
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, 64) != 0) {
+    perror(path);
+    close(fd);
+    return -1;
+  }
+
+  for (;;) {
+    pthread_t thread;
+    int client = accept(fd, NULL, NULL);
+    if (client < 0) continue;
+    if (pthread_create(&thread, NULL, serveConnection, (void *)(long)client) != 0) {
+      close(client);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+}
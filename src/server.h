@@ -0,0 +1,41 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+/* The compile server answers compile requests over a
+ * byte stream, keeping one warm CompileContext per
+ * stream.  Every message is a header line followed by
+ * the number of payload bytes the header announces.
+ *
+ * Requests:
+ *   PATH <n>\n    <n bytes: path of a source file>
+ *   SOURCE <n>\n  <n bytes: source text>
+ *   QUIT\n
+ *
+ * Each PATH or SOURCE request gets one reply:
+ *   RESULT <status> <m> <k>\n  <m bytes: code> <k bytes: listing>
+ *
+ * status is a CompileStatus (see compile.h); the code is
+ * empty unless the compilation succeeded.  No file is
+ * written, the code is returned in the reply.  Every
+ * compilation runs with the options given, which may be
+ * NULL; requests are answered from their cache if any.
+ */
+
+struct CompileOptions;
+
+/* Function serveStream answers requests read from in on
+ * out until QUIT or end of input.
+ * Returns 0, or -1 on a malformed request.
+ */
+int serveStream(FILE *in, FILE *out, struct CompileOptions const *options);
+
+/* Function serveSocket listens on a Unix domain socket at
+ * path and serves every connection on its own thread.
+ * A socket already at path is replaced; any other file
+ * there is an error.
+ * Returns -1 if the socket cannot be set up; otherwise
+ * it does not return.
+ */
+int serveSocket(char const *path, struct CompileOptions const *options);
+
+#endif
@@ -0,0 +1,100 @@
+#include "globals.h"
+#include "sha256.h"
+
+static uint32_t const K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void compress(uint32_t state[8], unsigned char const *block) {
+  uint32_t w[64], a, b, c, d, e, f, g, h;
+  int i;
+
+  for(i = 0; i < 16; ++i) {
+    w[i] = (uint32_t)block[4*i] << 24 | (uint32_t)block[4*i+1] << 16 |
+           (uint32_t)block[4*i+2] << 8 | (uint32_t)block[4*i+3];
+  }
+  for(i = 16; i < 64; ++i) {
+    uint32_t s0 = ROTR(w[i-15], 7) ^ ROTR(w[i-15], 18) ^ (w[i-15] >> 3);
+    uint32_t s1 = ROTR(w[i-2], 17) ^ ROTR(w[i-2], 19) ^ (w[i-2] >> 10);
+    w[i] = w[i-16] + s0 + w[i-7] + s1;
+  }
+
+  a = state[0]; b = state[1]; c = state[2]; d = state[3];
+  e = state[4]; f = state[5]; g = state[6]; h = state[7];
+  for(i = 0; i < 64; ++i) {
+    uint32_t s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+    uint32_t ch = (e & f) ^ (~e & g);
+    uint32_t t1 = h + s1 + ch + K[i] + w[i];
+    uint32_t s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+    uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+    uint32_t t2 = s0 + maj;
+    h = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+  state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void sha256Init(Sha256 *sha) {
+  static uint32_t const H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+  memcpy(sha->state, H0, sizeof(H0));
+  sha->length = 0;
+  sha->used = 0;
+}
+
+void sha256Update(Sha256 *sha, void const *data, size_t size) {
+  unsigned char const *p = data;
+  sha->length += size;
+
+  if(sha->used > 0) {
+    size_t n = 64 - sha->used < size ? 64 - sha->used : size;
+    memcpy(sha->block + sha->used, p, n);
+    sha->used += n;
+    p += n;
+    size -= n;
+    if(sha->used < 64) return;
+    compress(sha->state, sha->block);
+    sha->used = 0;
+  }
+  while(size >= 64) {
+    compress(sha->state, p);
+    p += 64;
+    size -= 64;
+  }
+  memcpy(sha->block, p, size);
+  sha->used = size;
+}
+
+void sha256Final(Sha256 *sha, unsigned char digest[SHA256_DIGEST_SIZE]) {
+  uint64_t bits = sha->length * 8;
+  int i;
+
+  sha->block[sha->used++] = 0x80;
+  if(sha->used > 56) {
+    memset(sha->block + sha->used, 0, 64 - sha->used);
+    compress(sha->state, sha->block);
+    sha->used = 0;
+  }
+  memset(sha->block + sha->used, 0, 56 - sha->used);
+  for(i = 0; i < 8; ++i) sha->block[56 + i] = (unsigned char)(bits >> (56 - 8*i));
+  compress(sha->state, sha->block);
+
+  for(i = 0; i < 8; ++i) {
+    digest[4*i] = (unsigned char)(sha->state[i] >> 24);
+    digest[4*i+1] = (unsigned char)(sha->state[i] >> 16);
+    digest[4*i+2] = (unsigned char)(sha->state[i] >> 8);
+    digest[4*i+3] = (unsigned char)sha->state[i];
+  }
+}
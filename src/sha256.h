@@ -0,0 +1,21 @@
+#ifndef _SHA256_H_
+#define _SHA256_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_SIZE 32
+
+/* SHA-256 as specified in FIPS 180-4 */
+typedef struct {
+  uint32_t state[8];
+  uint64_t length; /* bytes hashed so far */
+  unsigned char block[64];
+  size_t used; /* bytes waiting in block */
+} Sha256;
+
+void sha256Init(Sha256 *sha);
+void sha256Update(Sha256 *sha, void const *data, size_t size);
+void sha256Final(Sha256 *sha, unsigned char digest[SHA256_DIGEST_SIZE]);
+
+#endif
@@ -0,0 +1,74 @@
+#include "globals.h"
+#include "source.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* flex requires two end-of-buffer characters after the text */
+#define PADDING 2
+
+static int readSourceText(FILE *fp, SourceText *text) {
+  size_t capacity = 4096, size = 0, n;
+  char *buf = malloc(capacity + PADDING);
+  if(buf == NULL) return -1;
+
+  while((n = fread(buf + size, 1, capacity - size, fp)) > 0) {
+    size += n;
+    if(size == capacity) {
+      char *grown = realloc(buf, capacity * 2 + PADDING);
+      if(grown == NULL) {
+        free(buf);
+        return -1;
+      }
+      buf = grown;
+      capacity *= 2;
+    }
+  }
+  memset(buf + size, 0, PADDING);
+
+  text->base = buf;
+  text->size = size;
+  text->mapSize = 0;
+  return 0;
+}
+
+int openSourceText(FILE *fp, SourceText *text) {
+  struct stat st;
+  int fd = fileno(fp);
+
+  if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    return readSourceText(fp, text);
+  }
+
+  size_t size = st.st_size;
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  size_t mapSize = (size + PADDING + pageSize - 1) / pageSize * pageSize;
+
+  /* reserve zeroed pages for the text plus its padding,
+   * then map the file over the front of the reservation.
+   * Pages are private so the scanner may write its
+   * temporary NUL terminators into the text. */
+  char *base = mmap(NULL, mapSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(base == MAP_FAILED) return readSourceText(fp, text);
+
+  if(mmap(base, size, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap(base, mapSize);
+    return readSourceText(fp, text);
+  }
+  madvise(base, mapSize, MADV_SEQUENTIAL);
+
+  text->base = base;
+  text->size = size;
+  text->mapSize = mapSize;
+  return 0;
+}
+
+void closeSourceText(SourceText *text) {
+  if(text->base == NULL) return;
+  if(text->mapSize > 0) munmap(text->base, text->mapSize);
+  else free(text->base);
+  text->base = NULL;
+}
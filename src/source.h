@@ -0,0 +1,25 @@
+#ifndef _SOURCE_H_
+#define _SOURCE_H_
+
+#include <stddef.h>
+
+/* SourceText holds the whole source program in memory.
+ * The text is followed by two NUL bytes so that the
+ * scanner can work on it in place.
+ */
+typedef struct {
+  char *base;
+  size_t size;      /* length of the text, padding excluded */
+  size_t mapSize;   /* length of the mapping, 0 if read into the heap */
+} SourceText;
+
+/* Function openSourceText maps the file behind fp into
+ * memory, falling back to reading it when the file
+ * cannot be mapped (pipes, empty files).
+ * Returns 0 on success, -1 on failure.
+ */
+int openSourceText(FILE *fp, SourceText *text);
+
+void closeSourceText(SourceText *text);
+
+#endif
@@ -1,62 +1,84 @@
 #include "globals.h"
 #include "symtab.h"
 #include "util.h"
+#include "atom.h"
+#include "arena.h"
 
-/* the number of BucketList in a hash table */
-#define SIZE 211
+/* initial number of slots in a symbol table, a power of two */
+#define INITIAL_SLOTS 8
 
-/* the power of two used as multiplier in hash function */
-#define SHIFT 7
+/* listings print symbols in the order of the former
+ * 211-bucket chained table, so they stay comparable */
+#define LISTING_BUCKETS 211
 
 enum _SymDecl {
   VARIABLE, PARAMETER, FUNCTION
 };
 
-typedef struct LineListRec {
-  int lineno;
-  struct LineListRec *next;
+/* number of line numbers in a chunk, filling 64 bytes */
+#define LINE_CHUNK 13
+
+/* The lines referring to a symbol are kept in a list of
+ * fixed-size chunks; the symbol points at the last chunk,
+ * so a line is appended without walking the list.
+ */
+typedef struct LineChunkRec {
+  struct LineChunkRec *next;
+  int count;
+  int lineno[LINE_CHUNK];
 } *LineList;
 
 struct SymbolRec {
   TreeNode *tnode;
-  LineList lineList;
+  LineList lineList; /* lines after the declaration */
+  LineList lastLines;
+  int seq; /* insertion order within its table */
 };
 
-struct BucketListRec {
+/* a slot is empty when name is NULL */
+struct SlotRec {
+  unsigned hash;
+  char const *name;
   struct SymbolRec *sym;
-  struct BucketListRec *next;
 };
 
-static unsigned hash_digest(unsigned char const *key) {
-  unsigned temp = 0;
-  while(*key) {
-    temp = ((temp << SHIFT) + *key) % SIZE;
-    ++key;
-  }
-  return temp;
-}
+/* Slots are probed linearly with Robin Hood displacement:
+ * an entry never sits further from its home slot than the
+ * entry it passed, so a lookup stops at the first entry
+ * closer to home than the probe.  The table doubles when
+ * it gets three quarters full.
+ */
+struct SymtabRec {
+  struct SlotRec *slots;
+  unsigned mask; /* number of slots - 1 */
+  unsigned count;
+};
+
+/* symbol tables, symbols and line lists are allocated from
+ * the compilation arena and released together with the syntax tree */
 
-BucketList *constructSymtab() {
-  BucketList *bucketList = calloc(SIZE, sizeof(BucketList));
-  // all fields in bucketList[i] are defaulted to null
-  return bucketList;
+static struct SlotRec *allocSlots(Arena arena, unsigned n) {
+  struct SlotRec *slots = arenaCalloc(arena, n, sizeof(struct SlotRec));
+  if(slots == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  return slots;
 }
 
-void destroySymtab(BucketList *symtab) {
-  int i;
-  for(i=0; i<SIZE; ++i) {
-    BucketList p = symtab[i], pn;
-    while(p) {
-      pn = p->next;
-      deleteSymbol(p->sym);
-      free(p);
-      p = pn;
-    }
+Symtab constructSymtab(Arena arena) {
+  Symtab symtab = arenaAlloc(arena, sizeof(struct SymtabRec));
+  if(symtab == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
   }
-  free(symtab);
+  symtab->slots = allocSlots(arena, INITIAL_SLOTS);
+  symtab->mask = INITIAL_SLOTS - 1;
+  symtab->count = 0;
+  return symtab;
 }
 
-struct SymbolRec *newSymbol(TreeNode *tnode, int loc) {
+struct SymbolRec *newSymbol(Arena arena, TreeNode *tnode, int loc) {
   enum _SymDecl decl;
   if(tnode->nodekind == ParamK) {
     decl = PARAMETER;
@@ -66,29 +88,33 @@ struct SymbolRec *newSymbol(TreeNode *tnode, int loc) {
   }
   else return NULL;
 
-  struct SymbolRec *sym = malloc(sizeof(struct SymbolRec));
+  struct SymbolRec *sym = arenaAlloc(arena, sizeof(struct SymbolRec));
   sym->tnode = tnode;
   sym->tnode->loc = loc;
-  sym->lineList = calloc(1, sizeof(struct LineListRec));
-  sym->lineList->lineno = tnode->lineno;
+  sym->lineList = sym->lastLines = NULL;
   return sym;
 }
 
-void deleteSymbol(struct SymbolRec *sym) {
-  LineList plist = sym->lineList, pnlist;
-  while(plist) {
-    pnlist = plist->next;
-    free(plist);
-    plist = pnlist;
-  }
-  free(sym);
-}
+void addLineno(Arena arena, struct SymbolRec *symbolRec, int lineno) {
+  LineList last = symbolRec->lastLines;
 
-void addLineno(struct SymbolRec *symbolRec, int lineno) {
-  LineList plist = symbolRec->lineList;
-  while(plist->next != NULL) plist = plist->next;
-  plist->next = calloc(1, sizeof(struct LineListRec));
-  plist->next->lineno = lineno;
+  // a line is listed once however often it refers to the symbol
+  if(last != NULL ? last->lineno[last->count - 1] == lineno
+                  : symbolRec->tnode->lineno == lineno) return;
+
+  if(last == NULL || last->count == LINE_CHUNK) {
+    LineList chunk = arenaAlloc(arena, sizeof(struct LineChunkRec));
+    if(chunk == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+    chunk->next = NULL;
+    chunk->count = 0;
+    if(last == NULL) symbolRec->lineList = chunk;
+    else last->next = chunk;
+    symbolRec->lastLines = last = chunk;
+  }
+  last->lineno[last->count++] = lineno;
 }
 
 int getDeclLineno(struct SymbolRec *symbolRec) {
@@ -103,86 +129,141 @@ TreeNode *getTreeNode(struct SymbolRec *symbolRec) {
   return symbolRec->tnode;
 }
 
-void st_insert(BucketList *symtab, struct SymbolRec *symbolRec) {
-  BucketList p = malloc(sizeof(struct BucketListRec));
-  int h = hash_digest(symbolRec->tnode->attr.name);
+/* distance of a slot from the home slot of its entry */
+static unsigned probeDistance(Symtab symtab, unsigned i) {
+  return (i - symtab->slots[i].hash) & symtab->mask;
+}
+
+static void placeSlot(Symtab symtab, struct SlotRec entry) {
+  unsigned i = entry.hash & symtab->mask;
+  unsigned dist = 0;
+  while(symtab->slots[i].name != NULL) {
+    unsigned d = probeDistance(symtab, i);
+    if(d < dist) {
+      // take the place of the entry closer to home and move it on
+      struct SlotRec t = symtab->slots[i];
+      symtab->slots[i] = entry;
+      entry = t;
+      dist = d;
+    }
+    i = (i + 1) & symtab->mask;
+    ++dist;
+  }
+  symtab->slots[i] = entry;
+}
+
+static void growSymtab(Arena arena, Symtab symtab) {
+  struct SlotRec *old = symtab->slots;
+  unsigned n = symtab->mask + 1;
+  unsigned i;
+
+  // the old slots stay behind in the arena until the compilation ends
+  symtab->slots = allocSlots(arena, 2 * n);
+  symtab->mask = 2 * n - 1;
+  for(i = 0; i < n; ++i) {
+    if(old[i].name != NULL) placeSlot(symtab, old[i]);
+  }
+}
+
+void st_insert(Arena arena, Symtab symtab, struct SymbolRec *symbolRec) {
+  struct SlotRec entry;
 
-  p->sym = symbolRec;
-  p->next = symtab[h];
-  symtab[h] = p;
+  if(4 * (symtab->count + 1) > 3 * (symtab->mask + 1)) growSymtab(arena, symtab);
+
+  entry.name = symbolRec->tnode->attr.name;
+  entry.hash = atomHash(entry.name);
+  entry.sym = symbolRec;
+  symbolRec->seq = symtab->count++;
+  placeSlot(symtab, entry);
 }
 
-// returns memory loc
-struct SymbolRec *st_lookup(BucketList *symtab, char const *name) {
-  int h = hash_digest(name);
-  BucketList p = symtab[h];
-  while(p != NULL) {
-    TreeNode* tnode = p->sym->tnode;
-    if(strcmp(name, tnode->attr.name) == 0) return p->sym;
-    p = p->next;
+// name must be interned; symbols are matched by atom identity
+// symtab may be NULL for a scope that declares nothing
+struct SymbolRec *st_lookup(Symtab symtab, char const *name) {
+  if(symtab == NULL) return NULL;
+  unsigned hash = atomHash(name);
+  unsigned i = hash & symtab->mask;
+  unsigned dist = 0;
+  while(symtab->slots[i].name != NULL && probeDistance(symtab, i) >= dist) {
+    if(symtab->slots[i].name == name) return symtab->slots[i].sym;
+    i = (i + 1) & symtab->mask;
+    ++dist;
   }
   return NULL;
 }
 
-static void printLineList(FILE *out, LineList lineList) {
-  int last_lineno = -1;
-  while(lineList != NULL) {
-    if(last_lineno != lineList->lineno) {
-      fprintf(out, "%-8d", lineList->lineno);
-      last_lineno = lineList->lineno;
-    }
-    lineList = lineList->next;
+static void printLineList(FILE *out, struct SymbolRec *sym) {
+  LineList chunk;
+  int i;
+  fprintf(out, "%-8d", sym->tnode->lineno);
+  for(chunk = sym->lineList; chunk != NULL; chunk = chunk->next) {
+    for(i = 0; i < chunk->count; ++i) fprintf(out, "%-8d", chunk->lineno[i]);
   }
 }
 
-void printSymbolTable(FILE *out, BucketList *symtab, int scopeId) {
+static int compareListingOrder(void const *a, void const *b) {
+  struct SlotRec const *x = a, *y = b;
+  unsigned bx = x->hash % LISTING_BUCKETS, by = y->hash % LISTING_BUCKETS;
+  if(bx != by) return bx < by ? -1 : 1;
+  // newest first within a bucket
+  return y->sym->seq - x->sym->seq;
+}
+
+void printSymbolTable(FILE *out, Symtab symtab, int scopeId) {
   fprintf(out, "Name    Scope   Loc     V/P/F   Array?  ArrSize Type    Line Numbers  \n");
   fprintf(out, "----------------------------------------------------------------------\n");
-  int bi;
-  for(bi = 0; bi < SIZE; ++bi) {
-    BucketList p = symtab[bi];
-    while(p != NULL) {
-      TreeNode *tnode = p->sym->tnode;
-      int loc = p->sym->tnode->loc;
-      LineList lineList = p->sym->lineList;
-
-      fprintf(out, "%-8s", tnode->attr.name);
-      fprintf(out, "%-8d", scopeId);
-      fprintf(out, "%-8d", loc);
-
-      char *vpf = "";
-      if(tnode->nodekind == ParamK) {
-        vpf = "Par";
-      }
-      else if(tnode->nodekind == DeclK) {
-        if(tnode->kind.decl == VarDeclK) vpf = "Var";
-        else vpf = "Func";
-      }
-      else {
-        fprintf(stderr, "f**k this, i'm out (unknown v/p/f field)\n");
-        fflush(stderr);
-        exit(-1);
-      }
-
-      fprintf(out, "%-8s", vpf);
-      int arrSize = tnode->child[0]->attr.val;
-      if(arrSize == -1) {
-        fprintf(out, "%-8s", "No");
-        fprintf(out, "%-8s", "-");
-        fprintf(out, "%-8s", tnode->type == IntK ? "int" : "void");
-      }
-      else {
-        fprintf(out, "%-8s", "Array");
-        fprintf(out, "%-8d", arrSize);
-        fprintf(out, "%-8s", "array");
-      }
-
-      printLineList(out, lineList);
-
-      fputc('\n', out);
-
-      p = p->next;
+  struct SlotRec *sorted = NULL;
+  unsigned n = 0, i;
+  if(symtab != NULL && symtab->count > 0) {
+    sorted = malloc(symtab->count * sizeof(struct SlotRec));
+    if(sorted == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+    for(i = 0; i <= symtab->mask; ++i) {
+      if(symtab->slots[i].name != NULL) sorted[n++] = symtab->slots[i];
+    }
+    qsort(sorted, n, sizeof(struct SlotRec), compareListingOrder);
+  }
+  for(i = 0; i < n; ++i) {
+    TreeNode *tnode = sorted[i].sym->tnode;
+    int loc = tnode->loc;
+
+    fprintf(out, "%-8s", tnode->attr.name);
+    fprintf(out, "%-8d", scopeId);
+    fprintf(out, "%-8d", loc);
+
+    char *vpf = "";
+    if(tnode->nodekind == ParamK) {
+      vpf = "Par";
+    }
+    else if(tnode->nodekind == DeclK) {
+      if(tnode->kind.decl == VarDeclK) vpf = "Var";
+      else vpf = "Func";
+    }
+    else {
+      fprintf(stderr, "f**k this, i'm out (unknown v/p/f field)\n");
+      fflush(stderr);
+      exit(-1);
     }
+
+    fprintf(out, "%-8s", vpf);
+    int arrSize = getChild(tnode, 0)->attr.val;
+    if(arrSize == -1) {
+      fprintf(out, "%-8s", "No");
+      fprintf(out, "%-8s", "-");
+      fprintf(out, "%-8s", tnode->type == IntK ? "int" : "void");
+    }
+    else {
+      fprintf(out, "%-8s", "Array");
+      fprintf(out, "%-8d", arrSize);
+      fprintf(out, "%-8s", "array");
+    }
+
+    printLineList(out, sorted[i].sym);
+
+    fputc('\n', out);
   }
+  free(sorted);
   fputc('\n', out);
 }
@@ -1,24 +1,32 @@
 #ifndef _SYMTAB_H_
 #define _SYMTAB_H_
 
+#include "arena.h"
+
 #define INVALID_LOC_NUMBER (0x7fFFffFF)
 
-typedef struct BucketListRec *BucketList;
+/* A symbol table is a flat open-addressing hash table
+ * holding the hash and name of every symbol inline; it
+ * starts small and doubles as the scope fills up
+ */
+typedef struct SymtabRec *Symtab;
+
+Symtab constructSymtab(Arena arena);
 
-BucketList *constructSymtab(void);
-void destroySymtab(BucketList *symtab);
+struct SymbolRec *newSymbol(Arena arena, TreeNode *tnode, int loc);
 
-struct SymbolRec *newSymbol(TreeNode *tnode, int loc);
-void deleteSymbol(struct SymbolRec *sym);
+/* procedure addLineno records a line referring to the
+ * symbol for the listing, in constant time
+ */
+void addLineno(Arena arena, struct SymbolRec *symbolRec, int lineno);
 
-void addLineno(struct SymbolRec *symbolRec, int lineno);
 int getDeclLineno(struct SymbolRec *symbolRec);
 int getMemLoc(struct SymbolRec *symbolRec);
 TreeNode *getTreeNode(struct SymbolRec *symbolRec);
 
-void st_insert(BucketList *symtab, struct SymbolRec *symbolRec);
-struct SymbolRec *st_lookup(BucketList *symtab, char const *name);
+void st_insert(Arena arena, Symtab symtab, struct SymbolRec *symbolRec);
+struct SymbolRec *st_lookup(Symtab symtab, char const *name);
 
-void printSymbolTable(FILE *out, BucketList *symtab, int scopeId);
+void printSymbolTable(FILE *out, Symtab symtab, int scopeId);
 
 #endif
@@ -9,11 +9,15 @@
 #include "globals.h"
 #include "scan.h"
 #include "util.h"
+#include "arena.h"
 
 /* Procedure printToken prints a token
  * and its lexeme to the listing file
  */
-void printToken(TokenType token, const char *tokenString) {
+void printToken(CompileContext *ctx, TokenType token, TokenSlice lexeme) {
+  FILE *listing = ctx->listing;
+  int length = lexeme.length;
+  char const *text = SLICE_TEXT(ctx, lexeme);
   switch (token) {
     case ELSE:
     case IF:
@@ -21,7 +25,7 @@ void printToken(TokenType token, const char *tokenString) {
     case RETURN:
     case VOID:
     case WHILE:
-      fprintf(listing, "reserved word: %s\n", tokenString);
+      fprintf(listing, "reserved word: %.*s\n", length, text);
       break;
     case PLUS:
       fprintf(listing, "+\n");
@@ -84,70 +88,125 @@ void printToken(TokenType token, const char *tokenString) {
       fprintf(listing, "EOF\n");
       break;
     case NUM:
-      fprintf(listing, "NUM, val= %s\n", tokenString);
+      fprintf(listing, "NUM, val= %.*s\n", length, text);
       break;
     case ID:
-      fprintf(listing, "ID, name= %s\n", tokenString);
+      fprintf(listing, "ID, name= %.*s\n", length, text);
       break;
     case ERROR:
-      fprintf(listing, "ERROR: %s\n", tokenString);
+      fprintf(listing, "ERROR: %.*s\n", length, text);
       break;
     default: /* should never happen */
       fprintf(listing, "Unknown token: %d\n", token);
   }
 }
 
-TreeNode *newDeclNode(DeclKind kind) {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+/* Syntax tree nodes are allocated from a pool of chunks
+ * of 2^NODE_CHUNK_BITS nodes each, taken from
+ * ctx->sessionArena so that they are reused by the next
+ * compilation on the context.  Slot 0 of every chunk
+ * holds a pointer back to the pool (see nodeAt), which
+ * also keeps index 0 free to stand for NULL.
+ */
+static TreeNode *allocNode(CompileContext *ctx) {
+  struct NodePool *pool = &ctx->nodes;
+  TreeNode *t;
+
+  if ((pool->next & NODE_CHUNK_MASK) == 0) {
+    unsigned c = pool->next >> NODE_CHUNK_BITS;
+    if (c == pool->nChunks) {
+      if (pool->nChunks == pool->capChunks) {
+        unsigned cap = pool->capChunks ? pool->capChunks * 2 : 16;
+        TreeNode **chunks = realloc(pool->chunks, cap * sizeof(TreeNode *));
+        if (chunks == NULL) return NULL;
+        pool->chunks = chunks;
+        pool->capChunks = cap;
+      }
+      pool->chunks[c] = arenaAlloc(ctx->sessionArena,
+          (NODE_CHUNK_MASK + 1) * sizeof(TreeNode));
+      if (pool->chunks[c] == NULL) return NULL;
+      *(struct NodePool **)pool->chunks[c] = pool;
+      ++pool->nChunks;
+    }
+    ++pool->next;
+  }
+
+  t = &pool->chunks[pool->next >> NODE_CHUNK_BITS][pool->next & NODE_CHUNK_MASK];
+  memset(t, 0, sizeof(TreeNode));
+  t->index = pool->next++;
+  return t;
+}
+
+/* procedure rewindNodePool forgets the nodes of the last
+ * compilation, keeping those below the pool mark
+ */
+void rewindNodePool(CompileContext *ctx) {
+  ctx->nodes.next = ctx->nodes.mark;
+}
+
+/* procedure resetNodePool forgets every node; the chunks
+ * themselves are released with ctx->sessionArena
+ */
+void resetNodePool(CompileContext *ctx) {
+  free(ctx->nodes.chunks);
+  ctx->nodes.chunks = NULL;
+  ctx->nodes.nChunks = 0;
+  ctx->nodes.capChunks = 0;
+  ctx->nodes.next = 0;
+  ctx->nodes.mark = 0;
+}
+
+TreeNode *newDeclNode(CompileContext *ctx, DeclKind kind) {
+  TreeNode *t = allocNode(ctx);
   if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    fprintf(ctx->listing, "Out of memory error at line %d\n", ctx->lineno);
   else {
     int i;
     int nChildren = 1;
     if(kind == FunDeclK) nChildren = 3;
-    for(i=0; i<nChildren; ++i) t->child[i] = NULL;
+    for(i=0; i<nChildren; ++i) t->child[i] = NULL_NODE;
     t->nChildren = nChildren;
-    t->sibling = NULL;
+    t->sibling = NULL_NODE;
     t->nodekind = DeclK;
     t->kind.decl = kind;
     t->type = VoidK;
-    t->lineno = lineno;
+    t->lineno = ctx->lineno;
   }
 
   return  t;
 }
 
-TreeNode *newParamNode(void) {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+TreeNode *newParamNode(CompileContext *ctx) {
+  TreeNode *t = allocNode(ctx);
   if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    fprintf(ctx->listing, "Out of memory error at line %d\n", ctx->lineno);
   else {
     int i;
     int nChildren = 1;
-    for(i=0; i<nChildren; ++i) t->child[i] = NULL;
+    for(i=0; i<nChildren; ++i) t->child[i] = NULL_NODE;
     t->nChildren = nChildren;
-    t->sibling = NULL;
+    t->sibling = NULL_NODE;
     t->nodekind = ParamK;
     t->type= VoidK;
-    t->lineno = lineno;
+    t->lineno = ctx->lineno;
   }
 
   return t;
 }
 
-TreeNode *newTypeNode(void) {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+TreeNode *newTypeNode(CompileContext *ctx) {
+  TreeNode *t = allocNode(ctx);
   if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    fprintf(ctx->listing, "Out of memory error at line %d\n", ctx->lineno);
   else {
     int i;
     int nChildren = 0;
     t->nChildren = nChildren;
-    t->sibling = NULL;
+    t->sibling = NULL_NODE;
     t->nodekind = TypeK;
     t->type= VoidK;
     t->attr.val = -1;
-    t->lineno = lineno;
+    t->lineno = ctx->lineno;
   }
 
   return t;
@@ -156,10 +215,10 @@ TreeNode *newTypeNode(void) {
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
  */
-TreeNode *newStmtNode(StmtKind kind) {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+TreeNode *newStmtNode(CompileContext *ctx, StmtKind kind) {
+  TreeNode *t = allocNode(ctx);
   if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    fprintf(ctx->listing, "Out of memory error at line %d\n", ctx->lineno);
   else {
     int i;
     int nChildren = 0;
@@ -170,12 +229,12 @@ TreeNode *newStmtNode(StmtKind kind) {
       case IterK: nChildren = 2; break;
       case RetK: nChildren = 1; break;
     }
-    for (i = 0; i < nChildren; i++) t->child[i] = NULL;
+    for (i = 0; i < nChildren; i++) t->child[i] = NULL_NODE;
     t->nChildren = nChildren;
-    t->sibling = NULL;
+    t->sibling = NULL_NODE;
     t->nodekind = StmtK;
     t->kind.stmt = kind;
-    t->lineno = lineno;
+    t->lineno = ctx->lineno;
   }
   return t;
 }
@@ -183,11 +242,11 @@ TreeNode *newStmtNode(StmtKind kind) {
 /* Function newExpNode creates a new expression
  * node for syntax tree construction
  */
-TreeNode *newExprNode(ExprKind kind) {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
+TreeNode *newExprNode(CompileContext *ctx, ExprKind kind) {
+  TreeNode *t = allocNode(ctx);
   int i;
   if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
+    fprintf(ctx->listing, "Out of memory error at line %d\n", ctx->lineno);
   else {
     int i;
     int nChildren = 1;
@@ -198,43 +257,41 @@ TreeNode *newExprNode(ExprKind kind) {
         nChildren = 0; break;
       default: break;
     }
-    for (i=0; i<nChildren; ++i) t->child[i] = NULL;
+    for (i=0; i<nChildren; ++i) t->child[i] = NULL_NODE;
     t->nChildren = nChildren;
-    t->sibling = NULL;
+    t->sibling = NULL_NODE;
     t->nodekind = ExprK;
     t->kind.expr = kind;
-    t->lineno = lineno;
+    t->lineno = ctx->lineno;
   }
   return t;
 }
 
-/* Function copyString allocates and makes a new
- * copy of an existing string
+/* Function newNodeList starts a sibling list holding
+ * the given node chain (which may be NULL)
  */
-char *copyString(char *s) {
-  int n;
-  char *t;
-  if (s == NULL) return NULL;
-  n = strlen(s) + 1;
-  t = malloc(n);
-  if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
-  else
-    strcpy(t, s);
-  return t;
+NodeList newNodeList(TreeNode *t) {
+  NodeList list;
+  list.head = t;
+  list.tail = t;
+  if (t != NULL)
+    while (getSibling(list.tail) != NULL) list.tail = getSibling(list.tail);
+  return list;
 }
 
-/* Variable indentno is used by printTree to
- * store current number of spaces to indent
+/* Function appendNodeList appends a node chain to the
+ * end of a sibling list without walking the list
  */
-static int indentno = 0;
-
-/* macros to increase/decrease indentation */
-#define INDENT indentno += 2
-#define UNINDENT indentno -= 2
+NodeList appendNodeList(NodeList list, TreeNode *t) {
+  if (t == NULL) return list;
+  if (list.head == NULL) return newNodeList(t);
+  setSibling(list.tail, t);
+  while (getSibling(list.tail) != NULL) list.tail = getSibling(list.tail);
+  return list;
+}
 
 /* printSpaces indents by printing spaces */
-static void printSpaces(void) {
+static void printSpaces(FILE *listing, int indentno) {
   int i;
   for (i = 0; i < indentno; i++) fprintf(listing, " ");
 }
@@ -244,14 +301,13 @@ static char const *getOperatorName(TokenType token) {
   else return getTokenName(token);
 }
 
-/* procedure printTree prints a syntax tree to the
- * listing file using indentation to indicate subtrees
+/* procedure printTreeAt prints a syntax tree indented
+ * by indentno spaces, its subtrees two spaces deeper
  */
-void printTree(TreeNode *tree) {
+static void printTreeAt(FILE *listing, TreeNode *tree, int indentno) {
   int i;
-  INDENT;
   while (tree != NULL) {
-    printSpaces();
+    printSpaces(listing, indentno);
     if(tree->nodekind == DeclK) {
       switch(tree->kind.decl) {
         case VarDeclK:
@@ -317,13 +373,22 @@ void printTree(TreeNode *tree) {
     }
     else
       fprintf(listing, "Unknown node kind\n");
-    for (i = 0; i < tree->nChildren; ++i) printTree(tree->child[i]);
-    tree = tree->sibling;
+    for (i = 0; i < tree->nChildren; ++i)
+      printTreeAt(listing, getChild(tree, i), indentno + 2);
+    tree = getSibling(tree);
   }
-  UNINDENT;
 }
 
-void analyzeErrorMsg(enum AnalyzeError err, int lineno, char const *msg) {
+/* procedure printTree prints a syntax tree to the
+ * listing file using indentation to indicate subtrees
+ */
+void printTree(CompileContext *ctx, TreeNode *tree) {
+  printTreeAt(ctx->listing, tree, 2);
+}
+
+void analyzeErrorMsg(CompileContext *ctx, enum AnalyzeError err, int lineno,
+                     char const *msg) {
+  FILE *listing = ctx->listing;
   char *canonicalErrMsg = NULL;
   switch(err) {
   case MAIN_FUNCTION_NOT_EXISTS:
@@ -398,4 +463,12 @@ void analyzeErrorMsg(enum AnalyzeError err, int lineno, char const *msg) {
   fputc('\n', listing);
   fputc('\n', listing);
   fflush(listing);
-}
\ No newline at end of file
+}
+
+/* procedure abortCompile abandons the compilation
+ * after a fatal error, returning control to compile()
+ */
+void abortCompile(CompileContext *ctx) {
+  ctx->Error = TRUE;
+  longjmp(ctx->failure, 1);
+}
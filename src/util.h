@@ -8,6 +8,8 @@
 #ifndef _UTIL_H_
 #define _UTIL_H_
 
+#include "scan.h"
+
 enum AnalyzeError {
     MAIN_FUNCTION_NOT_EXISTS,
     MAIN_FUNCTION_MUST_APPEAR_LAST,
@@ -33,34 +35,55 @@ enum AnalyzeError {
 /* Procedure printToken prints a token
  * and its lexeme to the listing file
  */
-void printToken(TokenType, char const*);
+void printToken(CompileContext *, TokenType, TokenSlice);
+
+/* procedure rewindNodePool forgets the nodes of the last
+ * compilation, keeping those below the pool mark
+ */
+void rewindNodePool(CompileContext *);
+
+/* procedure resetNodePool forgets every node; the chunks
+ * themselves are released with ctx->sessionArena
+ */
+void resetNodePool(CompileContext *);
 
-TreeNode *newDeclNode(DeclKind);
+TreeNode *newDeclNode(CompileContext *, DeclKind);
 
-TreeNode *newParamNode(void);
+TreeNode *newParamNode(CompileContext *);
 
-TreeNode *newTypeNode(void);
+TreeNode *newTypeNode(CompileContext *);
 
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
  */
-TreeNode* newStmtNode(StmtKind);
+TreeNode* newStmtNode(CompileContext *, StmtKind);
 
 /* Function newExpNode creates a new expression
  * node for syntax tree construction
  */
-TreeNode* newExprNode(ExprKind);
+TreeNode* newExprNode(CompileContext *, ExprKind);
 
-/* Function copyString allocates and makes a new
- * copy of an existing string
+/* Function newNodeList starts a sibling list holding
+ * the given node chain (which may be NULL)
  */
-char* copyString(char*);
+NodeList newNodeList(TreeNode *);
+
+/* Function appendNodeList appends a node chain to the
+ * end of a sibling list without walking the list
+ */
+NodeList appendNodeList(NodeList, TreeNode *);
 
 /* procedure printTree prints a syntax tree to the
  * listing file using indentation to indicate subtrees
  */
-void printTree(TreeNode*);
+void printTree(CompileContext *, TreeNode*);
 
-void analyzeErrorMsg(enum AnalyzeError err, int lineno, char const *msg);
+void analyzeErrorMsg(CompileContext *, enum AnalyzeError err, int lineno,
+                     char const *msg);
+
+/* procedure abortCompile abandons the compilation
+ * after a fatal error, returning control to compile()
+ */
+void abortCompile(CompileContext *);
 
 #endif
\ No newline at end of file